@@ -0,0 +1,156 @@
+#include "audit/audit_event.h"
+
+#include <immintrin.h>
+
+namespace audit {
+
+namespace {
+
+bool IsSeparator(char c) { return c == ' ' || c == '\x1d' || c == '\''; }
+
+int HexDigit(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+// Decodes the `size` hex digits at `in` into `size / 2` bytes at `out`.
+// Returns false if any of them is not a hex digit.
+bool DecodeHexScalar(const char* in, std::size_t size, char* out) {
+  for (std::size_t i{0}; i < size; i += 2) {
+    int high{HexDigit(in[i])};
+    int low{HexDigit(in[i + 1])};
+    if (high < 0 || low < 0) return false;
+    out[i / 2] = static_cast<char>(high << 4 | low);
+  }
+  return true;
+}
+
+// Values of 16 hex digits, with the lanes that are not digits cleared in
+// `valid`.
+__attribute__((target("sse4.2"))) __m128i HexNibbles(__m128i chars,
+                                                     __m128i* valid) {
+  auto digits{_mm_sub_epi8(chars, _mm_set1_epi8('0'))};
+  auto letters{_mm_sub_epi8(_mm_or_si128(chars, _mm_set1_epi8(0x20)),
+                            _mm_set1_epi8('a'))};
+  auto is_digit{_mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)),
+                               digits)};
+  auto is_letter{_mm_cmpeq_epi8(_mm_min_epu8(letters, _mm_set1_epi8(5)),
+                                letters)};
+  *valid = _mm_and_si128(*valid, _mm_or_si128(is_digit, is_letter));
+  return _mm_blendv_epi8(_mm_add_epi8(letters, _mm_set1_epi8(10)), digits,
+                         is_digit);
+}
+
+// 32 digits per step: each pair of nibbles becomes high * 16 + low in a
+// 16-bit lane, and the lanes are packed back into bytes.
+__attribute__((target("sse4.2"))) bool DecodeHexSse42(const char* in,
+                                                      std::size_t size,
+                                                      char* out) {
+  auto weights{_mm_set1_epi16(0x0110)};
+  auto full{size & ~std::size_t{31}};
+  for (std::size_t i{0}; i < full; i += 32) {
+    auto valid{_mm_set1_epi8(-1)};
+    auto first{HexNibbles(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)), &valid)};
+    auto second{HexNibbles(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 16)),
+        &valid)};
+    if (_mm_movemask_epi8(valid) != 0xffff) return false;
+    auto bytes{_mm_packus_epi16(_mm_maddubs_epi16(first, weights),
+                                _mm_maddubs_epi16(second, weights))};
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i / 2), bytes);
+  }
+  return DecodeHexScalar(in + full, size - full, out + full / 2);
+}
+
+bool DetectSse42() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("sse4.2");
+}
+
+const bool kSse42{DetectSse42()};
+
+std::size_t ParseValue(std::string_view body, std::size_t i,
+                       AuditField* field) {
+  auto size{body.size()};
+  field->quoted = i < size && body[i] == '"';
+  if (field->quoted) {
+    auto value_begin{++i};
+    while (i < size && body[i] != '"') ++i;
+    field->value = body.substr(value_begin, i - value_begin);
+    if (i < size) ++i;
+  } else {
+    auto value_begin{i};
+    while (i < size && !IsSeparator(body[i])) ++i;
+    field->value = body.substr(value_begin, i - value_begin);
+  }
+  return i;
+}
+
+}  // namespace
+
+bool AuditRecord::NextField(std::string_view body, std::size_t* pos,
+                            AuditField* field) {
+  auto i{*pos};
+  auto size{body.size()};
+  while (true) {
+    while (i < size && IsSeparator(body[i])) ++i;
+    if (i >= size) {
+      *pos = i;
+      return false;
+    }
+    auto key_begin{i};
+    while (i < size && body[i] != '=' && !IsSeparator(body[i])) ++i;
+    if (i >= size || body[i] != '=') continue;
+    field->key = body.substr(key_begin, i - key_begin);
+    ++i;
+    if (i < size && body[i] == '\'') {
+      // msg='op=... res=success': descend into the nested pairs.
+      continue;
+    }
+    *pos = ParseValue(body, i, field);
+    return true;
+  }
+}
+
+std::string_view AuditRecord::Field(std::string_view key) const {
+  AuditField field{};
+  return Find(key, &field) ? field.value : std::string_view{};
+}
+
+// Quoted values never contain spaces (auditd hex-encodes those), so a key
+// preceded by a separator and followed by '=' is always a real field.
+bool AuditRecord::Find(std::string_view key, AuditField* field) const {
+  for (auto pos{body.find(key)}; pos != std::string_view::npos;
+       pos = body.find(key, pos + 1)) {
+    auto end{pos + key.size()};
+    if (end >= body.size() || body[end] != '=') continue;
+    if (pos > 0 && !IsSeparator(body[pos - 1])) continue;
+    field->key = body.substr(pos, key.size());
+    if (end + 1 < body.size() && body[end + 1] == '\'') return false;
+    ParseValue(body, end + 1, field);
+    return true;
+  }
+  return false;
+}
+
+void AppendDecoded(const AuditField& field, std::string* out) {
+  const auto& value{field.value};
+  if (field.quoted || value.size() % 2 != 0) {
+    out->append(value);
+    return;
+  }
+  // Decoded in place; the buffers are reused, so this rarely allocates.
+  auto begin{out->size()};
+  out->resize(begin + value.size() / 2);
+  auto* decoded{out->data() + begin};
+  if (!(kSse42 ? DecodeHexSse42(value.data(), value.size(), decoded)
+               : DecodeHexScalar(value.data(), value.size(), decoded))) {
+    out->resize(begin);
+    out->append(value);
+  }
+}
+
+}  // namespace audit
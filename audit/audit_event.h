@@ -0,0 +1,65 @@
+#ifndef AUDIT_AUDIT_EVENT_H_
+#define AUDIT_AUDIT_EVENT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace audit {
+
+struct AuditField {
+  std::string_view key{};
+  std::string_view value{};
+  bool quoted{false};
+};
+
+// Appends the decoded value: quoted values are literal, unquoted ones are
+// hex-encoded by auditd unless they are "(null)" or not valid hex.
+void AppendDecoded(const AuditField& field, std::string* out);
+
+// One `type=... msg=audit(ts:serial): body` line. The body is tokenized
+// lazily, only when a consumer asks for fields of a record type it uses.
+struct AuditRecord {
+  std::string_view type{};
+  std::string_view body{};
+
+  // Returns the raw value of the first field named `key`, without quotes.
+  std::string_view Field(std::string_view key) const;
+  bool Find(std::string_view key, AuditField* field) const;
+  // Calls `visit(field)` for every key=value pair, including the ones nested
+  // in a single-quoted msg='...' part.
+  template <typename Visitor>
+  void ForEachField(Visitor visit) const;
+  static bool NextField(std::string_view body, std::size_t* pos,
+                        AuditField* field);
+};
+
+// Records sharing one serial number. Views point into the parsed buffer.
+struct AuditEvent {
+  std::int64_t time{0};
+  std::uint64_t serial{0};
+  std::string_view node{};
+  std::vector<AuditRecord> records{};
+  // False when the event was flushed before its EOE record arrived.
+  bool complete{true};
+
+  const AuditRecord* Find(std::string_view type) const {
+    for (const auto& record : records) {
+      if (record.type == type) return &record;
+    }
+    return nullptr;
+  }
+};
+
+template <typename Visitor>
+void AuditRecord::ForEachField(Visitor visit) const {
+  std::size_t pos{0};
+  AuditField field{};
+  while (NextField(body, &pos, &field)) visit(field);
+}
+
+}  // namespace audit
+
+#endif  // AUDIT_AUDIT_EVENT_H_
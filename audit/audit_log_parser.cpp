@@ -0,0 +1,163 @@
+#include "audit/audit_log_parser.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <utility>
+
+namespace audit {
+
+namespace {
+
+bool ConsumePrefix(std::string_view* text, std::string_view prefix) {
+  if (text->substr(0, prefix.size()) != prefix) return false;
+  text->remove_prefix(prefix.size());
+  return true;
+}
+
+template <typename T>
+bool ConsumeNumber(std::string_view* text, T* value) {
+  std::size_t i{0};
+  T result{0};
+  while (i < text->size() && (*text)[i] >= '0' && (*text)[i] <= '9') {
+    result = static_cast<T>(result * 10 + static_cast<T>((*text)[i] - '0'));
+    ++i;
+  }
+  if (i == 0) return false;
+  text->remove_prefix(i);
+  *value = result;
+  return true;
+}
+
+std::string_view ConsumeToken(std::string_view* text) {
+  auto end{text->find(' ')};
+  auto token{text->substr(0, end)};
+  text->remove_prefix(end == std::string_view::npos ? text->size() : end + 1);
+  return token;
+}
+
+}  // namespace
+
+bool AuditLogParser::IsSyscallRecord(std::string_view type) {
+  constexpr std::array<std::string_view, 12> kSyscallRecords{
+      "SYSCALL",    "EXECVE", "CWD",  "PATH",       "SOCKADDR", "PROCTITLE",
+      "BPRM_FCAPS", "MMAP",   "IPC",  "SOCKETCALL", "FD_PAIR",  "OBJ_PID"};
+  return std::find(kSyscallRecords.begin(), kSyscallRecords.end(), type) !=
+         kSyscallRecords.end();
+}
+
+AuditLogParser::AuditLogParser(Sink sink) : sink_{std::move(sink)} {
+  slots_.resize(kMaxOpenEvents);
+  detached_.resize(kMaxOpenEvents);
+}
+
+bool AuditLogParser::ParseLine(std::string_view line, std::string_view* node,
+                               std::int64_t* time, std::uint64_t* serial,
+                               AuditRecord* record) {
+  *node = {};
+  if (ConsumePrefix(&line, "node=")) *node = ConsumeToken(&line);
+  if (!ConsumePrefix(&line, "type=")) return false;
+  record->type = ConsumeToken(&line);
+  if (!ConsumePrefix(&line, "msg=audit(")) return false;
+  std::int64_t seconds{0};
+  std::int64_t millis{0};
+  if (!ConsumeNumber(&line, &seconds) || !ConsumePrefix(&line, ".") ||
+      !ConsumeNumber(&line, &millis) || !ConsumePrefix(&line, ":") ||
+      !ConsumeNumber(&line, serial) || !ConsumePrefix(&line, "):")) {
+    return false;
+  }
+  *time = seconds * 1000 + millis;
+  if (!line.empty() && line.front() == ' ') line.remove_prefix(1);
+  record->body = line;
+  return true;
+}
+
+std::size_t AuditLogParser::Feed(std::string_view data) {
+  const char* begin{data.data()};
+  const char* end{begin + data.size()};
+  const char* line{begin};
+  while (line < end) {
+    auto newline{static_cast<const char*>(
+        std::memchr(line, '\n', static_cast<std::size_t>(end - line)))};
+    if (!newline) break;
+    AddLine({line, static_cast<std::size_t>(newline - line)});
+    line = newline + 1;
+  }
+  return static_cast<std::size_t>(line - begin);
+}
+
+void AuditLogParser::Parse(std::string_view data) {
+  auto consumed{Feed(data)};
+  if (consumed < data.size()) AddLine(data.substr(consumed));
+  Finish();
+}
+
+void AuditLogParser::Finish() {
+  while (open_count_ > 0) Emit(0, false);
+}
+
+void AuditLogParser::Detach() {
+  for (std::size_t i{0}; i < open_count_; ++i) {
+    auto& event{slots_[i]};
+    auto size{event.node.size()};
+    for (const auto& record : event.records) {
+      size += record.type.size() + record.body.size();
+    }
+    // Views may point into detached_[i] itself, so copy aside and swap.
+    scratch_.resize(size);
+    auto* out{scratch_.data()};
+    auto copy{[&out](std::string_view* view) {
+      if (view->empty()) return;
+      std::memcpy(out, view->data(), view->size());
+      *view = {out, view->size()};
+      out += view->size();
+    }};
+    copy(&event.node);
+    for (auto& record : event.records) {
+      copy(&record.type);
+      copy(&record.body);
+    }
+    std::swap(detached_[i], scratch_);
+  }
+}
+
+void AuditLogParser::AddLine(std::string_view line) {
+  std::string_view node{};
+  std::int64_t time{0};
+  std::uint64_t serial{0};
+  AuditRecord record{};
+  if (!ParseLine(line, &node, &time, &serial, &record)) return;
+  for (auto i{open_count_}; i-- > 0;) {
+    auto& event{slots_[i]};
+    if (event.serial != serial || event.node != node) continue;
+    if (record.type == "EOE") {
+      Emit(i, true);
+    } else {
+      event.records.push_back(record);
+    }
+    return;
+  }
+  if (record.type == "EOE") return;
+  if (open_count_ == kMaxOpenEvents) Emit(0, false);
+  auto& event{slots_[open_count_++]};
+  event.time = time;
+  event.serial = serial;
+  event.node = node;
+  event.records.clear();
+  event.records.push_back(record);
+  if (!IsSyscallRecord(record.type)) Emit(open_count_ - 1, true);
+}
+
+void AuditLogParser::Emit(std::size_t slot, bool complete) {
+  slots_[slot].complete = complete;
+  sink_(slots_[slot]);
+  auto first{static_cast<std::ptrdiff_t>(slot)};
+  auto last{static_cast<std::ptrdiff_t>(open_count_)};
+  std::rotate(slots_.begin() + first, slots_.begin() + first + 1,
+              slots_.begin() + last);
+  std::rotate(detached_.begin() + first, detached_.begin() + first + 1,
+              detached_.begin() + last);
+  --open_count_;
+}
+
+}  // namespace audit
@@ -0,0 +1,61 @@
+#ifndef AUDIT_AUDIT_LOG_PARSER_H_
+#define AUDIT_AUDIT_LOG_PARSER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+#include "audit/audit_event.h"
+
+namespace audit {
+
+// Tokenizes audit.log lines in place and assembles records into events by
+// serial number. Syscall events (SYSCALL, EXECVE, CWD, PATH, ...) complete on
+// their EOE record; other record types form single-record events. Event
+// buffers are recycled, so steady-state parsing does not allocate.
+class AuditLogParser {
+ public:
+  using Sink = std::function<void(const AuditEvent&)>;
+
+  explicit AuditLogParser(Sink sink);
+  AuditLogParser(const AuditLogParser&) = delete;
+  AuditLogParser& operator=(const AuditLogParser&) = delete;
+  AuditLogParser(AuditLogParser&&) = default;
+  AuditLogParser& operator=(AuditLogParser&&) = default;
+  ~AuditLogParser() = default;
+
+  // Parses every complete line and returns the number of bytes consumed.
+  std::size_t Feed(std::string_view data);
+  // Parses all of `data`, including a final unterminated line, then flushes.
+  void Parse(std::string_view data);
+  // Emits events that are still waiting for their EOE record.
+  void Finish();
+  // Copies the records of events still waiting for their EOE record into
+  // the parser, so the caller may overwrite the data fed so far.
+  void Detach();
+
+  // Whether the record type belongs to a syscall event terminated by EOE.
+  static bool IsSyscallRecord(std::string_view type);
+  static bool ParseLine(std::string_view line, std::string_view* node,
+                        std::int64_t* time, std::uint64_t* serial,
+                        AuditRecord* record);
+
+ private:
+  void AddLine(std::string_view line);
+  void Emit(std::size_t slot, bool complete);
+
+  static constexpr std::size_t kMaxOpenEvents{16};
+  Sink sink_;
+  std::vector<AuditEvent> slots_{};
+  // Bytes of detached events, by slot. Vectors, so moving one between
+  // slots keeps the views into it valid.
+  std::vector<std::vector<char>> detached_{};
+  std::vector<char> scratch_{};
+  std::size_t open_count_{0};
+};
+
+}  // namespace audit
+
+#endif  // AUDIT_AUDIT_LOG_PARSER_H_
@@ -0,0 +1,97 @@
+#ifndef AUDIT_CHUNKED_COLUMN_H_
+#define AUDIT_CHUNKED_COLUMN_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace audit {
+
+// Append-only column split into fixed-size blocks. Blocks never move once
+// allocated, so readers on other threads may access any row below the size
+// published by the owning store while a single writer keeps appending.
+template <typename T>
+class ChunkedColumn {
+ public:
+  static constexpr std::size_t kBlockShift{14};
+  static constexpr std::size_t kBlockRows{std::size_t{1} << kBlockShift};
+  static constexpr std::size_t kBlockMask{kBlockRows - 1};
+
+  ChunkedColumn() = default;
+  ChunkedColumn(const ChunkedColumn&) = delete;
+  ChunkedColumn& operator=(const ChunkedColumn&) = delete;
+  ChunkedColumn(ChunkedColumn&&) = delete;
+  ChunkedColumn& operator=(ChunkedColumn&&) = delete;
+  ~ChunkedColumn() = default;
+
+  void PushBack(const T& value) { EmplaceBack() = value; }
+
+  // Appends a default-initialized row, e.g. to a column of atomics that the
+  // writer sets and keeps updating in place through Mutable().
+  T& EmplaceBack() {
+    if ((size_ & kBlockMask) == 0) {
+      owned_.emplace_back(new T[kBlockRows]);
+      tail_ = owned_.back().get();
+      PublishBlock(tail_);
+    }
+    return tail_[size_++ & kBlockMask];
+  }
+
+  // Writer only, and only for rows appended by PushBack() or EmplaceBack().
+  T& Mutable(std::size_t row) { return const_cast<T&>((*this)[row]); }
+
+  // Appends a full block owned elsewhere, e.g. by a mapped file that outlives
+  // the column. Size() must be a multiple of kBlockRows.
+  void AppendBlock(const T* block) {
+    PublishBlock(block);
+    tail_ = nullptr;
+    size_ += kBlockRows;
+  }
+
+  const T& operator[](std::size_t row) const {
+    return directory_.load(std::memory_order_acquire)[row >> kBlockShift]
+                                                     [row & kBlockMask];
+  }
+
+  const T* Block(std::size_t block) const {
+    return directory_.load(std::memory_order_acquire)[block];
+  }
+
+  static constexpr std::size_t BlockCount(std::size_t rows) {
+    return (rows + kBlockRows - 1) >> kBlockShift;
+  }
+
+  static constexpr std::size_t BlockRows(std::size_t block, std::size_t rows) {
+    auto begin{block << kBlockShift};
+    return rows - begin < kBlockRows ? rows - begin : kBlockRows;
+  }
+
+  std::size_t Size() const { return size_; }
+
+ private:
+  void PublishBlock(const T* block) {
+    auto index{size_ >> kBlockShift};
+    if (index == capacity_) {
+      capacity_ = capacity_ == 0 ? 16 : capacity_ * 2;
+      auto grown{std::make_unique<const T*[]>(capacity_)};
+      for (std::size_t i{0}; i < index; ++i) grown[i] = directories_.back()[i];
+      directories_.push_back(std::move(grown));
+    }
+    directories_.back()[index] = block;
+    directory_.store(directories_.back().get(), std::memory_order_release);
+  }
+
+  // Every directory generation stays alive so a reader holding an older
+  // pointer never observes freed memory.
+  std::vector<std::unique_ptr<const T*[]>> directories_{};
+  std::atomic<const T* const*> directory_{nullptr};
+  std::vector<std::unique_ptr<T[]>> owned_{};
+  T* tail_{nullptr};
+  std::size_t capacity_{0};
+  std::size_t size_{0};
+};
+
+}  // namespace audit
+
+#endif  // AUDIT_CHUNKED_COLUMN_H_
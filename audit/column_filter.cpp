@@ -0,0 +1,187 @@
+#include "audit/column_filter.h"
+
+#include <immintrin.h>
+
+namespace audit {
+
+namespace column_filter {
+
+namespace {
+
+// `lo <= v <= hi` is evaluated as one unsigned comparison on wrapped
+// differences, `v - lo <= hi - lo`, which is valid for signed values too.
+template <typename Unsigned, typename T>
+void RangeScalar(const T* values, std::size_t begin, std::size_t count, T lo,
+                 T hi, std::uint64_t* out) {
+  auto base{static_cast<Unsigned>(lo)};
+  auto span{static_cast<Unsigned>(static_cast<Unsigned>(hi) - base)};
+  for (auto i{begin}; i < count; i += 64) {
+    auto end{count - i < 64 ? count : i + 64};
+    std::uint64_t word{0};
+    for (auto j{i}; j < end; ++j) {
+      auto offset{
+          static_cast<Unsigned>(static_cast<Unsigned>(values[j]) - base)};
+      word |= static_cast<std::uint64_t>(offset <= span) << (j - i);
+    }
+    out[i / 64] = word;
+  }
+}
+
+__attribute__((target("sse4.2"))) void Range32Sse42(
+    const std::uint32_t* values, std::size_t count, std::uint32_t lo,
+    std::uint32_t hi, std::uint64_t* out) {
+  auto base{_mm_set1_epi32(static_cast<int>(lo))};
+  auto span{_mm_set1_epi32(static_cast<int>(hi - lo))};
+  auto full{count & ~std::size_t{63}};
+  for (std::size_t i{0}; i < full; i += 64) {
+    std::uint64_t word{0};
+    for (std::size_t j{0}; j < 64; j += 4) {
+      auto v{_mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i + j))};
+      auto offset{_mm_sub_epi32(v, base)};
+      auto inside{_mm_cmpeq_epi32(_mm_max_epu32(offset, span), span)};
+      auto bits{_mm_movemask_ps(_mm_castsi128_ps(inside))};
+      word |= static_cast<std::uint64_t>(bits) << j;
+    }
+    out[i / 64] = word;
+  }
+  RangeScalar<std::uint32_t>(values, full, count, lo, hi, out);
+}
+
+__attribute__((target("avx2"))) void Range32Avx2(const std::uint32_t* values,
+                                                 std::size_t count,
+                                                 std::uint32_t lo,
+                                                 std::uint32_t hi,
+                                                 std::uint64_t* out) {
+  auto base{_mm256_set1_epi32(static_cast<int>(lo))};
+  auto span{_mm256_set1_epi32(static_cast<int>(hi - lo))};
+  auto full{count & ~std::size_t{63}};
+  for (std::size_t i{0}; i < full; i += 64) {
+    std::uint64_t word{0};
+    for (std::size_t j{0}; j < 64; j += 8) {
+      auto v{_mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(values + i + j))};
+      auto offset{_mm256_sub_epi32(v, base)};
+      auto inside{
+          _mm256_cmpeq_epi32(_mm256_max_epu32(offset, span), span)};
+      auto bits{_mm256_movemask_ps(_mm256_castsi256_ps(inside))};
+      word |= static_cast<std::uint64_t>(static_cast<unsigned>(bits)) << j;
+    }
+    out[i / 64] = word;
+  }
+  RangeScalar<std::uint32_t>(values, full, count, lo, hi, out);
+}
+
+// There is no unsigned 64-bit compare below AVX-512, so both sides are
+// biased by the sign bit and compared signed with pcmpgtq.
+__attribute__((target("sse4.2"))) void Range64Sse42(
+    const std::int64_t* values, std::size_t count, std::int64_t lo,
+    std::int64_t hi, std::uint64_t* out) {
+  constexpr auto kBias{static_cast<long long>(std::uint64_t{1} << 63)};
+  auto base{_mm_set1_epi64x(lo)};
+  auto bias{_mm_set1_epi64x(kBias)};
+  auto span{_mm_set1_epi64x(static_cast<long long>(
+      (static_cast<std::uint64_t>(hi) - static_cast<std::uint64_t>(lo)) ^
+      static_cast<std::uint64_t>(kBias)))};
+  auto full{count & ~std::size_t{63}};
+  for (std::size_t i{0}; i < full; i += 64) {
+    std::uint64_t word{0};
+    for (std::size_t j{0}; j < 64; j += 2) {
+      auto v{_mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i + j))};
+      auto offset{_mm_xor_si128(_mm_sub_epi64(v, base), bias)};
+      auto outside{_mm_cmpgt_epi64(offset, span)};
+      auto bits{~_mm_movemask_pd(_mm_castsi128_pd(outside)) & 3};
+      word |= static_cast<std::uint64_t>(bits) << j;
+    }
+    out[i / 64] = word;
+  }
+  RangeScalar<std::uint64_t>(values, full, count, lo, hi, out);
+}
+
+__attribute__((target("avx2"))) void Range64Avx2(const std::int64_t* values,
+                                                 std::size_t count,
+                                                 std::int64_t lo,
+                                                 std::int64_t hi,
+                                                 std::uint64_t* out) {
+  constexpr auto kBias{static_cast<long long>(std::uint64_t{1} << 63)};
+  auto base{_mm256_set1_epi64x(lo)};
+  auto bias{_mm256_set1_epi64x(kBias)};
+  auto span{_mm256_set1_epi64x(static_cast<long long>(
+      (static_cast<std::uint64_t>(hi) - static_cast<std::uint64_t>(lo)) ^
+      static_cast<std::uint64_t>(kBias)))};
+  auto full{count & ~std::size_t{63}};
+  for (std::size_t i{0}; i < full; i += 64) {
+    std::uint64_t word{0};
+    for (std::size_t j{0}; j < 64; j += 4) {
+      auto v{_mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(values + i + j))};
+      auto offset{_mm256_xor_si256(_mm256_sub_epi64(v, base), bias)};
+      auto outside{_mm256_cmpgt_epi64(offset, span)};
+      auto bits{~_mm256_movemask_pd(_mm256_castsi256_pd(outside)) & 15};
+      word |= static_cast<std::uint64_t>(bits) << j;
+    }
+    out[i / 64] = word;
+  }
+  RangeScalar<std::uint64_t>(values, full, count, lo, hi, out);
+}
+
+Isa DetectIsa() {
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) return Isa::kAvx2;
+  if (__builtin_cpu_supports("sse4.2")) return Isa::kSse42;
+  return Isa::kScalar;
+}
+
+const Isa kIsa{DetectIsa()};
+
+}  // namespace
+
+Isa ActiveIsa() { return kIsa; }
+
+const char* IsaName(Isa isa) {
+  switch (isa) {
+    case Isa::kAvx2:
+      return "AVX2";
+    case Isa::kSse42:
+      return "SSE4.2";
+    default:
+      return "scalar";
+  }
+}
+
+void Range(const std::uint32_t* values, std::size_t count, std::uint32_t lo,
+           std::uint32_t hi, std::uint64_t* out) {
+  switch (kIsa) {
+    case Isa::kAvx2:
+      Range32Avx2(values, count, lo, hi, out);
+      break;
+    case Isa::kSse42:
+      Range32Sse42(values, count, lo, hi, out);
+      break;
+    default:
+      RangeScalar<std::uint32_t>(values, 0, count, lo, hi, out);
+  }
+}
+
+void Range(const std::int32_t* values, std::size_t count, std::int32_t lo,
+           std::int32_t hi, std::uint64_t* out) {
+  Range(reinterpret_cast<const std::uint32_t*>(values), count,
+        static_cast<std::uint32_t>(lo), static_cast<std::uint32_t>(hi), out);
+}
+
+void Range(const std::int64_t* values, std::size_t count, std::int64_t lo,
+           std::int64_t hi, std::uint64_t* out) {
+  switch (kIsa) {
+    case Isa::kAvx2:
+      Range64Avx2(values, count, lo, hi, out);
+      break;
+    case Isa::kSse42:
+      Range64Sse42(values, count, lo, hi, out);
+      break;
+    default:
+      RangeScalar<std::uint64_t>(values, 0, count, lo, hi, out);
+  }
+}
+
+}  // namespace column_filter
+
+}  // namespace audit
@@ -0,0 +1,82 @@
+#ifndef AUDIT_COLUMN_FILTER_H_
+#define AUDIT_COLUMN_FILTER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "audit/chunked_column.h"
+#include "audit/selection.h"
+#include "audit/zone_map.h"
+
+namespace audit {
+
+// Range kernels that turn `lo <= value <= hi` over a column into selection
+// bits, 64 rows per output word. The implementation (AVX2, SSE4.2 or
+// scalar) is chosen once at runtime from the CPU features.
+namespace column_filter {
+
+enum class Isa { kScalar, kSse42, kAvx2 };
+
+Isa ActiveIsa();
+const char* IsaName(Isa isa);
+
+// `count` rows starting at `values` fill `(count + 63) / 64` words of `out`.
+void Range(const std::uint32_t* values, std::size_t count, std::uint32_t lo,
+           std::uint32_t hi, std::uint64_t* out);
+void Range(const std::int32_t* values, std::size_t count, std::int32_t lo,
+           std::int32_t hi, std::uint64_t* out);
+void Range(const std::int64_t* values, std::size_t count, std::int64_t lo,
+           std::int64_t hi, std::uint64_t* out);
+
+// Evaluates the range block by block over the first `rows` rows. Blocks
+// whose zone lies outside the range are skipped and blocks whose zone lies
+// inside it are selected without being read. Returns an empty selection if
+// `cancelled` is raised mid-scan.
+template <typename T>
+Selection SelectRange(const ChunkedColumn<T>& column, const ZoneMap<T>* zones,
+                      std::size_t rows, T lo, T hi,
+                      const std::atomic<bool>* cancelled = nullptr) {
+  Selection selection{rows};
+  if (lo > hi) return selection;
+  constexpr std::size_t kWordsPerBlock{ChunkedColumn<T>::kBlockRows / 64};
+  auto zoned{zones ? std::min(zones->Size(),
+                              rows >> ChunkedColumn<T>::kBlockShift)
+                   : 0};
+  for (std::size_t block{0}; block < ChunkedColumn<T>::BlockCount(rows);
+       ++block) {
+    if (cancelled && cancelled->load(std::memory_order_relaxed)) return {};
+    auto* words{selection.Words() + block * kWordsPerBlock};
+    if (block < zoned) {
+      const auto& zone{(*zones)[block]};
+      if (zone.max < lo || zone.min > hi) continue;
+      if (lo <= zone.min && zone.max <= hi) {
+        std::fill(words, words + kWordsPerBlock, ~std::uint64_t{0});
+        continue;
+      }
+    }
+    Range(column.Block(block), ChunkedColumn<T>::BlockRows(block, rows), lo,
+          hi, words);
+  }
+  return selection;
+}
+
+template <typename T>
+Selection SelectRange(const ChunkedColumn<T>& column, std::size_t rows, T lo,
+                      T hi, const std::atomic<bool>* cancelled = nullptr) {
+  const ZoneMap<T>* zones{nullptr};
+  return SelectRange(column, zones, rows, lo, hi, cancelled);
+}
+
+template <typename T>
+Selection SelectEqual(const ChunkedColumn<T>& column, std::size_t rows,
+                      T value, const std::atomic<bool>* cancelled = nullptr) {
+  return SelectRange(column, rows, value, value, cancelled);
+}
+
+}  // namespace column_filter
+
+}  // namespace audit
+
+#endif  // AUDIT_COLUMN_FILTER_H_
@@ -0,0 +1,226 @@
+#include "audit/connection_store.h"
+
+#include <arpa/inet.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
+namespace audit {
+
+namespace {
+
+constexpr std::array<std::uint8_t, 12> kMappedPrefix{0, 0, 0, 0, 0, 0,
+                                                     0, 0, 0, 0, 0xff, 0xff};
+
+std::uint64_t Mix(std::uint64_t value) {
+  value ^= value >> 33;
+  value *= 0xff51afd7ed558ccdULL;
+  value ^= value >> 33;
+  value *= 0xc4ceb9fe1a85ec53ULL;
+  return value ^ (value >> 33);
+}
+
+}  // namespace
+
+std::size_t ConnectionStore::OpenKeyHash::operator()(
+    const OpenKey& key) const {
+  return static_cast<std::size_t>(
+      Mix((std::uint64_t{key.host} << 32) ^
+          static_cast<std::uint32_t>(key.pid) ^
+          (std::uint64_t{static_cast<std::uint32_t>(key.fd)} << 22)));
+}
+
+std::uint64_t ConnectionStore::Hash(const Address& address,
+                                    std::uint16_t port) {
+  std::uint64_t high{0};
+  std::uint64_t low{0};
+  std::memcpy(&high, address.data(), sizeof(high));
+  std::memcpy(&low, address.data() + sizeof(high), sizeof(low));
+  return Mix(high ^ Mix(low ^ port));
+}
+
+void ConnectionStore::Append(const Socket& socket) {
+  std::unique_lock lock{mutex_};
+  if (socket.kind == Kind::kClose) {
+    Close(socket);
+  } else {
+    Open(socket);
+  }
+  changes_.fetch_add(1, std::memory_order_release);
+}
+
+void ConnectionStore::Open(const Socket& socket) {
+  if (size_ >= kNone) throw std::runtime_error("connection store is full!");
+  if ((size_ & (kBlockRows - 1)) == 0) {
+    blocks_.emplace_back(new Record[kBlockRows]);
+  }
+  auto connection{static_cast<std::uint32_t>(size_++)};
+  auto endpoint{FindEndpoint(socket.address, socket.port)};
+  if (!endpoint) endpoint = AddEndpoint(socket.address, socket.port);
+  auto& ends{endpoints_[*endpoint]};
+  At(connection) = {socket.time, kNone,          socket.host,
+                    socket.uid,  socket.pid,     socket.command,
+                    *endpoint,   ends.newest,    socket.kind == Kind::kAccept};
+  ends.newest = connection;
+  ++ends.count;
+  if (open_.size() >= kMaxOpen) EvictOldest();
+  // A socket still open with this fd lost its close.
+  open_[{socket.host, socket.pid, socket.fd}] = connection;
+}
+
+void ConnectionStore::Close(const Socket& socket) {
+  auto it{open_.find({socket.host, socket.pid, socket.fd})};
+  if (it == open_.end()) return;
+  auto& record{At(it->second)};
+  auto lifetime{std::max<std::int64_t>(socket.time - record.opened, 0)};
+  record.lifetime = static_cast<std::uint32_t>(
+      std::min<std::int64_t>(lifetime, kMaxLifetime));
+  open_.erase(it);
+}
+
+// Connections are numbered in time order, so the older half of the open
+// sockets are those below the median.
+void ConnectionStore::EvictOldest() {
+  std::vector<std::uint32_t> connections{};
+  connections.reserve(open_.size());
+  for (const auto& [key, connection] : open_) {
+    connections.push_back(connection);
+  }
+  auto middle{connections.begin() +
+              static_cast<std::ptrdiff_t>(connections.size() / 2)};
+  std::nth_element(connections.begin(), middle, connections.end());
+  auto median{*middle};
+  for (auto it{open_.begin()}; it != open_.end();) {
+    it = it->second < median ? open_.erase(it) : std::next(it);
+  }
+}
+
+std::optional<std::uint32_t> ConnectionStore::FindEndpoint(
+    const Address& address, std::uint16_t port) const {
+  if (slots_.empty()) return std::nullopt;
+  auto mask{slots_.size() - 1};
+  for (auto slot{Hash(address, port) & mask};; slot = (slot + 1) & mask) {
+    auto endpoint{slots_[slot]};
+    if (endpoint == kNone) return std::nullopt;
+    const auto& ends{endpoints_[endpoint]};
+    if (ends.port == port && ends.address == address) return endpoint;
+  }
+}
+
+std::uint32_t ConnectionStore::AddEndpoint(const Address& address,
+                                           std::uint16_t port) {
+  if (2 * (endpoints_.size() + 1) > slots_.size()) {
+    Rehash(std::max<std::size_t>(2 * slots_.size(), 1024));
+  }
+  auto endpoint{static_cast<std::uint32_t>(endpoints_.size())};
+  endpoints_.push_back({address, port, kNone, 0});
+  auto mask{slots_.size() - 1};
+  auto slot{Hash(address, port) & mask};
+  while (slots_[slot] != kNone) slot = (slot + 1) & mask;
+  slots_[slot] = endpoint;
+  return endpoint;
+}
+
+void ConnectionStore::Rehash(std::size_t capacity) {
+  slots_.assign(capacity, kNone);
+  auto mask{capacity - 1};
+  for (std::size_t endpoint{0}; endpoint < endpoints_.size(); ++endpoint) {
+    const auto& ends{endpoints_[endpoint]};
+    auto slot{Hash(ends.address, ends.port) & mask};
+    while (slots_[slot] != kNone) slot = (slot + 1) & mask;
+    slots_[slot] = static_cast<std::uint32_t>(endpoint);
+  }
+}
+
+std::size_t ConnectionStore::Size() const {
+  std::shared_lock lock{mutex_};
+  return size_;
+}
+
+std::size_t ConnectionStore::EndpointCount() const {
+  std::shared_lock lock{mutex_};
+  return endpoints_.size();
+}
+
+std::size_t ConnectionStore::ByteSize() const {
+  std::shared_lock lock{mutex_};
+  // An unordered_map node holds the pair and a next pointer, and the map a
+  // bucket pointer per node.
+  return blocks_.size() * kBlockRows * sizeof(Record) +
+         endpoints_.capacity() * sizeof(Endpoint) +
+         slots_.capacity() * sizeof(std::uint32_t) +
+         open_.size() * (sizeof(std::pair<const OpenKey, std::uint32_t>) +
+                         2 * sizeof(void*));
+}
+
+ConnectionStore::Connection ConnectionStore::Get(
+    std::size_t connection) const {
+  std::shared_lock lock{mutex_};
+  const auto& record{At(connection)};
+  const auto& ends{endpoints_[record.endpoint]};
+  Connection result{record.incoming, record.opened, std::nullopt,
+                    record.host,     record.uid,    record.pid,
+                    record.command,  ends.address,  ends.port};
+  if (record.lifetime != kNone) {
+    result.closed = record.opened + record.lifetime;
+  }
+  return result;
+}
+
+std::size_t ConnectionStore::Find(const Address& address, std::uint16_t port,
+                                  std::size_t limit,
+                                  std::vector<std::size_t>* connections) const {
+  connections->clear();
+  std::shared_lock lock{mutex_};
+  auto endpoint{FindEndpoint(address, port)};
+  if (!endpoint) return 0;
+  const auto& ends{endpoints_[*endpoint]};
+  for (auto connection{ends.newest};
+       connection != kNone && connections->size() < limit;
+       connection = At(connection).previous) {
+    connections->push_back(connection);
+  }
+  return ends.count;
+}
+
+std::optional<std::pair<ConnectionStore::Address, std::uint16_t>>
+ConnectionStore::ParseEndpoint(std::string_view text) {
+  auto colon{text.rfind(':')};
+  if (colon == std::string_view::npos) return std::nullopt;
+  auto host{text.substr(0, colon)};
+  auto port_text{text.substr(colon + 1)};
+  std::uint16_t port{0};
+  auto [end, error]{std::from_chars(
+      port_text.data(), port_text.data() + port_text.size(), port)};
+  if (error != std::errc{} || end != port_text.data() + port_text.size()) {
+    return std::nullopt;
+  }
+  Address address{};
+  bool bracketed{host.size() > 2 && host.front() == '[' && host.back() == ']'};
+  std::string name{bracketed ? host.substr(1, host.size() - 2) : host};
+  if (!bracketed &&
+      inet_pton(AF_INET, name.c_str(), address.data() + 12) == 1) {
+    std::copy(kMappedPrefix.begin(), kMappedPrefix.end(), address.begin());
+    return std::pair{address, port};
+  }
+  if (bracketed && inet_pton(AF_INET6, name.c_str(), address.data()) == 1) {
+    return std::pair{address, port};
+  }
+  return std::nullopt;
+}
+
+std::string ConnectionStore::FormatAddress(const Address& address) {
+  std::array<char, INET6_ADDRSTRLEN> text{};
+  if (std::equal(kMappedPrefix.begin(), kMappedPrefix.end(),
+                 address.begin())) {
+    inet_ntop(AF_INET, address.data() + 12, text.data(), text.size());
+  } else {
+    inet_ntop(AF_INET6, address.data(), text.data(), text.size());
+  }
+  return text.data();
+}
+
+}  // namespace audit
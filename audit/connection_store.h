@@ -0,0 +1,177 @@
+#ifndef AUDIT_CONNECTION_STORE_H_
+#define AUDIT_CONNECTION_STORE_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "audit/string_dictionary.h"
+
+namespace audit {
+
+// TCP connections behind the "TCP-соединения" node, joined from connect
+// and accept syscalls with the close of their socket. Audit records only
+// the remote end, so a connection is its direction, remote address and
+// port, and the process that opened it: host, pid, uid and executable.
+//
+// Each connection is a fixed 40-byte record; addresses are never strings,
+// and every distinct (address, port) is stored once as an endpoint that
+// the records point to. Endpoints are found through an open-addressing
+// table and chain their connections newest first, so the connections of
+// an endpoint are read without scanning. Open sockets wait in a table keyed
+// by (host, pid, fd) until their close arrives; past kMaxOpen the older
+// half is dropped and stays open forever. A single writer appends while any
+// number of readers query.
+class ConnectionStore {
+ public:
+  using Id = StringDictionary::Id;
+  // IPv6 address; IPv4 ones are mapped, i.e. ::ffff:a.b.c.d.
+  using Address = std::array<std::uint8_t, 16>;
+
+  enum class Kind : std::uint8_t { kConnect, kAccept, kClose };
+
+  // Socket syscall with its host an id of the host dictionary and its
+  // executable an id of Commands(). The address and port of a close are
+  // unused.
+  struct Socket {
+    Kind kind{Kind::kConnect};
+    std::int64_t time{0};
+    Id host{0};
+    std::uint32_t uid{0};
+    std::int32_t pid{0};
+    std::int32_t fd{0};
+    Id command{0};
+    Address address{};
+    std::uint16_t port{0};
+  };
+
+  struct Connection {
+    // Accepted by the process rather than connected by it.
+    bool incoming{false};
+    std::int64_t opened{0};
+    // Unset while the socket is open or its close was not logged.
+    std::optional<std::int64_t> closed{};
+    Id host{0};
+    std::uint32_t uid{0};
+    std::int32_t pid{0};
+    Id command{0};
+    Address address{};
+    std::uint16_t port{0};
+  };
+
+  ConnectionStore() = default;
+  ConnectionStore(const ConnectionStore&) = delete;
+  ConnectionStore& operator=(const ConnectionStore&) = delete;
+  ConnectionStore(ConnectionStore&&) = delete;
+  ConnectionStore& operator=(ConnectionStore&&) = delete;
+  ~ConnectionStore() = default;
+
+  // Sockets must arrive in time order. Writer thread only.
+  void Append(const Socket& socket);
+  // Executables are kept apart from the command column, so socket-only
+  // processes do not show up in its filters and sort order.
+  Id InternCommand(std::string_view command) {
+    return commands_.Intern(command);
+  }
+  const StringDictionary& Commands() const { return commands_; }
+  // Number of sockets appended, to tell when cached answers went stale.
+  std::size_t Changes() const {
+    return changes_.load(std::memory_order_acquire);
+  }
+  std::size_t Size() const;
+  std::size_t EndpointCount() const;
+  // Bytes held by records, endpoints and both tables.
+  std::size_t ByteSize() const;
+  Connection Get(std::size_t connection) const;
+  // Total connections to or from `address`:`port`, and the newest `limit`
+  // of them, newest first.
+  std::size_t Find(const Address& address, std::uint16_t port,
+                   std::size_t limit,
+                   std::vector<std::size_t>* connections) const;
+
+  // Parses "10.0.0.5:443" or "[2001:db8::1]:443".
+  static std::optional<std::pair<Address, std::uint16_t>> ParseEndpoint(
+      std::string_view text);
+  static std::string FormatAddress(const Address& address);
+
+ private:
+  static constexpr std::uint32_t kNone{
+      std::numeric_limits<std::uint32_t>::max()};
+  // Longest lifetime a record holds, about 49 days; kNone while open.
+  static constexpr std::uint32_t kMaxLifetime{kNone - 1};
+  static constexpr std::size_t kBlockShift{14};
+  static constexpr std::size_t kBlockRows{std::size_t{1} << kBlockShift};
+  static constexpr std::size_t kMaxOpen{std::size_t{1} << 20};
+
+  // 40 bytes.
+  struct Record {
+    std::int64_t opened{0};
+    // Milliseconds until the close, or kNone.
+    std::uint32_t lifetime{kNone};
+    Id host{0};
+    std::uint32_t uid{0};
+    std::int32_t pid{0};
+    Id command{0};
+    std::uint32_t endpoint{0};
+    // Previous connection of the same endpoint, or kNone.
+    std::uint32_t previous{kNone};
+    bool incoming{false};
+  };
+  struct Endpoint {
+    Address address{};
+    std::uint16_t port{0};
+    std::uint32_t newest{kNone};
+    std::uint32_t count{0};
+  };
+  struct OpenKey {
+    Id host{0};
+    std::int32_t pid{0};
+    std::int32_t fd{0};
+    bool operator==(const OpenKey& other) const {
+      return host == other.host && pid == other.pid && fd == other.fd;
+    }
+  };
+  struct OpenKeyHash {
+    std::size_t operator()(const OpenKey& key) const;
+  };
+
+  static std::uint64_t Hash(const Address& address, std::uint16_t port);
+  std::optional<std::uint32_t> FindEndpoint(const Address& address,
+                                            std::uint16_t port) const;
+  std::uint32_t AddEndpoint(const Address& address, std::uint16_t port);
+  void Rehash(std::size_t capacity);
+  void Open(const Socket& socket);
+  void Close(const Socket& socket);
+  void EvictOldest();
+  Record& At(std::size_t connection) {
+    return blocks_[connection >> kBlockShift][connection & (kBlockRows - 1)];
+  }
+  const Record& At(std::size_t connection) const {
+    return blocks_[connection >> kBlockShift][connection & (kBlockRows - 1)];
+  }
+
+  StringDictionary commands_{};
+  mutable std::shared_mutex mutex_{};
+  std::vector<std::unique_ptr<Record[]>> blocks_{};
+  std::size_t size_{0};
+  std::vector<Endpoint> endpoints_{};
+  // Endpoint ids by hash, kNone where empty; at most half full.
+  std::vector<std::uint32_t> slots_{};
+  // Connection of every open socket.
+  std::unordered_map<OpenKey, std::uint32_t, OpenKeyHash> open_{};
+  std::atomic<std::size_t> changes_{0};
+};
+
+}  // namespace audit
+
+#endif  // AUDIT_CONNECTION_STORE_H_
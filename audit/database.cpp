@@ -0,0 +1,532 @@
+#include "audit/database.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+namespace audit {
+
+namespace {
+
+using Column = EventStore::Column;
+
+constexpr std::array<Column, 4> kDictionaryColumns{
+    Column::kHost, Column::kCwd, Column::kCommand, Column::kArgs};
+constexpr std::uint64_t kSegmentMagic{0x3430474553445541};  // "AUDSEG04"
+constexpr std::uint64_t kActiveMagic{0x3230544341445541};   // "AUDACT02"
+constexpr std::uint64_t kBatchMagic{0x3230484342445541};    // "AUDBCH02"
+constexpr std::size_t kColumnAlignment{64};
+constexpr std::size_t kSegmentBlocks{Database::kSegmentRows /
+                                     EventStore::kBlockRows};
+
+struct SegmentFooter {
+  struct Strings {
+    std::uint64_t first{0};
+    std::uint64_t count{0};
+    // Byte offsets of `count + 1` uint64 offsets into `bytes`, and of bytes.
+    std::uint64_t offsets{0};
+    std::uint64_t bytes{0};
+    // Byte offset of StringDictionary::kBuckets + 1 uint32 bounds followed
+    // by the `count` ids grouped by bucket.
+    std::uint64_t buckets{0};
+  };
+
+  std::uint64_t rows{0};
+  std::int64_t min_time{0};
+  std::int64_t max_time{0};
+  std::array<std::uint64_t, EventStore::kColumnCount> columns{};
+  std::array<Strings, kDictionaryColumns.size()> strings{};
+  // Byte offset of one EventStore::BlockZones per block.
+  std::uint64_t zones{0};
+  // Byte offset and count of the EncodedExit records added since the
+  // previous segment.
+  std::uint64_t exits{0};
+  std::uint64_t exit_count{0};
+  std::uint64_t magic{kSegmentMagic};
+};
+
+struct ActiveHeader {
+  std::uint64_t magic{kActiveMagic};
+  std::uint64_t first_row{0};
+  std::array<std::uint64_t, kDictionaryColumns.size()> first_strings{};
+};
+
+// Followed by the new strings of every dictionary column, each as a uint32
+// length and bytes, then `rows` EncodedRow and `exits` EncodedExit records.
+struct BatchHeader {
+  std::uint64_t magic{kBatchMagic};
+  std::uint64_t rows{0};
+  std::uint64_t exits{0};
+  std::array<std::uint64_t, kDictionaryColumns.size()> strings{};
+  std::uint64_t bytes{0};
+};
+
+void WriteAll(int fd, const void* data, std::size_t size) {
+  const auto* bytes{static_cast<const char*>(data)};
+  while (size > 0) {
+    auto written{write(fd, bytes, size)};
+    if (written < 0) throw std::runtime_error("failed to write database!");
+    bytes += written;
+    size -= static_cast<std::size_t>(written);
+  }
+}
+
+// Buffers small writes and tracks the file offset.
+class Writer {
+ public:
+  explicit Writer(int fd) : fd_{fd} {}
+
+  void Write(const void* data, std::size_t size) {
+    offset_ += size;
+    if (buffer_.size() + size > kBufferSize) Flush();
+    if (size >= kBufferSize) {
+      WriteAll(fd_, data, size);
+    } else {
+      buffer_.append(static_cast<const char*>(data), size);
+    }
+  }
+
+  template <typename T>
+  void WriteValue(const T& value) {
+    Write(&value, sizeof(value));
+  }
+
+  void Pad(std::size_t alignment) {
+    constexpr char kZeros[kColumnAlignment]{};
+    Write(kZeros, (alignment - offset_ % alignment) % alignment);
+  }
+
+  void Flush() {
+    WriteAll(fd_, buffer_.data(), buffer_.size());
+    buffer_.clear();
+  }
+
+  std::uint64_t Offset() const { return offset_; }
+
+ private:
+  static constexpr std::size_t kBufferSize{1 << 20};
+  int fd_;
+  std::string buffer_{};
+  std::uint64_t offset_{0};
+};
+
+int OpenFile(const std::string& path, int flags) {
+  int fd{open(path.c_str(), flags | O_CLOEXEC, 0644)};
+  if (fd < 0) throw std::runtime_error("failed to open " + path + "!");
+  return fd;
+}
+
+void SyncAndClose(int fd, const std::string& path) {
+  bool synced{fdatasync(fd) == 0};
+  close(fd);
+  if (!synced) throw std::runtime_error("failed to sync " + path + "!");
+}
+
+// Makes a rename durable.
+void SyncDirectory(const std::string& directory) {
+  int fd{OpenFile(directory, O_RDONLY | O_DIRECTORY)};
+  fsync(fd);
+  close(fd);
+}
+
+template <typename T>
+void WriteBlocks(const ChunkedColumn<T>& column, std::size_t first_row,
+                 std::size_t rows, Writer* writer) {
+  auto first{first_row >> ChunkedColumn<T>::kBlockShift};
+  auto last{(first_row + rows) >> ChunkedColumn<T>::kBlockShift};
+  for (auto block{first}; block < last; ++block) {
+    writer->Write(column.Block(block),
+                  ChunkedColumn<T>::kBlockRows * sizeof(T));
+  }
+}
+
+EventStore::EncodedExit ExitAt(const EventStore& store, std::size_t exit) {
+  return {store.ExitTimes()[exit], store.ExitHosts()[exit],
+          store.ExitPids()[exit], store.ExitCodes()[exit]};
+}
+
+template <typename T>
+const T* ColumnAt(std::string_view data, std::uint64_t offset,
+                  std::size_t rows) {
+  if (offset % kColumnAlignment != 0 || offset > data.size() ||
+      rows > (data.size() - offset) / sizeof(T)) {
+    return nullptr;
+  }
+  return reinterpret_cast<const T*>(data.data() + offset);
+}
+
+}  // namespace
+
+Database::Database(std::string directory) : directory_{std::move(directory)} {}
+
+Database::~Database() {
+  if (active_fd_ >= 0) close(active_fd_);
+}
+
+void Database::Open(EventStore* store) {
+  if (store->Size() != 0) {
+    throw std::invalid_argument("database opens into an empty store!");
+  }
+  std::filesystem::create_directories(directory_);
+  for (std::size_t index{0}; std::filesystem::exists(SegmentPath(index));
+       ++index) {
+    OpenSegment(SegmentPath(index), store);
+  }
+  sealed_rows_ = store->Size();
+  sealed_exits_ = store->ExitCount();
+  for (std::size_t i{0}; i < kStringColumns; ++i) {
+    sealed_strings_[i] = store->Dictionary(kDictionaryColumns[i]).Size();
+  }
+  ReplayActive(store);
+}
+
+void Database::OpenSegment(const std::string& path, EventStore* store) {
+  MappedFile file{path, MappedFile::Access::kRandom};
+  auto data{file.Data()};
+  SegmentFooter footer{};
+  if (data.size() < sizeof(footer)) {
+    throw std::runtime_error("corrupt segment " + path + "!");
+  }
+  data.remove_suffix(sizeof(footer));
+  std::memcpy(&footer, data.data() + data.size(), sizeof(footer));
+  if (footer.magic != kSegmentMagic ||
+      footer.rows % EventStore::kBlockRows != 0) {
+    throw std::runtime_error("corrupt segment " + path + "!");
+  }
+
+  for (std::size_t i{0}; i < kStringColumns; ++i) {
+    const auto& strings{footer.strings[i]};
+    auto* dictionary{store->MutableDictionary(kDictionaryColumns[i])};
+    const auto* offsets{ColumnAt<std::uint64_t>(data, strings.offsets,
+                                                strings.count + 1)};
+    const auto* buckets{ColumnAt<std::uint32_t>(
+        data, strings.buckets, StringDictionary::kBuckets + 1 + strings.count)};
+    if (strings.first != dictionary->Size() || !offsets ||
+        strings.bytes > data.size() || !buckets || buckets[0] != 0 ||
+        buckets[StringDictionary::kBuckets] != strings.count) {
+      throw std::runtime_error("corrupt segment " + path + "!");
+    }
+    for (std::size_t bucket{0}; bucket < StringDictionary::kBuckets;
+         ++bucket) {
+      if (buckets[bucket] > buckets[bucket + 1]) {
+        throw std::runtime_error("corrupt segment " + path + "!");
+      }
+    }
+    auto bytes{data.substr(strings.bytes)};
+    for (std::size_t id{0}; id < strings.count; ++id) {
+      if (offsets[id] > offsets[id + 1] || offsets[id + 1] > bytes.size()) {
+        throw std::runtime_error("corrupt segment " + path + "!");
+      }
+      dictionary->AppendStored(
+          bytes.substr(offsets[id], offsets[id + 1] - offsets[id]));
+    }
+    dictionary->AddStoredBuckets(buckets,
+                                 buckets + StringDictionary::kBuckets + 1);
+  }
+
+  auto rows{footer.rows};
+  const auto& at{footer.columns};
+  const auto* times{ColumnAt<std::int64_t>(data, at[0], rows)};
+  const auto* hosts{ColumnAt<EventStore::Id>(data, at[1], rows)};
+  const auto* uids{ColumnAt<std::uint32_t>(data, at[2], rows)};
+  const auto* pids{ColumnAt<std::int32_t>(data, at[3], rows)};
+  const auto* ppids{ColumnAt<std::int32_t>(data, at[4], rows)};
+  const auto* cwds{ColumnAt<EventStore::Id>(data, at[5], rows)};
+  const auto* commands{ColumnAt<EventStore::Id>(data, at[6], rows)};
+  const auto* args{ColumnAt<EventStore::Id>(data, at[7], rows)};
+  const auto* zones{ColumnAt<EventStore::BlockZones>(
+      data, footer.zones, rows / EventStore::kBlockRows)};
+  const auto* exits{
+      ColumnAt<EventStore::EncodedExit>(data, footer.exits, footer.exit_count)};
+  if (!times || !hosts || !uids || !pids || !ppids || !cwds || !commands ||
+      !args || !zones || !exits) {
+    throw std::runtime_error("corrupt segment " + path + "!");
+  }
+  for (std::size_t row{0}; row < rows; row += EventStore::kBlockRows) {
+    store->AppendBlock({times + row, hosts + row, uids + row, pids + row,
+                        ppids + row, cwds + row, commands + row, args + row},
+                       zones[row / EventStore::kBlockRows]);
+  }
+  // Exits are few next to rows, so they are copied rather than mapped.
+  for (std::size_t i{0}; i < footer.exit_count; ++i) {
+    store->AppendExit(exits[i]);
+  }
+  segments_.push_back(std::move(file));
+  segment_count_.store(segments_.size(), std::memory_order_release);
+}
+
+void Database::ReplayActive(EventStore* store) {
+  auto path{ActivePath()};
+  synced_rows_ = sealed_rows_;
+  synced_exits_ = sealed_exits_;
+  synced_strings_ = sealed_strings_;
+  if (!std::filesystem::exists(path)) {
+    ResetActive();
+    return;
+  }
+  MappedFile file{path};
+  auto data{file.Data()};
+  ActiveHeader header{};
+  if (data.size() < sizeof(header)) {
+    throw std::runtime_error("corrupt active segment " + path + "!");
+  }
+  std::memcpy(&header, data.data(), sizeof(header));
+  if (header.magic != kActiveMagic || header.first_row > sealed_rows_) {
+    throw std::runtime_error("corrupt active segment " + path + "!");
+  }
+  // The rows were sealed but the active segment was not reset yet.
+  if (header.first_row < sealed_rows_) {
+    ResetActive();
+    return;
+  }
+
+  std::size_t end{sizeof(header)};
+  while (data.size() - end >= sizeof(BatchHeader)) {
+    BatchHeader batch{};
+    std::memcpy(&batch, data.data() + end, sizeof(batch));
+    if (batch.magic != kBatchMagic ||
+        batch.bytes > data.size() - end - sizeof(batch)) {
+      break;
+    }
+    auto payload{data.substr(end + sizeof(batch), batch.bytes)};
+    std::size_t pos{0};
+    for (std::size_t i{0}; i < kStringColumns; ++i) {
+      auto* dictionary{store->MutableDictionary(kDictionaryColumns[i])};
+      for (std::size_t n{0}; n < batch.strings[i]; ++n) {
+        std::uint32_t size{0};
+        if (payload.size() - pos < sizeof(size)) {
+          throw std::runtime_error("corrupt active segment " + path + "!");
+        }
+        std::memcpy(&size, payload.data() + pos, sizeof(size));
+        pos += sizeof(size);
+        if (payload.size() - pos < size) {
+          throw std::runtime_error("corrupt active segment " + path + "!");
+        }
+        auto expected{dictionary->Size()};
+        if (dictionary->Intern(payload.substr(pos, size)) != expected) {
+          throw std::runtime_error("corrupt active segment " + path + "!");
+        }
+        pos += size;
+      }
+    }
+    if (payload.size() - pos !=
+        batch.rows * sizeof(EventStore::EncodedRow) +
+            batch.exits * sizeof(EventStore::EncodedExit)) {
+      throw std::runtime_error("corrupt active segment " + path + "!");
+    }
+    for (std::size_t row{0}; row < batch.rows; ++row) {
+      EventStore::EncodedRow encoded{};
+      std::memcpy(&encoded, payload.data() + pos, sizeof(encoded));
+      pos += sizeof(encoded);
+      store->Append(encoded);
+    }
+    for (std::size_t exit{0}; exit < batch.exits; ++exit) {
+      EventStore::EncodedExit encoded{};
+      std::memcpy(&encoded, payload.data() + pos, sizeof(encoded));
+      pos += sizeof(encoded);
+      store->AppendExit(encoded);
+    }
+    end += sizeof(batch) + batch.bytes;
+  }
+  // Drops a batch torn by a crash.
+  if (end < data.size() && truncate(path.c_str(), static_cast<off_t>(end))) {
+    throw std::runtime_error("failed to truncate " + path + "!");
+  }
+  active_fd_ = OpenFile(path, O_WRONLY | O_APPEND);
+  synced_rows_ = store->Size();
+  synced_exits_ = store->ExitCount();
+  for (std::size_t i{0}; i < kStringColumns; ++i) {
+    synced_strings_[i] = store->Dictionary(kDictionaryColumns[i]).Size();
+  }
+}
+
+void Database::Sync(const EventStore& store) {
+  while (store.Size() - sealed_rows_ >= kSegmentRows) Seal(store);
+  AppendActive(store);
+}
+
+void Database::Seal(const EventStore& store) {
+  auto path{SegmentPath(sealed_rows_ / kSegmentRows)};
+  auto temporary{path + ".tmp"};
+  auto exits{store.ExitCount()};
+  int fd{OpenFile(temporary, O_WRONLY | O_CREAT | O_TRUNC)};
+  try {
+    Writer writer{fd};
+    SegmentFooter footer{};
+    footer.rows = kSegmentRows;
+    std::size_t column{0};
+    auto write{[&](const auto& values) {
+      writer.Pad(kColumnAlignment);
+      footer.columns[column++] = writer.Offset();
+      WriteBlocks(values, sealed_rows_, kSegmentRows, &writer);
+    }};
+    write(store.Times());
+    write(store.Hosts());
+    write(store.Uids());
+    write(store.Pids());
+    write(store.Ppids());
+    write(store.Cwds());
+    write(store.Commands());
+    write(store.Args());
+
+    std::vector<std::uint32_t> bucket_bounds{};
+    std::vector<EventStore::Id> bucket_ids{};
+    for (std::size_t i{0}; i < kStringColumns; ++i) {
+      const auto& dictionary{store.Dictionary(kDictionaryColumns[i])};
+      auto& strings{footer.strings[i]};
+      strings.first = sealed_strings_[i];
+      strings.count = dictionary.Size() - strings.first;
+      writer.Pad(kColumnAlignment);
+      strings.offsets = writer.Offset();
+      std::uint64_t offset{0};
+      writer.WriteValue(offset);
+      for (auto id{strings.first}; id < dictionary.Size(); ++id) {
+        offset += dictionary.Get(static_cast<EventStore::Id>(id)).size();
+        writer.WriteValue(offset);
+      }
+      strings.bytes = writer.Offset();
+      for (auto id{strings.first}; id < dictionary.Size(); ++id) {
+        auto value{dictionary.Get(static_cast<EventStore::Id>(id))};
+        writer.Write(value.data(), value.size());
+      }
+      dictionary.GroupByBucket(static_cast<EventStore::Id>(strings.first),
+                               static_cast<EventStore::Id>(dictionary.Size()),
+                               &bucket_bounds, &bucket_ids);
+      writer.Pad(kColumnAlignment);
+      strings.buckets = writer.Offset();
+      writer.Write(bucket_bounds.data(),
+                   bucket_bounds.size() * sizeof(bucket_bounds[0]));
+      writer.Write(bucket_ids.data(),
+                   bucket_ids.size() * sizeof(bucket_ids[0]));
+    }
+
+    writer.Pad(kColumnAlignment);
+    footer.zones = writer.Offset();
+    auto first{sealed_rows_ / EventStore::kBlockRows};
+    footer.min_time = store.TimeZones()[first].min;
+    footer.max_time = store.TimeZones()[first].max;
+    for (auto block{first}; block < first + kSegmentBlocks; ++block) {
+      const auto& time{store.TimeZones()[block]};
+      writer.WriteValue(EventStore::BlockZones{
+          time, store.HostZones()[block], store.UidZones()[block],
+          store.PidZones()[block], store.PpidZones()[block]});
+      footer.min_time = std::min(footer.min_time, time.min);
+      footer.max_time = std::max(footer.max_time, time.max);
+    }
+
+    writer.Pad(kColumnAlignment);
+    footer.exits = writer.Offset();
+    footer.exit_count = exits - sealed_exits_;
+    for (auto exit{sealed_exits_}; exit < exits; ++exit) {
+      writer.WriteValue(ExitAt(store, exit));
+    }
+    writer.WriteValue(footer);
+    writer.Flush();
+  } catch (...) {
+    close(fd);
+    throw;
+  }
+  SyncAndClose(fd, temporary);
+  std::filesystem::rename(temporary, path);
+  SyncDirectory(directory_);
+
+  segment_count_.fetch_add(1, std::memory_order_release);
+  sealed_rows_ += kSegmentRows;
+  sealed_exits_ = exits;
+  for (std::size_t i{0}; i < kStringColumns; ++i) {
+    sealed_strings_[i] = store.Dictionary(kDictionaryColumns[i]).Size();
+  }
+  ResetActive();
+}
+
+// Starts an empty active segment right after the sealed data. The rows of
+// the previous one, if any, are all in the newest segment.
+void Database::ResetActive() {
+  if (active_fd_ >= 0) close(active_fd_);
+  active_fd_ = -1;
+  auto path{ActivePath()};
+  auto temporary{path + ".tmp"};
+  int fd{OpenFile(temporary, O_WRONLY | O_CREAT | O_TRUNC)};
+  ActiveHeader header{};
+  header.first_row = sealed_rows_;
+  header.first_strings = sealed_strings_;
+  try {
+    WriteAll(fd, &header, sizeof(header));
+  } catch (...) {
+    close(fd);
+    throw;
+  }
+  SyncAndClose(fd, temporary);
+  std::filesystem::rename(temporary, path);
+  SyncDirectory(directory_);
+  active_fd_ = OpenFile(path, O_WRONLY | O_APPEND);
+  synced_rows_ = sealed_rows_;
+  synced_exits_ = sealed_exits_;
+  synced_strings_ = sealed_strings_;
+}
+
+void Database::AppendActive(const EventStore& store) {
+  auto rows{store.Size()};
+  auto exits{store.ExitCount()};
+  BatchHeader batch{};
+  batch.rows = rows - synced_rows_;
+  batch.exits = exits - synced_exits_;
+  bool empty{batch.rows == 0 && batch.exits == 0};
+  for (std::size_t i{0}; i < kStringColumns; ++i) {
+    const auto& dictionary{store.Dictionary(kDictionaryColumns[i])};
+    batch.strings[i] = dictionary.Size() - synced_strings_[i];
+    empty &= batch.strings[i] == 0;
+    for (auto id{synced_strings_[i]}; id < dictionary.Size(); ++id) {
+      auto size{dictionary.Get(static_cast<EventStore::Id>(id)).size()};
+      batch.bytes += sizeof(std::uint32_t) + size;
+    }
+  }
+  if (empty) return;
+  batch.bytes += batch.rows * sizeof(EventStore::EncodedRow) +
+                 batch.exits * sizeof(EventStore::EncodedExit);
+
+  Writer writer{active_fd_};
+  writer.WriteValue(batch);
+  for (std::size_t i{0}; i < kStringColumns; ++i) {
+    const auto& dictionary{store.Dictionary(kDictionaryColumns[i])};
+    for (auto id{synced_strings_[i]}; id < dictionary.Size(); ++id) {
+      auto value{dictionary.Get(static_cast<EventStore::Id>(id))};
+      writer.WriteValue(static_cast<std::uint32_t>(value.size()));
+      writer.Write(value.data(), value.size());
+    }
+    synced_strings_[i] = dictionary.Size();
+  }
+  for (auto row{synced_rows_}; row < rows; ++row) {
+    writer.WriteValue(EventStore::EncodedRow{
+        store.Times()[row], store.Hosts()[row], store.Uids()[row],
+        store.Pids()[row], store.Ppids()[row], store.Cwds()[row],
+        store.Commands()[row], store.Args()[row]});
+  }
+  for (auto exit{synced_exits_}; exit < exits; ++exit) {
+    writer.WriteValue(ExitAt(store, exit));
+  }
+  writer.Flush();
+  if (fdatasync(active_fd_) != 0) {
+    throw std::runtime_error("failed to sync " + ActivePath() + "!");
+  }
+  synced_rows_ = rows;
+  synced_exits_ = exits;
+}
+
+std::string Database::SegmentPath(std::size_t index) const {
+  char name[32];
+  std::snprintf(name, sizeof(name), "events-%06zu.seg", index);
+  return directory_ + "/" + name;
+}
+
+std::string Database::ActivePath() const { return directory_ + "/active.log"; }
+
+}  // namespace audit
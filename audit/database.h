@@ -0,0 +1,72 @@
+#ifndef AUDIT_DATABASE_H_
+#define AUDIT_DATABASE_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "audit/event_store.h"
+#include "audit/mapped_file.h"
+
+namespace audit {
+
+// On-disk home of an EventStore, a directory of
+//   events-NNNNNN.seg  immutable segments of kSegmentRows rows
+//   active.log         append-only rows not yet sealed into a segment
+// A segment holds every column as a raw array in native byte order, the
+// dictionary strings and process exits added since the previous segment,
+// the zones of every block and a footer index.
+// Segments are mapped on open and their blocks are used in place, so only
+// the pages that are actually read are loaded.
+class Database {
+ public:
+  static constexpr std::size_t kSegmentRows{64 * EventStore::kBlockRows};
+
+  explicit Database(std::string directory);
+  Database(const Database&) = delete;
+  Database& operator=(const Database&) = delete;
+  Database(Database&&) = delete;
+  Database& operator=(Database&&) = delete;
+  ~Database();
+
+  // Maps the segments into the empty `store` and replays the active
+  // segment. The database must outlive `store` and its readers.
+  void Open(EventStore* store);
+  // Persists what was appended to `store` since the last call and seals a
+  // segment whenever kSegmentRows rows are pending. Writer thread only.
+  void Sync(const EventStore& store);
+  std::size_t SegmentCount() const {
+    return segment_count_.load(std::memory_order_acquire);
+  }
+
+ private:
+  static constexpr std::size_t kStringColumns{4};
+  using StringCounts = std::array<std::uint64_t, kStringColumns>;
+
+  void OpenSegment(const std::string& path, EventStore* store);
+  void ReplayActive(EventStore* store);
+  void Seal(const EventStore& store);
+  void ResetActive();
+  void AppendActive(const EventStore& store);
+  std::string SegmentPath(std::size_t index) const;
+  std::string ActivePath() const;
+
+  std::string directory_;
+  std::vector<MappedFile> segments_{};
+  std::atomic<std::size_t> segment_count_{0};
+  // Rows, exits and dictionary entries covered by segments, and by segments
+  // plus the active segment.
+  std::size_t sealed_rows_{0};
+  std::size_t sealed_exits_{0};
+  StringCounts sealed_strings_{};
+  std::size_t synced_rows_{0};
+  std::size_t synced_exits_{0};
+  StringCounts synced_strings_{};
+  int active_fd_{-1};
+};
+
+}  // namespace audit
+
+#endif  // AUDIT_DATABASE_H_
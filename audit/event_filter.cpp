@@ -0,0 +1,83 @@
+#include "audit/event_filter.h"
+
+#include <limits>
+#include <vector>
+
+#include "audit/column_filter.h"
+#include "audit/filter_pipeline.h"
+
+namespace audit {
+
+namespace {
+
+// Hosts with more than 1/kShardRatio of the rows are scanned for instead:
+// the column scans are vectorized, the shard is walked row by row.
+constexpr std::size_t kShardRatio{16};
+
+}  // namespace
+
+std::shared_ptr<const Selection> EventFilter::Evaluate(
+    const EventStore& store, std::size_t rows,
+    const std::atomic<bool>& cancelled) const {
+  std::shared_ptr<Selection> selection{};
+  if (host && store.Shards().Size(*host) * kShardRatio <= rows) {
+    // A small host's shard replaces scans of the numeric columns; rows not
+    // sharded yet are checked directly.
+    selection = std::make_shared<Selection>(rows, false);
+    auto in{[](const auto& range, auto value) {
+      return !range || (range->first <= value && value <= range->second);
+    }};
+    auto test{[&](std::size_t row) {
+      if (row < rows && in(time, store.Times()[row]) &&
+          in(uid, store.Uids()[row]) && in(pid, store.Pids()[row]) &&
+          in(ppid, store.Ppids()[row])) {
+        selection->Set(row);
+      }
+      return !cancelled.load(std::memory_order_relaxed);
+    }};
+    auto sharded{store.Shards().Size()};
+    store.Shards().ForEach(*host, test);
+    for (auto row{sharded}; row < rows; ++row) {
+      if (store.Hosts()[row] == *host && !test(row)) break;
+    }
+  } else {
+    selection = std::make_shared<Selection>(rows, true);
+    auto apply{[&](const auto& column, const auto& zones, const auto& range) {
+      if (!range || cancelled.load(std::memory_order_relaxed)) return;
+      selection->And(column_filter::SelectRange(
+          column, &zones, rows, range->first, range->second, &cancelled));
+    }};
+    apply(store.Times(), store.TimeZones(), time);
+    if (host) {
+      apply(store.Hosts(), store.HostZones(),
+            std::make_optional(std::pair{*host, *host}));
+    }
+    apply(store.Uids(), store.UidZones(), uid);
+    apply(store.Pids(), store.PidZones(), pid);
+    apply(store.Ppids(), store.PpidZones(), ppid);
+  }
+  if (expression && !cancelled.load(std::memory_order_relaxed)) {
+    selection->And(FilterPipeline{*expression, store}.Run(rows, &cancelled));
+  }
+  if (lineage && !cancelled.load(std::memory_order_relaxed)) {
+    std::vector<std::size_t> related{};
+    if (lineage->descendants) {
+      auto [from, to]{time.value_or(
+          std::pair{std::numeric_limits<std::int64_t>::min(),
+                    std::numeric_limits<std::int64_t>::max()})};
+      store.Processes().Descendants(lineage->row, from, to, &related);
+    } else {
+      store.Processes().Ancestors(lineage->row, &related);
+    }
+    Selection family{rows, false};
+    for (auto row : related) {
+      if (row < rows) family.Set(row);
+    }
+    selection->And(family);
+  }
+  if (cancelled.load(std::memory_order_relaxed)) return nullptr;
+  selection->Finalize();
+  return selection;
+}
+
+}  // namespace audit
@@ -0,0 +1,51 @@
+#ifndef AUDIT_EVENT_FILTER_H_
+#define AUDIT_EVENT_FILTER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+
+#include "audit/event_store.h"
+#include "audit/filter_expression.h"
+#include "audit/selection.h"
+
+namespace audit {
+
+// Column predicates of the events table, the typed expression and the
+// lineage of one process, combined with AND.
+struct EventFilter {
+  template <typename T>
+  using Range = std::optional<std::pair<T, T>>;
+
+  // The ancestors or descendants of the process created at `row`.
+  // Descendants are limited to those running within the time range.
+  struct Lineage {
+    std::size_t row{0};
+    bool descendants{false};
+  };
+
+  Range<std::int64_t> time{};
+  std::optional<EventStore::Id> host{};
+  Range<std::uint32_t> uid{};
+  Range<std::int32_t> pid{};
+  Range<std::int32_t> ppid{};
+  std::shared_ptr<const FilterExpression> expression{};
+  std::optional<Lineage> lineage{};
+
+  bool Empty() const {
+    return !time && !host && !uid && !pid && !ppid && !expression &&
+           !lineage;
+  }
+  // Selects the matching rows among the first `rows` rows of `store`.
+  // Returns nullptr if `cancelled` is raised.
+  std::shared_ptr<const Selection> Evaluate(
+      const EventStore& store, std::size_t rows,
+      const std::atomic<bool>& cancelled) const;
+};
+
+}  // namespace audit
+
+#endif  // AUDIT_EVENT_FILTER_H_
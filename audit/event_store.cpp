@@ -0,0 +1,211 @@
+#include "audit/event_store.h"
+
+#include <stdexcept>
+
+namespace audit {
+
+void EventStore::Append(const ExecveEvent& event) {
+  Append(EncodedRow{event.time, host_dictionary_.Intern(event.host),
+                    event.uid, event.pid, event.ppid,
+                    cwd_dictionary_.Intern(event.cwd),
+                    command_dictionary_.Intern(event.command),
+                    args_dictionary_.Intern(event.args)});
+}
+
+void EventStore::Append(const EncodedRow& row) {
+  times_.PushBack(row.time);
+  hosts_.PushBack(row.host);
+  uids_.PushBack(row.uid);
+  pids_.PushBack(row.pid);
+  ppids_.PushBack(row.ppid);
+  cwds_.PushBack(row.cwd);
+  commands_.PushBack(row.command);
+  args_.PushBack(row.args);
+  if ((times_.Size() & ChunkedColumn<Id>::kBlockMask) == 0) {
+    auto block{(times_.Size() >> ChunkedColumn<Id>::kBlockShift) - 1};
+    PushZones({Zone<std::int64_t>::Of(times_.Block(block), kBlockRows),
+               Zone<Id>::Of(hosts_.Block(block), kBlockRows),
+               Zone<std::uint32_t>::Of(uids_.Block(block), kBlockRows),
+               Zone<std::int32_t>::Of(pids_.Block(block), kBlockRows),
+               Zone<std::int32_t>::Of(ppids_.Block(block), kBlockRows)});
+    UpdateIndexes();
+  }
+  size_.store(times_.Size(), std::memory_order_release);
+}
+
+void EventStore::AppendExit(const ExitEvent& event) {
+  AppendExit(EncodedExit{event.time, host_dictionary_.Intern(event.host),
+                         event.pid, event.code});
+}
+
+void EventStore::AppendExit(const EncodedExit& event) {
+  exit_times_.PushBack(event.time);
+  exit_hosts_.PushBack(event.host);
+  exit_pids_.PushBack(event.pid);
+  exit_codes_.PushBack(event.code);
+  exit_count_.store(exit_times_.Size(), std::memory_order_release);
+}
+
+void EventStore::AppendFile(const FileEvent& event) {
+  AppendFile(EncodedFile{event.time, host_dictionary_.Intern(event.host),
+                         event.uid, event.pid, paths_.Intern(event.path)});
+}
+
+void EventStore::AppendFile(const EncodedFile& event) {
+  file_times_.PushBack(event.time);
+  file_hosts_.PushBack(event.host);
+  file_uids_.PushBack(event.uid);
+  file_pids_.PushBack(event.pid);
+  file_paths_.PushBack(event.path);
+  file_count_.store(file_times_.Size(), std::memory_order_release);
+}
+
+void EventStore::AppendSocket(const SocketEvent& event) {
+  AppendSocket(ConnectionStore::Socket{
+      event.kind, event.time, host_dictionary_.Intern(event.host), event.uid,
+      event.pid, event.fd, connections_.InternCommand(event.command),
+      event.address, event.port});
+}
+
+void EventStore::AppendSocket(const ConnectionStore::Socket& socket) {
+  connections_.Append(socket);
+}
+
+void EventStore::AppendLogin(const LoginEvent& event) {
+  AppendLogin(SessionStore::Login{
+      event.kind, event.time, host_dictionary_.Intern(event.host), event.uid,
+      event.pid, event.session, sessions_.InternOrigin(event.terminal),
+      sessions_.InternOrigin(event.address)});
+}
+
+void EventStore::AppendLogin(const SessionStore::Login& login) {
+  sessions_.Append(login);
+}
+
+void EventStore::AppendIdentity(const IdentityEvent& event) {
+  AppendIdentity(IdentityStore::Change{
+      event.kind, event.time, host_dictionary_.Intern(event.host), event.id,
+      identities_.InternName(event.name),
+      identities_.InternName(event.group), event.removed});
+}
+
+void EventStore::AppendIdentity(const IdentityStore::Change& change) {
+  identities_.Append(change);
+}
+
+void EventStore::LoadPasswd(std::string_view host, std::int64_t time,
+                            std::string_view text) {
+  identities_.LoadPasswd(host_dictionary_.Intern(host), time, text);
+}
+
+void EventStore::LoadGroup(std::string_view host, std::int64_t time,
+                           std::string_view text) {
+  identities_.LoadGroup(host_dictionary_.Intern(host), time, text);
+}
+
+void EventStore::AppendBlock(const BlockView& block, const BlockZones& zones) {
+  if (times_.Size() % kBlockRows != 0) {
+    throw std::invalid_argument("store is not block aligned!");
+  }
+  times_.AppendBlock(block.times);
+  hosts_.AppendBlock(block.hosts);
+  uids_.AppendBlock(block.uids);
+  pids_.AppendBlock(block.pids);
+  ppids_.AppendBlock(block.ppids);
+  cwds_.AppendBlock(block.cwds);
+  commands_.AppendBlock(block.commands);
+  args_.AppendBlock(block.args);
+  PushZones(zones);
+  size_.store(times_.Size(), std::memory_order_release);
+}
+
+void EventStore::UpdateIndexes() {
+  command_index_.Update(command_dictionary_);
+  args_index_.Update(args_dictionary_);
+  processes_.Update(*this);
+  shards_.Update(*this);
+  rollups_.Update(*this);
+}
+
+void EventStore::PushZones(const BlockZones& zones) {
+  time_zones_.PushBack(zones.time);
+  host_zones_.PushBack(zones.host);
+  uid_zones_.PushBack(zones.uid);
+  pid_zones_.PushBack(zones.pid);
+  ppid_zones_.PushBack(zones.ppid);
+}
+
+EventStore::Id EventStore::Intern(Column column, std::string_view value) {
+  return MutableDictionary(column)->Intern(value);
+}
+
+PathDictionary::Id EventStore::InternPath(std::string_view path) {
+  return paths_.Intern(path);
+}
+
+EventStore::Id EventStore::InternOrigin(std::string_view origin) {
+  return sessions_.InternOrigin(origin);
+}
+
+EventStore::Id EventStore::InternName(std::string_view name) {
+  return identities_.InternName(name);
+}
+
+EventStore::Id EventStore::InternSocketCommand(std::string_view command) {
+  return connections_.InternCommand(command);
+}
+
+const StringDictionary& EventStore::Dictionary(Column column) const {
+  switch (column) {
+    case Column::kHost:
+      return host_dictionary_;
+    case Column::kCwd:
+      return cwd_dictionary_;
+    case Column::kCommand:
+      return command_dictionary_;
+    case Column::kArgs:
+      return args_dictionary_;
+    default:
+      throw std::invalid_argument("column has no dictionary!");
+  }
+}
+
+StringDictionary* EventStore::MutableDictionary(Column column) {
+  return const_cast<StringDictionary*>(&Dictionary(column));
+}
+
+EventStore::Row EventStore::GetRow(std::size_t row) const {
+  return {times_[row],
+          host_dictionary_.Get(hosts_[row]),
+          uids_[row],
+          pids_[row],
+          ppids_[row],
+          cwd_dictionary_.Get(cwds_[row]),
+          command_dictionary_.Get(commands_[row]),
+          args_dictionary_.Get(args_[row])};
+}
+
+void EventStore::GetRows(std::size_t first, std::size_t last,
+                         std::vector<Row>* rows) const {
+  auto size{Size()};
+  if (last > size) last = size;
+  rows->clear();
+  for (auto row{first}; row < last; ++row) rows->push_back(GetJoinedRow(row));
+}
+
+void EventStore::GetRows(const std::vector<std::size_t>& ids,
+                         std::vector<Row>* rows) const {
+  rows->clear();
+  for (auto row : ids) rows->push_back(GetJoinedRow(row));
+}
+
+EventStore::Row EventStore::GetJoinedRow(std::size_t row) const {
+  auto joined{GetRow(row)};
+  if (auto end{processes_.EndOf(row)}) {
+    joined.exit_time = end->time;
+    if (end->exit) joined.exit_code = exit_codes_[*end->exit];
+  }
+  return joined;
+}
+
+}  // namespace audit
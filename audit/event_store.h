@@ -0,0 +1,334 @@
+#ifndef AUDIT_EVENT_STORE_H_
+#define AUDIT_EVENT_STORE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "audit/chunked_column.h"
+#include "audit/connection_store.h"
+#include "audit/host_shards.h"
+#include "audit/identity_store.h"
+#include "audit/path_dictionary.h"
+#include "audit/process_tree.h"
+#include "audit/rollups.h"
+#include "audit/session_store.h"
+#include "audit/string_dictionary.h"
+#include "audit/trigram_index.h"
+#include "audit/zone_map.h"
+
+namespace audit {
+
+// Process creation event as it arrives from ingestion. Strings are only
+// borrowed for the duration of EventStore::Append().
+struct ExecveEvent {
+  std::int64_t time{0};
+  std::string_view host{};
+  std::uint32_t uid{0};
+  std::int32_t pid{0};
+  std::int32_t ppid{0};
+  std::string_view cwd{};
+  std::string_view command{};
+  std::string_view args{};
+};
+
+// Process exit as it arrives from ingestion.
+struct ExitEvent {
+  std::int64_t time{0};
+  std::string_view host{};
+  std::int32_t pid{0};
+  std::int32_t code{0};
+};
+
+// Socket syscall as it arrives from ingestion: connect or accept with the
+// remote end, or close.
+struct SocketEvent {
+  ConnectionStore::Kind kind{ConnectionStore::Kind::kConnect};
+  std::int64_t time{0};
+  std::string_view host{};
+  std::uint32_t uid{0};
+  std::int32_t pid{0};
+  std::int32_t fd{0};
+  std::string_view command{};
+  ConnectionStore::Address address{};
+  std::uint16_t port{0};
+};
+
+// File access as it arrives from ingestion: one path a syscall used.
+struct FileEvent {
+  std::int64_t time{0};
+  std::string_view host{};
+  std::uint32_t uid{0};
+  std::int32_t pid{0};
+  std::string_view path{};
+};
+
+// Login, logout or boot record as it arrives from ingestion.
+struct LoginEvent {
+  SessionStore::Kind kind{SessionStore::Kind::kLogin};
+  std::int64_t time{0};
+  std::string_view host{};
+  std::uint32_t uid{0};
+  std::int32_t pid{0};
+  std::uint32_t session{SessionStore::kNoSession};
+  std::string_view terminal{};
+  std::string_view address{};
+};
+
+// Account change as it arrives from ingestion.
+struct IdentityEvent {
+  IdentityStore::Kind kind{IdentityStore::Kind::kUser};
+  std::int64_t time{0};
+  std::string_view host{};
+  std::uint32_t id{0};
+  std::string_view name{};
+  std::string_view group{};
+  bool removed{false};
+};
+
+// Columnar store behind the "События" table. Each column is a contiguous
+// block array; strings are kept as dictionary ids. Process exits are kept
+// as a second, shorter stream that the process tree joins to the rows. A
+// single writer appends while any number of readers access rows below
+// Size() and exits below ExitCount(). File accesses are a third stream,
+// read below FileCount(), with paths in a PathDictionary. TCP connections
+// and login sessions are kept apart, in Connections() and Sessions(), and
+// so are the users and groups of every host, in Identities(), with their
+// hosts and commands in the dictionaries of this store.
+class EventStore {
+ public:
+  using Id = StringDictionary::Id;
+
+  enum class Column {
+    kTime,
+    kHost,
+    kUid,
+    kPid,
+    kPpid,
+    kCwd,
+    kCommand,
+    kArgs,
+  };
+  static constexpr std::size_t kColumnCount{8};
+
+  struct Row {
+    std::int64_t time{0};
+    std::string_view host{};
+    std::uint32_t uid{0};
+    std::int32_t pid{0};
+    std::int32_t ppid{0};
+    std::string_view cwd{};
+    std::string_view command{};
+    std::string_view args{};
+    // Joined from the exit stream; unset while the process runs. A process
+    // replaced by a newer one with its pid has no exit code.
+    std::optional<std::int64_t> exit_time{};
+    std::optional<std::int32_t> exit_code{};
+  };
+
+  // Row whose strings are already dictionary ids of this store.
+  struct EncodedRow {
+    std::int64_t time{0};
+    Id host{0};
+    std::uint32_t uid{0};
+    std::int32_t pid{0};
+    std::int32_t ppid{0};
+    Id cwd{0};
+    Id command{0};
+    Id args{0};
+  };
+
+  struct EncodedExit {
+    std::int64_t time{0};
+    Id host{0};
+    std::int32_t pid{0};
+    std::int32_t code{0};
+  };
+
+  struct EncodedFile {
+    std::int64_t time{0};
+    Id host{0};
+    std::uint32_t uid{0};
+    std::int32_t pid{0};
+    PathDictionary::Id path{0};
+  };
+
+  // kBlockRows rows per column whose arrays are owned elsewhere, e.g. by a
+  // mapped segment, and outlive the store.
+  struct BlockView {
+    const std::int64_t* times{nullptr};
+    const Id* hosts{nullptr};
+    const std::uint32_t* uids{nullptr};
+    const std::int32_t* pids{nullptr};
+    const std::int32_t* ppids{nullptr};
+    const Id* cwds{nullptr};
+    const Id* commands{nullptr};
+    const Id* args{nullptr};
+  };
+  // Zones of one block of the numeric columns.
+  struct BlockZones {
+    Zone<std::int64_t> time{};
+    Zone<Id> host{};
+    Zone<std::uint32_t> uid{};
+    Zone<std::int32_t> pid{};
+    Zone<std::int32_t> ppid{};
+  };
+  static constexpr std::size_t kBlockRows{ChunkedColumn<Id>::kBlockRows};
+
+  EventStore() = default;
+  EventStore(const EventStore&) = delete;
+  EventStore& operator=(const EventStore&) = delete;
+  EventStore(EventStore&&) = delete;
+  EventStore& operator=(EventStore&&) = delete;
+  ~EventStore() = default;
+
+  void Append(const ExecveEvent& event);
+  void Append(const EncodedRow& row);
+  void AppendExit(const ExitEvent& event);
+  void AppendExit(const EncodedExit& event);
+  void AppendFile(const FileEvent& event);
+  void AppendFile(const EncodedFile& event);
+  void AppendSocket(const SocketEvent& event);
+  void AppendSocket(const ConnectionStore::Socket& socket);
+  void AppendLogin(const LoginEvent& event);
+  void AppendLogin(const SessionStore::Login& login);
+  void AppendIdentity(const IdentityEvent& event);
+  void AppendIdentity(const IdentityStore::Change& change);
+  // Loads a passwd or group file of `host` as of `time`. Writer thread
+  // only.
+  void LoadPasswd(std::string_view host, std::int64_t time,
+                  std::string_view text);
+  void LoadGroup(std::string_view host, std::int64_t time,
+                 std::string_view text);
+  // Appends a block without copying it, with zones computed earlier so the
+  // block is not read. Size() must be a multiple of kBlockRows and the ids
+  // must already be in the dictionaries.
+  void AppendBlock(const BlockView& block, const BlockZones& zones);
+  // Brings the trigram indexes up to date with the dictionaries, and the
+  // process tree, host shards and rollups with the rows and exits. Append()
+  // does this whenever a block fills up; what was added since is not
+  // indexed yet. Writer thread only.
+  void UpdateIndexes();
+  // Interns into the dictionary of a string column (kHost, kCwd, kCommand or
+  // kArgs). Writer thread only.
+  Id Intern(Column column, std::string_view value);
+  // Interns into the path dictionary of file accesses. Writer thread only.
+  PathDictionary::Id InternPath(std::string_view path);
+  // Interns a terminal or remote address of a login. Writer thread only.
+  Id InternOrigin(std::string_view origin);
+  // Interns a user or group name. Writer thread only.
+  Id InternName(std::string_view name);
+  // Interns the executable of a socket's process. Writer thread only.
+  Id InternSocketCommand(std::string_view command);
+  Row GetRow(std::size_t row) const;
+  // Like GetRow() with the exit time and code joined in.
+  void GetRows(std::size_t first, std::size_t last,
+               std::vector<Row>* rows) const;
+  void GetRows(const std::vector<std::size_t>& ids,
+               std::vector<Row>* rows) const;
+  std::size_t Size() const { return size_.load(std::memory_order_acquire); }
+  std::size_t ExitCount() const {
+    return exit_count_.load(std::memory_order_acquire);
+  }
+  std::size_t FileCount() const {
+    return file_count_.load(std::memory_order_acquire);
+  }
+
+  const ChunkedColumn<std::int64_t>& Times() const { return times_; }
+  const ChunkedColumn<Id>& Hosts() const { return hosts_; }
+  const ChunkedColumn<std::uint32_t>& Uids() const { return uids_; }
+  const ChunkedColumn<std::int32_t>& Pids() const { return pids_; }
+  const ChunkedColumn<std::int32_t>& Ppids() const { return ppids_; }
+  const ChunkedColumn<Id>& Cwds() const { return cwds_; }
+  const ChunkedColumn<Id>& Commands() const { return commands_; }
+  const ChunkedColumn<Id>& Args() const { return args_; }
+
+  const ZoneMap<std::int64_t>& TimeZones() const { return time_zones_; }
+  const ZoneMap<Id>& HostZones() const { return host_zones_; }
+  const ZoneMap<std::uint32_t>& UidZones() const { return uid_zones_; }
+  const ZoneMap<std::int32_t>& PidZones() const { return pid_zones_; }
+  const ZoneMap<std::int32_t>& PpidZones() const { return ppid_zones_; }
+
+  const StringDictionary& HostDictionary() const { return host_dictionary_; }
+  const StringDictionary& CwdDictionary() const { return cwd_dictionary_; }
+  const StringDictionary& CommandDictionary() const {
+    return command_dictionary_;
+  }
+  const StringDictionary& ArgsDictionary() const { return args_dictionary_; }
+  const ChunkedColumn<std::int64_t>& ExitTimes() const { return exit_times_; }
+  const ChunkedColumn<Id>& ExitHosts() const { return exit_hosts_; }
+  const ChunkedColumn<std::int32_t>& ExitPids() const { return exit_pids_; }
+  const ChunkedColumn<std::int32_t>& ExitCodes() const { return exit_codes_; }
+  const ChunkedColumn<std::int64_t>& FileTimes() const { return file_times_; }
+  const ChunkedColumn<Id>& FileHosts() const { return file_hosts_; }
+  const ChunkedColumn<std::uint32_t>& FileUids() const { return file_uids_; }
+  const ChunkedColumn<std::int32_t>& FilePids() const { return file_pids_; }
+  const ChunkedColumn<PathDictionary::Id>& FilePaths() const {
+    return file_paths_;
+  }
+  const PathDictionary& Paths() const { return paths_; }
+
+  const ProcessTree& Processes() const { return processes_; }
+  const HostShards& Shards() const { return shards_; }
+  const Rollups& Aggregates() const { return rollups_; }
+  const ConnectionStore& Connections() const { return connections_; }
+  const SessionStore& Sessions() const { return sessions_; }
+  const IdentityStore& Identities() const { return identities_; }
+  const TrigramIndex& CommandIndex() const { return command_index_; }
+  const TrigramIndex& ArgsIndex() const { return args_index_; }
+
+  // Dictionary of a string column (kHost, kCwd, kCommand or kArgs).
+  const StringDictionary& Dictionary(Column column) const;
+  // Writer thread only.
+  StringDictionary* MutableDictionary(Column column);
+
+ private:
+  void PushZones(const BlockZones& zones);
+  Row GetJoinedRow(std::size_t row) const;
+
+  ChunkedColumn<std::int64_t> times_{};
+  ChunkedColumn<Id> hosts_{};
+  ChunkedColumn<std::uint32_t> uids_{};
+  ChunkedColumn<std::int32_t> pids_{};
+  ChunkedColumn<std::int32_t> ppids_{};
+  ChunkedColumn<Id> cwds_{};
+  ChunkedColumn<Id> commands_{};
+  ChunkedColumn<Id> args_{};
+  ZoneMap<std::int64_t> time_zones_{};
+  ZoneMap<Id> host_zones_{};
+  ZoneMap<std::uint32_t> uid_zones_{};
+  ZoneMap<std::int32_t> pid_zones_{};
+  ZoneMap<std::int32_t> ppid_zones_{};
+  StringDictionary host_dictionary_{};
+  StringDictionary cwd_dictionary_{};
+  StringDictionary command_dictionary_{};
+  StringDictionary args_dictionary_{};
+  ChunkedColumn<std::int64_t> exit_times_{};
+  ChunkedColumn<Id> exit_hosts_{};
+  ChunkedColumn<std::int32_t> exit_pids_{};
+  ChunkedColumn<std::int32_t> exit_codes_{};
+  ChunkedColumn<std::int64_t> file_times_{};
+  ChunkedColumn<Id> file_hosts_{};
+  ChunkedColumn<std::uint32_t> file_uids_{};
+  ChunkedColumn<std::int32_t> file_pids_{};
+  ChunkedColumn<PathDictionary::Id> file_paths_{};
+  PathDictionary paths_{};
+  TrigramIndex command_index_{};
+  TrigramIndex args_index_{};
+  ProcessTree processes_{&times_, &exit_times_};
+  HostShards shards_{&times_};
+  Rollups rollups_{};
+  ConnectionStore connections_{};
+  SessionStore sessions_{};
+  IdentityStore identities_{};
+  std::atomic<std::size_t> size_{0};
+  std::atomic<std::size_t> exit_count_{0};
+  std::atomic<std::size_t> file_count_{0};
+};
+
+}  // namespace audit
+
+#endif  // AUDIT_EVENT_STORE_H_
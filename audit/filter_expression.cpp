@@ -0,0 +1,228 @@
+#include "audit/filter_expression.h"
+
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <stdexcept>
+#include <utility>
+
+#include "audit/timestamp.h"
+
+namespace audit {
+
+namespace {
+
+using Column = EventStore::Column;
+using Kind = FilterExpression::Kind;
+using Op = FilterExpression::Op;
+using Node = std::unique_ptr<const FilterExpression>;
+
+struct ColumnName {
+  std::string_view name;
+  Column column;
+};
+
+constexpr std::array<ColumnName, 8> kColumns{{
+    {"time", Column::kTime},
+    {"host", Column::kHost},
+    {"uid", Column::kUid},
+    {"pid", Column::kPid},
+    {"ppid", Column::kPpid},
+    {"cwd", Column::kCwd},
+    {"command", Column::kCommand},
+    {"args", Column::kArgs},
+}};
+
+struct OpName {
+  std::string_view name;
+  Op op;
+};
+
+// Two-character operators first so "<=" is not read as "<".
+constexpr std::array<OpName, 7> kOps{{
+    {"==", Op::kEqual},
+    {"!=", Op::kNotEqual},
+    {"<=", Op::kLessEqual},
+    {">=", Op::kGreaterEqual},
+    {"<", Op::kLess},
+    {">", Op::kGreater},
+    {"~", Op::kMatch},
+}};
+
+class Parser {
+ public:
+  explicit Parser(std::string_view text) : text_{text} {}
+
+  Node ParseAll() {
+    auto node{ParseOr()};
+    SkipSpaces();
+    if (pos_ != text_.size()) Fail("unexpected input");
+    return node;
+  }
+
+ private:
+  Node ParseOr() {
+    auto node{ParseAnd()};
+    while (Consume("||")) node = Binary(Kind::kOr, std::move(node), ParseAnd());
+    return node;
+  }
+
+  Node ParseAnd() {
+    auto node{ParseUnary()};
+    while (Consume("&&")) {
+      node = Binary(Kind::kAnd, std::move(node), ParseUnary());
+    }
+    return node;
+  }
+
+  Node ParseUnary() {
+    if (Consume("!")) {
+      auto node{std::make_unique<FilterExpression>()};
+      node->kind = Kind::kNot;
+      node->left = ParseUnary();
+      return node;
+    }
+    if (Consume("(")) {
+      auto node{ParseOr()};
+      if (!Consume(")")) Fail("expected ')'");
+      return node;
+    }
+    return ParseCompare();
+  }
+
+  Node ParseCompare() {
+    auto node{std::make_unique<FilterExpression>()};
+    node->kind = Kind::kCompare;
+    auto name{Identifier()};
+    if (name == "user" || name == "group") {
+      node->kind = name == "user" ? Kind::kUser : Kind::kGroup;
+      if (Consume("==")) {
+        node->op = Op::kEqual;
+      } else if (Consume("!=")) {
+        node->op = Op::kNotEqual;
+      } else {
+        Fail("only == and != apply to " + std::string{name});
+      }
+      SkipSpaces();
+      if (pos_ >= text_.size() || text_[pos_] != '"') {
+        Fail("expected a quoted name");
+      }
+      node->text = Quoted();
+      return node;
+    }
+    bool found{false};
+    for (const auto& column : kColumns) {
+      if (column.name == name) {
+        node->column = column.column;
+        found = true;
+      }
+    }
+    if (!found) Fail("unknown column '" + std::string{name} + "'");
+    found = false;
+    for (const auto& op : kOps) {
+      if (Consume(op.name)) {
+        node->op = op.op;
+        found = true;
+        break;
+      }
+    }
+    if (!found) Fail("expected comparison operator");
+    bool is_string{FilterExpression::IsStringColumn(node->column)};
+    bool ordered{node->op != Op::kEqual && node->op != Op::kNotEqual};
+    if (is_string && ordered && node->op != Op::kMatch) {
+      Fail("only ==, != and ~ apply to text columns");
+    }
+    if (!is_string && node->op == Op::kMatch) {
+      Fail("~ applies to text columns only");
+    }
+    SkipSpaces();
+    if (pos_ < text_.size() && text_[pos_] == '"') {
+      node->text = Quoted();
+      if (node->column == Column::kTime) {
+        auto time{ParseLocalTime(node->text)};
+        if (!time) Fail("expected time as \"YYYY-MM-DD HH:MM[:SS]\"");
+        node->number = *time;
+      } else if (!is_string) {
+        Fail("expected a number");
+      }
+    } else {
+      if (is_string) Fail("expected a quoted string");
+      node->number = Number();
+    }
+    return node;
+  }
+
+  static Node Binary(Kind kind, Node left, Node right) {
+    auto node{std::make_unique<FilterExpression>()};
+    node->kind = kind;
+    node->left = std::move(left);
+    node->right = std::move(right);
+    return node;
+  }
+
+  void SkipSpaces() {
+    while (pos_ < text_.size() &&
+           std::isspace(static_cast<unsigned char>(text_[pos_]))) {
+      ++pos_;
+    }
+  }
+
+  bool Consume(std::string_view token) {
+    SkipSpaces();
+    if (text_.substr(pos_, token.size()) != token) return false;
+    pos_ += token.size();
+    return true;
+  }
+
+  std::string_view Identifier() {
+    SkipSpaces();
+    auto begin{pos_};
+    while (pos_ < text_.size() &&
+           (std::isalnum(static_cast<unsigned char>(text_[pos_])) ||
+            text_[pos_] == '_')) {
+      ++pos_;
+    }
+    if (begin == pos_) Fail("expected column name");
+    return text_.substr(begin, pos_ - begin);
+  }
+
+  std::string Quoted() {
+    auto begin{++pos_};
+    auto end{text_.find('"', begin)};
+    if (end == std::string_view::npos) Fail("unterminated string");
+    pos_ = end + 1;
+    return std::string{text_.substr(begin, end - begin)};
+  }
+
+  std::int64_t Number() {
+    std::int64_t value{0};
+    auto [end, ec]{std::from_chars(text_.data() + pos_,
+                                   text_.data() + text_.size(), value)};
+    if (ec != std::errc{}) Fail("expected a number");
+    pos_ = static_cast<std::size_t>(end - text_.data());
+    return value;
+  }
+
+  [[noreturn]] void Fail(const std::string& message) const {
+    throw std::invalid_argument(message + " at " + std::to_string(pos_ + 1));
+  }
+
+  std::string_view text_;
+  std::size_t pos_{0};
+};
+
+}  // namespace
+
+std::unique_ptr<const FilterExpression> FilterExpression::Parse(
+    std::string_view text) {
+  auto blank{text.find_first_not_of(" \t\n") == std::string_view::npos};
+  if (blank) return nullptr;
+  return Parser{text}.ParseAll();
+}
+
+bool FilterExpression::IsStringColumn(EventStore::Column column) {
+  return column == Column::kHost || column == Column::kCwd ||
+         column == Column::kCommand || column == Column::kArgs;
+}
+
+}  // namespace audit
@@ -0,0 +1,48 @@
+#ifndef AUDIT_FILTER_EXPRESSION_H_
+#define AUDIT_FILTER_EXPRESSION_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "audit/event_store.h"
+
+namespace audit {
+
+// Syntax tree of a filter typed above the events table, e.g.
+//   uid == 0 && command ~ "curl" && ppid != 1
+// Columns: time, host, uid, pid, ppid, cwd, command, args. Numeric columns
+// take == != < <= > >=; string columns take == != and ~ (substring). Time
+// literals are quoted local times, "YYYY-MM-DD HH:MM[:SS]". `user` and
+// `group` take == and != with a quoted name: the rows of the users ever
+// named so on their host, or of the members of the groups ever named so.
+struct FilterExpression {
+  enum class Kind { kAnd, kOr, kNot, kCompare, kUser, kGroup };
+  enum class Op {
+    kEqual,
+    kNotEqual,
+    kLess,
+    kLessEqual,
+    kGreater,
+    kGreaterEqual,
+    kMatch,
+  };
+
+  Kind kind{Kind::kCompare};
+  EventStore::Column column{EventStore::Column::kTime};
+  Op op{Op::kEqual};
+  std::int64_t number{0};
+  std::string text{};
+  std::unique_ptr<const FilterExpression> left{};
+  std::unique_ptr<const FilterExpression> right{};
+
+  // Returns nullptr for blank text. Throws std::invalid_argument with a
+  // message fit for the UI.
+  static std::unique_ptr<const FilterExpression> Parse(std::string_view text);
+  static bool IsStringColumn(EventStore::Column column);
+};
+
+}  // namespace audit
+
+#endif  // AUDIT_FILTER_EXPRESSION_H_
@@ -0,0 +1,346 @@
+#include "audit/filter_pipeline.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "audit/column_filter.h"
+
+namespace audit {
+
+namespace {
+
+using Column = EventStore::Column;
+using Id = EventStore::Id;
+using Kernel = FilterPipeline::Kernel;
+using Op = FilterExpression::Op;
+
+// Operators map a literal to an inclusive range over int64, optionally
+// negated. Kernels clamp the range to their column type afterwards.
+struct Bounds {
+  std::int64_t lo;
+  std::int64_t hi;
+  bool negate;
+};
+
+constexpr auto kMin{std::numeric_limits<std::int64_t>::min()};
+constexpr auto kMax{std::numeric_limits<std::int64_t>::max()};
+
+struct Equal {
+  static constexpr Bounds Of(std::int64_t v) { return {v, v, false}; }
+};
+struct NotEqual {
+  static constexpr Bounds Of(std::int64_t v) { return {v, v, true}; }
+};
+struct Less {
+  static constexpr Bounds Of(std::int64_t v) {
+    return v == kMin ? Bounds{kMax, kMin, false} : Bounds{kMin, v - 1, false};
+  }
+};
+struct LessEqual {
+  static constexpr Bounds Of(std::int64_t v) { return {kMin, v, false}; }
+};
+struct Greater {
+  static constexpr Bounds Of(std::int64_t v) {
+    return v == kMax ? Bounds{kMax, kMin, false} : Bounds{v + 1, kMax, false};
+  }
+};
+struct GreaterEqual {
+  static constexpr Bounds Of(std::int64_t v) { return {v, kMax, false}; }
+};
+
+template <typename T, typename Operator>
+class CompareKernel final : public Kernel {
+ public:
+  CompareKernel(const ChunkedColumn<T>& column, const ZoneMap<T>* zones,
+                std::int64_t value)
+      : column_{column}, zones_{zones} {
+    constexpr auto kTypeMin{
+        static_cast<std::int64_t>(std::numeric_limits<T>::min())};
+    constexpr auto kTypeMax{
+        static_cast<std::int64_t>(std::numeric_limits<T>::max())};
+    auto bounds{Operator::Of(value)};
+    negate_ = bounds.negate;
+    empty_ = bounds.lo > kTypeMax || bounds.hi < kTypeMin ||
+             bounds.lo > bounds.hi;
+    lo_ = static_cast<T>(std::max(bounds.lo, kTypeMin));
+    hi_ = static_cast<T>(std::min(bounds.hi, kTypeMax));
+  }
+  CompareKernel(const CompareKernel&) = delete;
+  CompareKernel& operator=(const CompareKernel&) = delete;
+
+  Selection Run(std::size_t rows,
+                const std::atomic<bool>* cancelled) const override {
+    Selection selection{rows};
+    if (!empty_) {
+      selection = column_filter::SelectRange(column_, zones_, rows, lo_, hi_,
+                                             cancelled);
+    }
+    if (negate_) selection.Not();
+    return selection;
+  }
+
+ private:
+  const ChunkedColumn<T>& column_;
+  const ZoneMap<T>* zones_;
+  T lo_{};
+  T hi_{};
+  bool negate_{false};
+  bool empty_{false};
+};
+
+// Rows whose dictionary id is in a precomputed id set.
+class MembershipKernel final : public Kernel {
+ public:
+  MembershipKernel(const ChunkedColumn<Id>& column, Selection ids)
+      : column_{column}, ids_{std::move(ids)} {}
+
+  Selection Run(std::size_t rows,
+                const std::atomic<bool>* cancelled) const override {
+    Selection selection{rows};
+    auto* words{selection.Words()};
+    for (std::size_t block{0}; block < ChunkedColumn<Id>::BlockCount(rows);
+         ++block) {
+      if (cancelled && cancelled->load(std::memory_order_relaxed)) return {};
+      const Id* values{column_.Block(block)};
+      auto count{ChunkedColumn<Id>::BlockRows(block, rows)};
+      auto first{block << ChunkedColumn<Id>::kBlockShift};
+      for (std::size_t i{0}; i < count; ++i) {
+        auto id{values[i]};
+        if (id < ids_.Rows() && ids_.Test(id)) {
+          words[(first + i) >> 6] |= std::uint64_t{1} << ((first + i) & 63);
+        }
+      }
+    }
+    return selection;
+  }
+
+ private:
+  const ChunkedColumn<Id>& column_;
+  Selection ids_;
+};
+
+// Rows whose (host, uid) is one of a set of users, looked up by host.
+class UserKernel final : public Kernel {
+ public:
+  UserKernel(const EventStore& store, const IdentityStore::Users& users,
+             bool negate)
+      : hosts_{store.Hosts()}, uids_{store.Uids()}, negate_{negate} {
+    for (const auto& [host, uid] : users) {
+      if (host >= uids_by_host_.size()) uids_by_host_.resize(host + 1);
+      uids_by_host_[host].push_back(uid);
+    }
+  }
+
+  Selection Run(std::size_t rows,
+                const std::atomic<bool>* cancelled) const override {
+    Selection selection{rows};
+    auto* words{selection.Words()};
+    for (std::size_t block{0}; block < ChunkedColumn<Id>::BlockCount(rows);
+         ++block) {
+      if (cancelled && cancelled->load(std::memory_order_relaxed)) return {};
+      const Id* hosts{hosts_.Block(block)};
+      const std::uint32_t* uids{uids_.Block(block)};
+      auto count{ChunkedColumn<Id>::BlockRows(block, rows)};
+      auto first{block << ChunkedColumn<Id>::kBlockShift};
+      for (std::size_t i{0}; i < count; ++i) {
+        if (hosts[i] >= uids_by_host_.size()) continue;
+        // Users are sorted, and so are the uids of every host.
+        const auto& uids_of_host{uids_by_host_[hosts[i]]};
+        if (std::binary_search(uids_of_host.begin(), uids_of_host.end(),
+                               uids[i])) {
+          words[(first + i) >> 6] |= std::uint64_t{1} << ((first + i) & 63);
+        }
+      }
+    }
+    if (negate_) selection.Not();
+    return selection;
+  }
+
+ private:
+  const ChunkedColumn<Id>& hosts_;
+  const ChunkedColumn<std::uint32_t>& uids_;
+  std::vector<std::vector<std::uint32_t>> uids_by_host_{};
+  bool negate_;
+};
+
+class ConstantKernel final : public Kernel {
+ public:
+  explicit ConstantKernel(bool value) : value_{value} {}
+
+  Selection Run(std::size_t rows, const std::atomic<bool>*) const override {
+    return Selection{rows, value_};
+  }
+
+ private:
+  bool value_;
+};
+
+template <typename T>
+std::unique_ptr<Kernel> MakeCompare(const ChunkedColumn<T>& column,
+                                    const ZoneMap<T>* zones, Op op,
+                                    std::int64_t value) {
+  switch (op) {
+    case Op::kEqual:
+      return std::make_unique<CompareKernel<T, Equal>>(column, zones, value);
+    case Op::kNotEqual:
+      return std::make_unique<CompareKernel<T, NotEqual>>(column, zones,
+                                                          value);
+    case Op::kLess:
+      return std::make_unique<CompareKernel<T, Less>>(column, zones, value);
+    case Op::kLessEqual:
+      return std::make_unique<CompareKernel<T, LessEqual>>(column, zones,
+                                                           value);
+    case Op::kGreater:
+      return std::make_unique<CompareKernel<T, Greater>>(column, zones, value);
+    default:
+      return std::make_unique<CompareKernel<T, GreaterEqual>>(column, zones,
+                                                              value);
+  }
+}
+
+// Resolves the literal against every id of the dictionary, once. With an
+// index, a substring is only compared with its candidates and with the ids
+// added after the index was last updated.
+std::unique_ptr<Kernel> MakeString(const ChunkedColumn<Id>& column,
+                                   const ZoneMap<Id>* zones,
+                                   const StringDictionary& dictionary,
+                                   const TrigramIndex* index, Op op,
+                                   std::string_view text) {
+  Selection ids{dictionary.Size()};
+  Id last{0};
+  auto test{[&](std::size_t i) {
+    auto value{dictionary.Get(static_cast<Id>(i))};
+    bool match{op == Op::kMatch ? value.find(text) != std::string_view::npos
+                                : value == text};
+    if (match) {
+      ids.Set(i);
+      last = static_cast<Id>(i);
+    }
+  }};
+  std::vector<Id> candidates{};
+  std::optional<std::size_t> indexed{};
+  if (index && op == Op::kMatch) indexed = index->Candidates(text, &candidates);
+  if (indexed) {
+    for (auto id : candidates) {
+      if (id < ids.Rows()) test(id);
+    }
+  }
+  for (auto i{indexed.value_or(0)}; i < ids.Rows(); ++i) test(i);
+  ids.Finalize();
+  bool negate{op == Op::kNotEqual};
+  if (ids.Count() == 0) return std::make_unique<ConstantKernel>(negate);
+  if (ids.Count() == 1) {
+    return MakeCompare(column, zones, negate ? Op::kNotEqual : Op::kEqual,
+                       last);
+  }
+  return std::make_unique<MembershipKernel>(column, std::move(ids));
+}
+
+std::unique_ptr<Kernel> MakeKernel(const FilterExpression& expression,
+                                   const EventStore& store) {
+  const auto& value{expression.number};
+  switch (expression.column) {
+    case Column::kTime:
+      return MakeCompare(store.Times(), &store.TimeZones(), expression.op,
+                         value);
+    case Column::kUid:
+      return MakeCompare(store.Uids(), &store.UidZones(), expression.op,
+                         value);
+    case Column::kPid:
+      return MakeCompare(store.Pids(), &store.PidZones(), expression.op,
+                         value);
+    case Column::kPpid:
+      return MakeCompare(store.Ppids(), &store.PpidZones(), expression.op,
+                         value);
+    case Column::kHost:
+      return MakeString(store.Hosts(), &store.HostZones(),
+                        store.HostDictionary(), nullptr, expression.op,
+                        expression.text);
+    case Column::kCwd:
+      return MakeString(store.Cwds(), nullptr, store.CwdDictionary(), nullptr,
+                        expression.op, expression.text);
+    case Column::kCommand:
+      return MakeString(store.Commands(), nullptr, store.CommandDictionary(),
+                        &store.CommandIndex(), expression.op,
+                        expression.text);
+    default:
+      return MakeString(store.Args(), nullptr, store.ArgsDictionary(),
+                        &store.ArgsIndex(), expression.op, expression.text);
+  }
+}
+
+}  // namespace
+
+FilterPipeline::FilterPipeline(const FilterExpression& expression,
+                               const EventStore& store) {
+  Lower(expression, store);
+}
+
+void FilterPipeline::Lower(const FilterExpression& expression,
+                           const EventStore& store) {
+  using Kind = FilterExpression::Kind;
+  switch (expression.kind) {
+    case Kind::kCompare:
+      kernels_.push_back(MakeKernel(expression, store));
+      program_.push_back({Opcode::kKernel, kernels_.size() - 1});
+      return;
+    case Kind::kUser:
+    case Kind::kGroup: {
+      // Names are expanded to the users they stand for once, here.
+      const auto& identities{store.Identities()};
+      auto users{expression.kind == Kind::kUser
+                     ? identities.UsersNamed(expression.text)
+                     : identities.MembersOf(expression.text)};
+      bool negate{expression.op == Op::kNotEqual};
+      if (users.empty()) {
+        kernels_.push_back(std::make_unique<ConstantKernel>(negate));
+      } else {
+        kernels_.push_back(std::make_unique<UserKernel>(store, users, negate));
+      }
+      program_.push_back({Opcode::kKernel, kernels_.size() - 1});
+      return;
+    }
+    case Kind::kNot:
+      Lower(*expression.left, store);
+      program_.push_back({Opcode::kNot, 0});
+      return;
+    default:
+      Lower(*expression.left, store);
+      Lower(*expression.right, store);
+      program_.push_back(
+          {expression.kind == Kind::kAnd ? Opcode::kAnd : Opcode::kOr, 0});
+  }
+}
+
+Selection FilterPipeline::Run(std::size_t rows,
+                              const std::atomic<bool>* cancelled) const {
+  std::vector<Selection> stack{};
+  for (const auto& step : program_) {
+    if (cancelled && cancelled->load(std::memory_order_relaxed)) return {};
+    switch (step.opcode) {
+      case Opcode::kKernel:
+        stack.push_back(kernels_[step.kernel]->Run(rows, cancelled));
+        break;
+      case Opcode::kNot:
+        stack.back().Not();
+        break;
+      default: {
+        auto right{std::move(stack.back())};
+        stack.pop_back();
+        if (step.opcode == Opcode::kAnd) {
+          stack.back().And(right);
+        } else {
+          stack.back().Or(right);
+        }
+      }
+    }
+  }
+  return std::move(stack.back());
+}
+
+}  // namespace audit
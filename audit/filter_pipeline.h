@@ -0,0 +1,54 @@
+#ifndef AUDIT_FILTER_PIPELINE_H_
+#define AUDIT_FILTER_PIPELINE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "audit/event_store.h"
+#include "audit/filter_expression.h"
+#include "audit/selection.h"
+
+namespace audit {
+
+// A filter expression lowered to a postfix program over column kernels.
+// Each comparison becomes a kernel specialized for its column type and
+// operator. String literals are resolved against the dictionaries once,
+// when the pipeline is built, so rows are only compared as integer ids.
+class FilterPipeline {
+ public:
+  class Kernel {
+   public:
+    Kernel() = default;
+    Kernel(const Kernel&) = delete;
+    Kernel& operator=(const Kernel&) = delete;
+    Kernel(Kernel&&) = delete;
+    Kernel& operator=(Kernel&&) = delete;
+    virtual ~Kernel() = default;
+    virtual Selection Run(std::size_t rows,
+                          const std::atomic<bool>* cancelled) const = 0;
+  };
+
+  FilterPipeline(const FilterExpression& expression, const EventStore& store);
+
+  // Evaluates the first `rows` rows. Returns an empty selection if
+  // `cancelled` is raised.
+  Selection Run(std::size_t rows, const std::atomic<bool>* cancelled) const;
+
+ private:
+  enum class Opcode { kKernel, kAnd, kOr, kNot };
+  struct Step {
+    Opcode opcode{Opcode::kKernel};
+    std::size_t kernel{0};
+  };
+
+  void Lower(const FilterExpression& expression, const EventStore& store);
+
+  std::vector<std::unique_ptr<Kernel>> kernels_{};
+  std::vector<Step> program_{};
+};
+
+}  // namespace audit
+
+#endif  // AUDIT_FILTER_PIPELINE_H_
@@ -0,0 +1,165 @@
+#include "audit/host_shards.h"
+
+#include <algorithm>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+
+#include "audit/event_store.h"
+
+namespace audit {
+
+HostShards::HostShards(const ChunkedColumn<std::int64_t>* times)
+    : times_{times} {}
+
+void HostShards::Update(const EventStore& store) {
+  auto rows{store.Size()};
+  if (rows > std::numeric_limits<std::uint32_t>::max()) {
+    throw std::runtime_error("host shards are full!");
+  }
+  const auto& hosts{store.Hosts()};
+  for (auto row{rows_.load(std::memory_order_relaxed)}; row < rows; ++row) {
+    auto host{hosts[row]};
+    if (host >= pending_.size()) pending_.resize(host + std::size_t{1});
+    pending_[host].push_back(static_cast<std::uint32_t>(row));
+  }
+  if (pending_.size() > shards_.size()) {
+    std::unique_lock lock{mutex_};
+    while (shards_.size() < pending_.size()) {
+      shards_.push_back(std::make_unique<Shard>());
+    }
+  }
+  // Only the writer changes the shard list, so it reads it unlocked.
+  for (std::size_t host{0}; host < pending_.size(); ++host) {
+    if (pending_[host].empty()) continue;
+    Append(shards_[host].get(), &pending_[host]);
+    pending_[host].clear();
+  }
+  rows_.store(rows, std::memory_order_release);
+}
+
+// Rows of one host mostly arrive in time order, so this is usually a plain
+// append; late rows are merged in.
+void HostShards::Append(Shard* shard, std::vector<std::uint32_t>* rows) {
+  auto less{[this](std::uint32_t a, std::uint32_t b) { return Less(a, b); }};
+  if (!std::is_sorted(rows->begin(), rows->end(), less)) {
+    std::sort(rows->begin(), rows->end(), less);
+  }
+  std::unique_lock lock{shard->mutex};
+  auto& list{shard->rows};
+  auto middle{static_cast<std::ptrdiff_t>(list.size())};
+  list.insert(list.end(), rows->begin(), rows->end());
+  if (middle > 0 && Less(list[static_cast<std::size_t>(middle)],
+                         list[static_cast<std::size_t>(middle - 1)])) {
+    // Late rows are usually only a little late, so rows before the earliest
+    // of them stay put.
+    auto first{std::upper_bound(list.begin(), list.begin() + middle,
+                                list[static_cast<std::size_t>(middle)], less)};
+    std::inplace_merge(first, list.begin() + middle, list.end(), less);
+  }
+}
+
+std::size_t HostShards::Size() const {
+  return rows_.load(std::memory_order_acquire);
+}
+
+std::size_t HostShards::Size(Id host) const {
+  std::shared_lock lock{mutex_};
+  if (host >= shards_.size()) return 0;
+  std::shared_lock shard_lock{shards_[host]->mutex};
+  return shards_[host]->rows.size();
+}
+
+void HostShards::Merge(std::size_t first, std::size_t last,
+                       std::vector<std::size_t>* rows) const {
+  rows->clear();
+  std::shared_lock lock{mutex_};
+  std::vector<std::shared_lock<std::shared_mutex>> shard_locks{};
+  std::vector<const std::vector<std::uint32_t>*> lists{};
+  shard_locks.reserve(shards_.size());
+  std::size_t total{0};
+  auto min_time{std::numeric_limits<std::int64_t>::max()};
+  auto max_time{std::numeric_limits<std::int64_t>::min()};
+  for (const auto& shard : shards_) {
+    shard_locks.emplace_back(shard->mutex);
+    if (shard->rows.empty()) continue;
+    lists.push_back(&shard->rows);
+    total += shard->rows.size();
+    min_time = std::min(min_time, (*times_)[shard->rows.front()]);
+    max_time = std::max(max_time, (*times_)[shard->rows.back()]);
+  }
+  last = std::min(last, total);
+  if (first >= last) return;
+  // Finds the latest time with at most `first` rows before it; the window
+  // starts among the rows at that time. Every step narrows the range of
+  // each shard that is left to search.
+  std::vector<std::size_t> positions(lists.size(), 0);
+  auto skip{first};
+  if (first > 0) {
+    std::vector<std::size_t> ends(lists.size());
+    std::vector<std::size_t> splits(lists.size());
+    for (std::size_t i{0}; i < lists.size(); ++i) ends[i] = lists[i]->size();
+    auto lo{min_time};
+    auto hi{max_time};
+    while (lo < hi) {
+      auto low{static_cast<std::uint64_t>(lo)};
+      auto span{static_cast<std::uint64_t>(hi) - low};
+      auto mid{static_cast<std::int64_t>(low + (span + 1) / 2)};
+      std::size_t count{0};
+      for (std::size_t i{0}; i < lists.size(); ++i) {
+        auto begin{lists[i]->begin()};
+        splits[i] = static_cast<std::size_t>(
+            std::partition_point(
+                begin + static_cast<std::ptrdiff_t>(positions[i]),
+                begin + static_cast<std::ptrdiff_t>(ends[i]),
+                [this, mid](std::uint32_t row) {
+                  return (*times_)[row] < mid;
+                }) -
+            begin);
+        count += splits[i];
+      }
+      if (count <= first) {
+        lo = mid;
+        positions.swap(splits);
+      } else {
+        hi = mid - 1;
+        ends.swap(splits);
+      }
+    }
+    for (auto position : positions) skip -= position;
+  }
+  struct Head {
+    std::int64_t time{0};
+    std::uint32_t row{0};
+    std::uint32_t list{0};
+  };
+  auto later{[](const Head& a, const Head& b) {
+    return a.time > b.time || (a.time == b.time && a.row > b.row);
+  }};
+  std::vector<Head> heap{};
+  heap.reserve(lists.size());
+  for (std::size_t i{0}; i < lists.size(); ++i) {
+    if (positions[i] == lists[i]->size()) continue;
+    auto row{(*lists[i])[positions[i]]};
+    heap.push_back({(*times_)[row], row, static_cast<std::uint32_t>(i)});
+  }
+  std::make_heap(heap.begin(), heap.end(), later);
+  while (!heap.empty() && rows->size() < last - first) {
+    std::pop_heap(heap.begin(), heap.end(), later);
+    auto head{heap.back()};
+    heap.pop_back();
+    if (skip > 0) {
+      --skip;
+    } else {
+      rows->push_back(head.row);
+    }
+    const auto& list{*lists[head.list]};
+    if (++positions[head.list] < list.size()) {
+      auto row{list[positions[head.list]]};
+      heap.push_back({(*times_)[row], row, head.list});
+      std::push_heap(heap.begin(), heap.end(), later);
+    }
+  }
+}
+
+}  // namespace audit
@@ -0,0 +1,85 @@
+#ifndef AUDIT_HOST_SHARDS_H_
+#define AUDIT_HOST_SHARDS_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <vector>
+
+#include "audit/chunked_column.h"
+#include "audit/string_dictionary.h"
+
+namespace audit {
+
+class EventStore;
+
+// Rows of an EventStore sharded by host. Each shard lists the rows of one
+// host ordered by (time, row), so a per-host query reads one shard, and the
+// shards merge into a single time-ordered view of all hosts. Every shard
+// has its own lock; a shard is only blocked while rows are added to it.
+class HostShards {
+ public:
+  using Id = StringDictionary::Id;
+
+  explicit HostShards(const ChunkedColumn<std::int64_t>* times);
+  HostShards(const HostShards&) = delete;
+  HostShards& operator=(const HostShards&) = delete;
+  HostShards(HostShards&&) = delete;
+  HostShards& operator=(HostShards&&) = delete;
+  ~HostShards() = default;
+
+  // Adds the rows appended to `store` since the last call. Writer thread
+  // only.
+  void Update(const EventStore& store);
+  // Rows added so far, over all shards.
+  std::size_t Size() const;
+  std::size_t Size(Id host) const;
+
+  // Calls `visit(row)` for the rows of `host` in time order until it
+  // returns false.
+  template <typename Visitor>
+  void ForEach(Id host, Visitor visit) const;
+  // Rows with ranks in [first, last) of the time-ordered merge of all
+  // shards, ties broken by row. Only the shard positions around `first`
+  // are searched for and only the window is merged.
+  void Merge(std::size_t first, std::size_t last,
+             std::vector<std::size_t>* rows) const;
+
+ private:
+  struct Shard {
+    mutable std::shared_mutex mutex{};
+    std::vector<std::uint32_t> rows{};
+  };
+
+  bool Less(std::uint32_t a, std::uint32_t b) const {
+    auto time_a{(*times_)[a]};
+    auto time_b{(*times_)[b]};
+    return time_a < time_b || (time_a == time_b && a < b);
+  }
+  void Append(Shard* shard, std::vector<std::uint32_t>* rows);
+
+  const ChunkedColumn<std::int64_t>* times_;
+  // Guards the shard list; taken exclusively only when a host appears.
+  mutable std::shared_mutex mutex_{};
+  std::vector<std::unique_ptr<Shard>> shards_{};
+  std::atomic<std::size_t> rows_{0};
+  // Rows of the current Update() by host, kept for their capacity.
+  std::vector<std::vector<std::uint32_t>> pending_{};
+};
+
+template <typename Visitor>
+void HostShards::ForEach(Id host, Visitor visit) const {
+  std::shared_lock lock{mutex_};
+  if (host >= shards_.size()) return;
+  const auto& shard{*shards_[host]};
+  std::shared_lock shard_lock{shard.mutex};
+  for (auto row : shard.rows) {
+    if (!visit(std::size_t{row})) return;
+  }
+}
+
+}  // namespace audit
+
+#endif  // AUDIT_HOST_SHARDS_H_
@@ -0,0 +1,301 @@
+#include "audit/identity_store.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <iterator>
+#include <mutex>
+
+namespace audit {
+
+namespace {
+
+// Splits the first N colon-separated fields of a passwd or group line.
+template <std::size_t N>
+bool SplitFields(std::string_view line,
+                 std::array<std::string_view, N>* fields) {
+  for (std::size_t i{0}; i + 1 < N; ++i) {
+    auto colon{line.find(':')};
+    if (colon == std::string_view::npos) return false;
+    (*fields)[i] = line.substr(0, colon);
+    line.remove_prefix(colon + 1);
+  }
+  (*fields)[N - 1] = line.substr(0, line.find(':'));
+  return !(*fields)[0].empty();
+}
+
+bool ParseId(std::string_view text, std::uint32_t* id) {
+  auto [end, error]{std::from_chars(text.data(), text.data() + text.size(),
+                                    *id)};
+  return error == std::errc{} && end == text.data() + text.size();
+}
+
+// Calls `visit(line)` for every line that is not blank or a comment.
+template <typename Visitor>
+void ForEachLine(std::string_view text, Visitor visit) {
+  while (!text.empty()) {
+    auto end{std::min(text.find('\n'), text.size())};
+    auto line{text.substr(0, end)};
+    text.remove_prefix(std::min(end + 1, text.size()));
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+    if (!line.empty() && line.front() != '#') visit(line);
+  }
+}
+
+}  // namespace
+
+void IdentityStore::AddVersion(Account* account, const Version& version) {
+  auto& versions{account->versions};
+  auto it{std::upper_bound(
+      versions.begin(), versions.end(), version.since,
+      [](std::int64_t since, const Version& v) { return since < v.since; })};
+  if (it != versions.begin()) {
+    const auto& previous{*std::prev(it)};
+    if (previous.name == version.name && previous.gid == version.gid &&
+        previous.deleted == version.deleted) {
+      return;
+    }
+  }
+  versions.insert(it, version);
+}
+
+const IdentityStore::Version& IdentityStore::VersionAt(
+    const Account& account, std::int64_t time) {
+  const auto& versions{account.versions};
+  auto it{std::upper_bound(
+      versions.begin(), versions.end(), time,
+      [](std::int64_t since, const Version& v) { return since < v.since; })};
+  return it == versions.begin() ? versions.front() : *std::prev(it);
+}
+
+IdentityStore::Name IdentityStore::NameAt(const Account& account,
+                                          std::int64_t time) const {
+  const auto& versions{account.versions};
+  const auto& version{VersionAt(account, time)};
+  Name name{};
+  if (time >= version.since) name.from = version.since;
+  auto next{static_cast<std::size_t>(&version - versions.data()) + 1};
+  if (time < version.since) {
+    name.to = version.since;
+  } else if (next < versions.size()) {
+    name.to = versions[next].since;
+  }
+  // Before its first version an account existed with that name.
+  if (!version.deleted || time < version.since) {
+    name.name = names_.Get(version.name);
+  }
+  return name;
+}
+
+bool IdentityStore::EverNamed(const Account& account,
+                              std::string_view name) const {
+  return std::any_of(
+      account.versions.begin(), account.versions.end(),
+      [&](const Version& v) { return names_.Get(v.name) == name; });
+}
+
+void IdentityStore::AddMembership(Group* group, const Membership& membership) {
+  auto& members{group->members};
+  auto it{std::find_if(members.rbegin(), members.rend(),
+                       [&](const Membership& m) {
+                         return m.user == membership.user;
+                       })};
+  if (it != members.rend() && it->member == membership.member) return;
+  members.push_back(membership);
+}
+
+void IdentityStore::Delete(Account* account, std::int64_t time) {
+  if (time < account->versions.front().since) return;
+  auto version{VersionAt(*account, time)};
+  version.since = time;
+  version.deleted = true;
+  AddVersion(account, version);
+}
+
+IdentityStore::Account& IdentityStore::User(Id host, std::uint32_t uid) {
+  auto [it, added]{user_ids_.try_emplace(
+      Key(host, uid), static_cast<std::uint32_t>(users_.size()))};
+  if (added) users_.push_back({host, uid, {}});
+  return users_[it->second];
+}
+
+IdentityStore::Group& IdentityStore::GroupOf(Id host, std::uint32_t gid) {
+  auto [it, added]{group_ids_.try_emplace(
+      Key(host, gid), static_cast<std::uint32_t>(groups_.size()))};
+  if (added) groups_.push_back({{host, gid, {}}, {}});
+  return groups_[it->second];
+}
+
+void IdentityStore::Publish(std::unique_lock<std::shared_mutex>* lock) {
+  user_count_.store(users_.size(), std::memory_order_release);
+  group_count_.store(groups_.size(), std::memory_order_release);
+  lock->unlock();
+  changes_.fetch_add(1, std::memory_order_release);
+}
+
+void IdentityStore::LoadPasswd(Id host, std::int64_t time,
+                               std::string_view text) {
+  struct Entry {
+    std::uint32_t uid{0};
+    Id name{0};
+    std::uint32_t gid{0};
+  };
+  std::vector<Entry> entries{};
+  ForEachLine(text, [&](std::string_view line) {
+    // name:password:uid:gid
+    std::array<std::string_view, 4> fields{};
+    std::uint32_t uid{0};
+    std::uint32_t gid{0};
+    if (!SplitFields(line, &fields) || !ParseId(fields[2], &uid) ||
+        !ParseId(fields[3], &gid)) {
+      return;
+    }
+    entries.push_back({uid, names_.Intern(fields[0]), gid});
+  });
+  std::vector<std::uint32_t> present(entries.size());
+  for (std::size_t i{0}; i < entries.size(); ++i) present[i] = entries[i].uid;
+  std::sort(present.begin(), present.end());
+  std::unique_lock lock{mutex_};
+  for (const auto& entry : entries) {
+    AddVersion(&User(host, entry.uid), {time, entry.name, entry.gid});
+  }
+  for (auto& user : users_) {
+    if (user.host == host &&
+        !std::binary_search(present.begin(), present.end(), user.id)) {
+      Delete(&user, time);
+    }
+  }
+  Publish(&lock);
+}
+
+void IdentityStore::LoadGroup(Id host, std::int64_t time,
+                              std::string_view text) {
+  struct Entry {
+    std::uint32_t gid{0};
+    Id name{0};
+    std::vector<Id> members{};
+  };
+  std::vector<Entry> entries{};
+  ForEachLine(text, [&](std::string_view line) {
+    // name:password:gid:member,member
+    std::array<std::string_view, 4> fields{};
+    std::uint32_t gid{0};
+    if (!SplitFields(line, &fields) || !ParseId(fields[2], &gid)) return;
+    auto& entry{entries.emplace_back()};
+    entry.gid = gid;
+    entry.name = names_.Intern(fields[0]);
+    for (auto members{fields[3]}; !members.empty();) {
+      auto end{std::min(members.find(','), members.size())};
+      if (end > 0) {
+        entry.members.push_back(names_.Intern(members.substr(0, end)));
+      }
+      members.remove_prefix(std::min(end + 1, members.size()));
+    }
+  });
+  std::vector<std::uint32_t> present(entries.size());
+  for (std::size_t i{0}; i < entries.size(); ++i) present[i] = entries[i].gid;
+  std::sort(present.begin(), present.end());
+  std::unique_lock lock{mutex_};
+  for (const auto& entry : entries) {
+    auto& group{GroupOf(host, entry.gid)};
+    AddVersion(&group.account, {time, entry.name, 0});
+    for (auto member : entry.members) AddMembership(&group, {time, member});
+  }
+  for (auto& group : groups_) {
+    if (group.account.host == host &&
+        !std::binary_search(present.begin(), present.end(),
+                            group.account.id)) {
+      Delete(&group.account, time);
+    }
+  }
+  Publish(&lock);
+}
+
+void IdentityStore::Append(const Change& change) {
+  std::unique_lock lock{mutex_};
+  if (change.kind == Kind::kMember) {
+    // Groups are named, not numbered, in these records.
+    for (auto& group : groups_) {
+      if (group.account.host == change.host &&
+          VersionAt(group.account, change.time).name == change.group) {
+        AddMembership(&group, {change.time, change.name, !change.removed});
+      }
+    }
+  } else {
+    auto& account{change.kind == Kind::kUser
+                      ? User(change.host, change.id)
+                      : GroupOf(change.host, change.id).account};
+    Version version{change.time, change.name, 0, change.removed};
+    if (!account.versions.empty()) {
+      const auto& previous{VersionAt(account, change.time)};
+      version.gid = previous.gid;
+      // A deletion may only give the id.
+      if (version.name == 0) version.name = previous.name;
+    }
+    AddVersion(&account, version);
+  }
+  Publish(&lock);
+}
+
+IdentityStore::Name IdentityStore::UserName(Id host, std::uint32_t uid,
+                                            std::int64_t time) const {
+  std::shared_lock lock{mutex_};
+  auto it{user_ids_.find(Key(host, uid))};
+  return it == user_ids_.end() ? Name{} : NameAt(users_[it->second], time);
+}
+
+std::optional<IdentityStore::Name> IdentityStore::TryUserName(
+    Id host, std::uint32_t uid, std::int64_t time) const {
+  std::shared_lock lock{mutex_, std::try_to_lock};
+  if (!lock.owns_lock()) return std::nullopt;
+  auto it{user_ids_.find(Key(host, uid))};
+  return it == user_ids_.end() ? Name{} : NameAt(users_[it->second], time);
+}
+
+IdentityStore::Name IdentityStore::GroupName(Id host, std::uint32_t gid,
+                                             std::int64_t time) const {
+  std::shared_lock lock{mutex_};
+  auto it{group_ids_.find(Key(host, gid))};
+  return it == group_ids_.end() ? Name{}
+                                : NameAt(groups_[it->second].account, time);
+}
+
+IdentityStore::Users IdentityStore::UsersNamed(std::string_view name) const {
+  std::shared_lock lock{mutex_};
+  Users users{};
+  for (const auto& user : users_) {
+    if (EverNamed(user, name)) users.emplace_back(user.host, user.id);
+  }
+  std::sort(users.begin(), users.end());
+  return users;
+}
+
+IdentityStore::Users IdentityStore::MembersOf(std::string_view group) const {
+  std::shared_lock lock{mutex_};
+  Users users{};
+  for (const auto& candidate : groups_) {
+    const auto& account{candidate.account};
+    if (!EverNamed(account, group)) continue;
+    for (const auto& user : users_) {
+      if (user.host != account.host) continue;
+      auto named{[&user](Id name) {
+        return std::any_of(user.versions.begin(), user.versions.end(),
+                           [name](const Version& v) { return v.name == name; });
+      }};
+      bool member{std::any_of(
+          user.versions.begin(), user.versions.end(), [&](const Version& v) {
+            return !v.deleted && v.gid == account.id;
+          })};
+      for (const auto& membership : candidate.members) {
+        if (member) break;
+        member = membership.member && named(membership.user);
+      }
+      if (member) users.emplace_back(user.host, user.id);
+    }
+  }
+  std::sort(users.begin(), users.end());
+  users.erase(std::unique(users.begin(), users.end()), users.end());
+  return users;
+}
+
+}  // namespace audit
@@ -0,0 +1,150 @@
+#ifndef AUDIT_IDENTITY_STORE_H_
+#define AUDIT_IDENTITY_STORE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "audit/string_dictionary.h"
+
+namespace audit {
+
+// Users and groups of every host, behind the "Пользователи" and "Группы
+// пользователей" nodes. Each (host, uid) and (host, gid) is a dense id
+// with its names over time: passwd and group snapshots and audit records
+// of added, deleted and renamed accounts add versions, each valid from its
+// time until the next. Before its first version an account has the name of
+// that version. Names live in a StringDictionary, so the views returned
+// stay valid for the lifetime of the store.
+//
+// A group's members are the users whose primary gid is the group's, and the
+// users its snapshots or audit records listed, at any time. A single
+// writer adds while any number of readers resolve names.
+class IdentityStore {
+ public:
+  using Id = StringDictionary::Id;
+  // (host, uid) pairs, sorted.
+  using Users = std::vector<std::pair<Id, std::uint32_t>>;
+
+  enum class Kind : std::uint8_t { kUser, kGroup, kMember };
+
+  // Audit record of an account change, with its strings ids of Names():
+  // a user or group named `name` added as `id` or removed, or the user
+  // `name` added to or removed from the group `group`.
+  struct Change {
+    Kind kind{Kind::kUser};
+    std::int64_t time{0};
+    Id host{0};
+    std::uint32_t id{0};
+    Id name{0};
+    Id group{0};
+    bool removed{false};
+  };
+
+  // A name and the times it applies to, [from, to). The name is empty when
+  // the account is unknown or deleted.
+  struct Name {
+    std::string_view name{};
+    std::int64_t from{std::numeric_limits<std::int64_t>::min()};
+    std::int64_t to{std::numeric_limits<std::int64_t>::max()};
+  };
+
+  IdentityStore() = default;
+  IdentityStore(const IdentityStore&) = delete;
+  IdentityStore& operator=(const IdentityStore&) = delete;
+  IdentityStore(IdentityStore&&) = delete;
+  IdentityStore& operator=(IdentityStore&&) = delete;
+  ~IdentityStore() = default;
+
+  // Writer thread only. A snapshot holds every account of its host at
+  // `time`, so the accounts it lacks are deleted then. Malformed lines are
+  // skipped. Text is parsed before readers are locked out.
+  void LoadPasswd(Id host, std::int64_t time, std::string_view text);
+  void LoadGroup(Id host, std::int64_t time, std::string_view text);
+  void Append(const Change& change);
+  Id InternName(std::string_view name) { return names_.Intern(name); }
+  const StringDictionary& Names() const { return names_; }
+
+  std::size_t UserCount() const {
+    return user_count_.load(std::memory_order_acquire);
+  }
+  std::size_t GroupCount() const {
+    return group_count_.load(std::memory_order_acquire);
+  }
+  // Number of snapshots and records added, to tell when cached answers
+  // went stale. Moves after the writer lets go of the store.
+  std::size_t Changes() const {
+    return changes_.load(std::memory_order_acquire);
+  }
+  Name UserName(Id host, std::uint32_t uid, std::int64_t time) const;
+  // UserName() without waiting: unset while the writer holds the store.
+  std::optional<Name> TryUserName(Id host, std::uint32_t uid,
+                                  std::int64_t time) const;
+  Name GroupName(Id host, std::uint32_t gid, std::int64_t time) const;
+  // Users ever named `name`, and members of groups ever named `group`.
+  Users UsersNamed(std::string_view name) const;
+  Users MembersOf(std::string_view group) const;
+
+ private:
+  struct Version {
+    std::int64_t since{0};
+    Id name{0};
+    // Primary group of a user.
+    std::uint32_t gid{0};
+    // Deleted since, with the name it had.
+    bool deleted{false};
+  };
+  struct Account {
+    Id host{0};
+    std::uint32_t id{0};
+    // Sorted by time.
+    std::vector<Version> versions{};
+  };
+  struct Membership {
+    std::int64_t since{0};
+    Id user{0};
+    bool member{true};
+  };
+  struct Group {
+    Account account{};
+    std::vector<Membership> members{};
+  };
+
+  static std::uint64_t Key(Id host, std::uint32_t id) {
+    return std::uint64_t{host} << 32 | id;
+  }
+  static void AddVersion(Account* account, const Version& version);
+  // The version in effect at `time`, or the first one before it.
+  static const Version& VersionAt(const Account& account, std::int64_t time);
+  Name NameAt(const Account& account, std::int64_t time) const;
+  bool EverNamed(const Account& account, std::string_view name) const;
+  static void AddMembership(Group* group, const Membership& membership);
+  // Deletes at `time` an account that a snapshot lacks.
+  static void Delete(Account* account, std::int64_t time);
+  Account& User(Id host, std::uint32_t uid);
+  Group& GroupOf(Id host, std::uint32_t gid);
+  // Publishes the counts and changes of a snapshot or record.
+  void Publish(std::unique_lock<std::shared_mutex>* lock);
+
+  mutable std::shared_mutex mutex_{};
+  StringDictionary names_{};
+  std::vector<Account> users_{};
+  std::vector<Group> groups_{};
+  std::unordered_map<std::uint64_t, std::uint32_t> user_ids_{};
+  std::unordered_map<std::uint64_t, std::uint32_t> group_ids_{};
+  std::atomic<std::size_t> user_count_{0};
+  std::atomic<std::size_t> group_count_{0};
+  std::atomic<std::size_t> changes_{0};
+};
+
+}  // namespace audit
+
+#endif  // AUDIT_IDENTITY_STORE_H_
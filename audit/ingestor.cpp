@@ -0,0 +1,337 @@
+#include "audit/ingestor.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+
+#include "audit/mapped_file.h"
+
+namespace audit {
+
+namespace {
+
+template <typename T>
+T ToNumber(std::string_view text, int base = 10) {
+  T value{0};
+  std::from_chars(text.data(), text.data() + text.size(), value, base);
+  return value;
+}
+
+struct ExitSyscalls {
+  std::string_view arch;
+  std::string_view exit;
+  std::string_view exit_group;
+};
+
+constexpr std::array<ExitSyscalls, 3> kExitSyscalls{{
+    {"c000003e", "60", "231"},  // x86_64
+    {"40000003", "1", "252"},   // i386
+    {"c00000b7", "93", "94"},   // aarch64
+}};
+
+struct SocketSyscalls {
+  std::string_view arch;
+  std::string_view connect;
+  std::string_view accept;
+  std::string_view accept4;
+  std::string_view close;
+};
+
+// i386 sockets that go through socketcall() are not recognized.
+constexpr std::array<SocketSyscalls, 3> kSocketSyscalls{{
+    {"c000003e", "42", "43", "288", "3"},     // x86_64
+    {"40000003", "362", "", "364", "6"},      // i386
+    {"c00000b7", "203", "202", "242", "57"},  // aarch64
+}};
+
+constexpr std::string_view kInProgress{"-115"};
+
+// Reads the remote end from a sockaddr_in or sockaddr_in6, whose family is
+// in host order and port in network order.
+bool ParseSockaddr(std::string_view bytes, ConnectionStore::Address* address,
+                   std::uint16_t* port) {
+  auto byte{[bytes](std::size_t i) {
+    return static_cast<std::uint8_t>(bytes[i]);
+  }};
+  if (bytes.size() < 8) return false;
+  auto family{byte(0) | byte(1) << 8};
+  *port = static_cast<std::uint16_t>(byte(2) << 8 | byte(3));
+  if (family == 2) {
+    *address = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff,
+                byte(4), byte(5), byte(6), byte(7)};
+    return true;
+  }
+  if (family != 10 || bytes.size() < 24) return false;
+  for (std::size_t i{0}; i < address->size(); ++i) (*address)[i] = byte(8 + i);
+  return true;
+}
+
+// Matches EXECVE argument keys: "a3" and the chunked form "a3[1]".
+bool IsArgumentKey(std::string_view key, bool* continuation) {
+  if (key.size() < 2 || key[0] != 'a') return false;
+  std::size_t i{1};
+  while (i < key.size() && key[i] >= '0' && key[i] <= '9') ++i;
+  if (i == 1) return false;
+  *continuation = false;
+  if (i == key.size()) return true;
+  if (key[i] != '[') return false;
+  *continuation = key.substr(i) != "[0]";
+  return true;
+}
+
+}  // namespace
+
+bool BuildExecveEvent(const AuditEvent& event, DecodeBuffers* buffers,
+                      ExecveEvent* row) {
+  const AuditRecord* execve{event.Find("EXECVE")};
+  const AuditRecord* syscall{event.Find("SYSCALL")};
+  if (!execve || !syscall) return false;
+  row->time = event.time;
+  row->host = event.node;
+  row->uid = ToNumber<std::uint32_t>(syscall->Field("uid"));
+  row->pid = ToNumber<std::int32_t>(syscall->Field("pid"));
+  row->ppid = ToNumber<std::int32_t>(syscall->Field("ppid"));
+  AuditField field{};
+  buffers->command.clear();
+  if (syscall->Find("exe", &field)) AppendDecoded(field, &buffers->command);
+  row->command = buffers->command;
+  buffers->cwd.clear();
+  const AuditRecord* cwd{event.Find("CWD")};
+  if (cwd && cwd->Find("cwd", &field)) AppendDecoded(field, &buffers->cwd);
+  row->cwd = buffers->cwd;
+  buffers->args.clear();
+  execve->ForEachField([&](const AuditField& f) {
+    bool continuation{false};
+    if (!IsArgumentKey(f.key, &continuation)) return;
+    if (!continuation && !buffers->args.empty()) buffers->args.push_back(' ');
+    AppendDecoded(f, &buffers->args);
+  });
+  row->args = buffers->args;
+  return true;
+}
+
+bool BuildExitEvent(const AuditEvent& event, ExitEvent* exit) {
+  const AuditRecord* syscall{event.Find("SYSCALL")};
+  if (!syscall) return false;
+  auto arch{syscall->Field("arch")};
+  auto number{syscall->Field("syscall")};
+  bool found{false};
+  for (const auto& syscalls : kExitSyscalls) {
+    found |= arch == syscalls.arch &&
+             (number == syscalls.exit || number == syscalls.exit_group);
+  }
+  if (!found) return false;
+  exit->time = event.time;
+  exit->host = event.node;
+  exit->pid = ToNumber<std::int32_t>(syscall->Field("pid"));
+  // a0 is the full register, e.g. ffffffffffffffff for exit(-1); the
+  // parent only ever sees the low byte.
+  exit->code = static_cast<std::int32_t>(
+      ToNumber<std::uint64_t>(syscall->Field("a0"), 16) & 0xff);
+  return true;
+}
+
+bool BuildSocketEvent(const AuditEvent& event, DecodeBuffers* buffers,
+                      SocketEvent* socket) {
+  const AuditRecord* syscall{event.Find("SYSCALL")};
+  if (!syscall) return false;
+  auto arch{syscall->Field("arch")};
+  auto number{syscall->Field("syscall")};
+  const auto* syscalls{std::find_if(
+      kSocketSyscalls.begin(), kSocketSyscalls.end(),
+      [arch](const SocketSyscalls& s) { return s.arch == arch; })};
+  if (syscalls == kSocketSyscalls.end() || number.empty()) return false;
+  bool success{syscall->Field("success") == "yes"};
+  auto fd{syscall->Field("a0")};
+  if (number == syscalls->close) {
+    if (!success) return false;
+    socket->kind = ConnectionStore::Kind::kClose;
+  } else if (number == syscalls->connect) {
+    // A non-blocking connect fails with EINPROGRESS and goes on.
+    if (!success && syscall->Field("exit") != kInProgress) return false;
+    socket->kind = ConnectionStore::Kind::kConnect;
+  } else if (number == syscalls->accept || number == syscalls->accept4) {
+    if (!success) return false;
+    socket->kind = ConnectionStore::Kind::kAccept;
+  } else {
+    return false;
+  }
+  socket->time = event.time;
+  socket->host = event.node;
+  socket->uid = ToNumber<std::uint32_t>(syscall->Field("uid"));
+  socket->pid = ToNumber<std::int32_t>(syscall->Field("pid"));
+  socket->fd = socket->kind == ConnectionStore::Kind::kAccept
+                   ? ToNumber<std::int32_t>(syscall->Field("exit"))
+                   : static_cast<std::int32_t>(
+                         ToNumber<std::uint32_t>(fd, 16));
+  socket->command = {};
+  if (socket->kind == ConnectionStore::Kind::kClose) return true;
+  const AuditRecord* sockaddr{event.Find("SOCKADDR")};
+  AuditField field{};
+  if (!sockaddr || !sockaddr->Find("saddr", &field)) return false;
+  buffers->sockaddr.clear();
+  AppendDecoded(field, &buffers->sockaddr);
+  // Undecodable values are copied as they are.
+  if (2 * buffers->sockaddr.size() != field.value.size() ||
+      !ParseSockaddr(buffers->sockaddr, &socket->address, &socket->port)) {
+    return false;
+  }
+  buffers->command.clear();
+  if (syscall->Find("exe", &field)) AppendDecoded(field, &buffers->command);
+  socket->command = buffers->command;
+  return true;
+}
+
+bool BuildFileEvents(const AuditEvent& event, DecodeBuffers* buffers,
+                     std::vector<FileEvent>* files) {
+  files->clear();
+  const AuditRecord* syscall{event.Find("SYSCALL")};
+  if (!syscall) return false;
+  const AuditRecord* cwd{event.Find("CWD")};
+  AuditField field{};
+  std::size_t count{0};
+  for (const auto& record : event.records) {
+    if (record.type != "PATH" || record.Field("nametype") == "PARENT" ||
+        !record.Find("name", &field) || field.value == "(null)") {
+      continue;
+    }
+    if (count == buffers->paths.size()) buffers->paths.emplace_back();
+    auto& path{buffers->paths[count]};
+    path.clear();
+    AppendDecoded(field, &path);
+    if (path.empty()) continue;
+    if (path.front() != '/' && cwd && cwd->Find("cwd", &field)) {
+      buffers->cwd.clear();
+      AppendDecoded(field, &buffers->cwd);
+      if (buffers->cwd.empty() || buffers->cwd.back() != '/') {
+        buffers->cwd.push_back('/');
+      }
+      path.insert(0, buffers->cwd);
+    }
+    ++count;
+  }
+  if (count == 0) return false;
+  auto uid{ToNumber<std::uint32_t>(syscall->Field("uid"))};
+  auto pid{ToNumber<std::int32_t>(syscall->Field("pid"))};
+  for (std::size_t i{0}; i < count; ++i) {
+    files->push_back({event.time, event.node, uid, pid, buffers->paths[i]});
+  }
+  return true;
+}
+
+bool BuildLoginEvent(const AuditEvent& event, LoginEvent* login) {
+  using Kind = SessionStore::Kind;
+  if (event.records.empty()) return false;
+  const auto& record{event.records.front()};
+  Kind kind{Kind::kLogin};
+  if (record.type == "USER_LOGIN") {
+    if (record.Field("res") != "success") return false;
+  } else if (record.type == "USER_LOGOUT") {
+    kind = Kind::kLogout;
+  } else if (record.type == "USER_END") {
+    kind = Kind::kEnd;
+  } else if (record.type == "SYSTEM_BOOT" ||
+             record.type == "SYSTEM_SHUTDOWN") {
+    kind = Kind::kBoot;
+  } else {
+    return false;
+  }
+  // auid is only set by the login itself, while id names the user.
+  auto uid{record.Field("id")};
+  if (uid.empty()) uid = record.Field("auid");
+  auto session{record.Field("ses")};
+  auto origin{[&record](std::string_view key) {
+    auto value{record.Field(key)};
+    return value == "?" ? std::string_view{} : value;
+  }};
+  *login = {kind,
+            event.time,
+            event.node,
+            ToNumber<std::uint32_t>(uid),
+            ToNumber<std::int32_t>(record.Field("pid")),
+            session.empty() ? SessionStore::kNoSession
+                            : ToNumber<std::uint32_t>(session),
+            origin("terminal"),
+            origin("addr")};
+  return true;
+}
+
+bool BuildIdentityEvent(const AuditEvent& event, DecodeBuffers* buffers,
+                        IdentityEvent* identity) {
+  using Kind = IdentityStore::Kind;
+  if (event.records.empty()) return false;
+  const auto& record{event.records.front()};
+  auto type{record.type};
+  Kind kind{Kind::kUser};
+  bool removed{false};
+  if (type == "ADD_GROUP" || type == "DEL_GROUP") {
+    kind = Kind::kGroup;
+    removed = type == "DEL_GROUP";
+  } else if (type == "USER_MGMT" || type == "GRP_MGMT") {
+    // op=add-user-to-group grp="wheel" acct="alice"
+    kind = Kind::kMember;
+    auto op{record.Field("op")};
+    removed = op.substr(0, 3) != "add";
+    if (removed && op.substr(0, 3) != "del") return false;
+  } else if (type == "DEL_USER") {
+    removed = true;
+  } else if (type != "ADD_USER") {
+    return false;
+  }
+  if (record.Field("res") != "success") return false;
+  AuditField field{};
+  buffers->account.clear();
+  buffers->group.clear();
+  if (record.Find("acct", &field)) AppendDecoded(field, &buffers->account);
+  if (kind == Kind::kMember) {
+    if (!record.Find("grp", &field)) return false;
+    AppendDecoded(field, &buffers->group);
+    if (buffers->account.empty() || buffers->group.empty()) return false;
+  }
+  auto id{record.Field("id")};
+  if (kind != Kind::kMember && (id.empty() || id == "4294967295")) {
+    return false;
+  }
+  *identity = {kind,
+               event.time,
+               event.node,
+               ToNumber<std::uint32_t>(id),
+               buffers->account,
+               buffers->group,
+               removed};
+  return true;
+}
+
+Ingestor::Ingestor(EventStore* store)
+    : store_{store},
+      parser_{[this](const AuditEvent& event) { OnEvent(event); }} {}
+
+void Ingestor::IngestFile(const std::string& path) {
+  MappedFile file{path};
+  Ingest(file.Data());
+}
+
+void Ingestor::Ingest(std::string_view data) { parser_.Parse(data); }
+
+void Ingestor::OnEvent(const AuditEvent& event) {
+  ExecveEvent row{};
+  ExitEvent exit{};
+  SocketEvent socket{};
+  LoginEvent login{};
+  IdentityEvent identity{};
+  if (BuildExecveEvent(event, &buffers_, &row)) {
+    store_->Append(row);
+  } else if (BuildExitEvent(event, &exit)) {
+    store_->AppendExit(exit);
+  } else if (BuildSocketEvent(event, &buffers_, &socket)) {
+    store_->AppendSocket(socket);
+  } else if (BuildFileEvents(event, &buffers_, &files_)) {
+    for (const auto& file : files_) store_->AppendFile(file);
+  } else if (BuildLoginEvent(event, &login)) {
+    store_->AppendLogin(login);
+  } else if (BuildIdentityEvent(event, &buffers_, &identity)) {
+    store_->AppendIdentity(identity);
+  }
+}
+
+}  // namespace audit
@@ -0,0 +1,85 @@
+#ifndef AUDIT_INGESTOR_H_
+#define AUDIT_INGESTOR_H_
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "audit/audit_event.h"
+#include "audit/audit_log_parser.h"
+#include "audit/event_store.h"
+
+namespace audit {
+
+// Scratch space for values that auditd hex-encodes. Reused between events so
+// building a row does not allocate once the buffers have grown.
+struct DecodeBuffers {
+  std::string cwd{};
+  std::string command{};
+  std::string args{};
+  std::string sockaddr{};
+  std::string account{};
+  std::string group{};
+  // One per PATH record; only the first ones in use are cleared.
+  std::vector<std::string> paths{};
+};
+
+// Fills `row` from an event that carries an EXECVE record. The row borrows
+// from the event and from `buffers`.
+bool BuildExecveEvent(const AuditEvent& event, DecodeBuffers* buffers,
+                      ExecveEvent* row);
+
+// Fills `exit` from an event whose SYSCALL record is exit or exit_group.
+// The exit borrows from the event.
+bool BuildExitEvent(const AuditEvent& event, ExitEvent* exit);
+
+// Fills `socket` from an event whose SYSCALL record is a connect or accept
+// of an IPv4 or IPv6 socket that succeeded, or a close. The socket borrows
+// from the event and from `buffers`.
+bool BuildSocketEvent(const AuditEvent& event, DecodeBuffers* buffers,
+                      SocketEvent* socket);
+
+// Fills `files` with the paths of the PATH records of a syscall event, other
+// than the parent directories, relative ones joined to its CWD. Returns
+// false if there are none. The files borrow from `buffers`.
+bool BuildFileEvents(const AuditEvent& event, DecodeBuffers* buffers,
+                     std::vector<FileEvent>* files);
+
+// Fills `login` from a USER_LOGIN record of a successful login, a
+// USER_LOGOUT or USER_END record, or a SYSTEM_BOOT or SYSTEM_SHUTDOWN one.
+// The login borrows from the event.
+bool BuildLoginEvent(const AuditEvent& event, LoginEvent* login);
+
+// Fills `identity` from an ADD_USER, DEL_USER, ADD_GROUP or DEL_GROUP record,
+// or a USER_MGMT or GRP_MGMT one that adds a user to or removes one from a
+// group, that succeeded. The identity borrows from the event and from
+// `buffers`.
+bool BuildIdentityEvent(const AuditEvent& event, DecodeBuffers* buffers,
+                        IdentityEvent* identity);
+
+// Feeds audit.log data through the parser and appends the assembled process
+// creation, exit, socket, file, login and account events to the store.
+class Ingestor {
+ public:
+  explicit Ingestor(EventStore* store);
+  Ingestor(const Ingestor&) = delete;
+  Ingestor& operator=(const Ingestor&) = delete;
+  Ingestor(Ingestor&&) = delete;
+  Ingestor& operator=(Ingestor&&) = delete;
+  ~Ingestor() = default;
+
+  void IngestFile(const std::string& path);
+  void Ingest(std::string_view data);
+
+ private:
+  void OnEvent(const AuditEvent& event);
+
+  EventStore* store_;
+  AuditLogParser parser_;
+  DecodeBuffers buffers_{};
+  std::vector<FileEvent> files_{};
+};
+
+}  // namespace audit
+
+#endif  // AUDIT_INGESTOR_H_
@@ -0,0 +1,129 @@
+#include "audit/interval_tree.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace audit {
+
+std::size_t IntervalTree::Level(std::size_t node) {
+  std::size_t level{0};
+  for (; node & 1; node >>= 1) ++level;
+  return level;
+}
+
+// The old root becomes the left child of the new one, whose right subtree
+// holds no interval yet.
+void IntervalTree::Grow() {
+  if (max_ends_.empty()) {
+    max_ends_.assign(1, kNoEnd);
+    return;
+  }
+  auto old_root{(std::size_t{1} << root_level_) - 1};
+  ++root_level_;
+  max_ends_.resize((std::size_t{2} << root_level_) - 1, kNoEnd);
+  max_ends_[(std::size_t{1} << root_level_) - 1] = max_ends_[old_root];
+}
+
+void IntervalTree::Recompute(std::size_t node, std::size_t level) {
+  auto max_end{node < ends_.size() ? ends_[node] : kNoEnd};
+  if (level > 0) {
+    auto half{std::size_t{1} << (level - 1)};
+    max_end = std::max({max_end, max_ends_[node - half],
+                        max_ends_[node + half]});
+  }
+  max_ends_[node] = max_end;
+}
+
+void IntervalTree::Update(std::size_t node) {
+  for (auto level{Level(node)};; ++level) {
+    Recompute(node, level);
+    if (level == root_level_) break;
+    auto step{std::size_t{1} << level};
+    node = (node >> (level + 1)) & 1 ? node - step : node + step;
+  }
+}
+
+void IntervalTree::Rebuild(std::size_t first) {
+  for (std::size_t level{0}; level <= root_level_; ++level) {
+    auto span{std::size_t{2} << level};
+    // The subtree of node j * span + 2^level - 1 spans [j * span,
+    // (j + 1) * span - 1).
+    for (auto subtree{first / span * span}; subtree < begins_.size();
+         subtree += span) {
+      Recompute(subtree + (std::size_t{1} << level) - 1, level);
+    }
+  }
+}
+
+void IntervalTree::Insert(std::int64_t begin, std::int64_t end,
+                          Value value) {
+  if (begins_.size() == max_ends_.size()) Grow();
+  auto position{static_cast<std::size_t>(std::distance(
+      begins_.begin(), std::upper_bound(begins_.begin(), begins_.end(),
+                                        begin)))};
+  auto offset{static_cast<std::ptrdiff_t>(position)};
+  begins_.insert(begins_.begin() + offset, begin);
+  ends_.insert(ends_.begin() + offset, end);
+  values_.insert(values_.begin() + offset, value);
+  if (position + 1 == begins_.size()) {
+    Update(position);
+  } else {
+    Rebuild(position);
+  }
+}
+
+void IntervalTree::SetEnd(std::int64_t begin, Value value,
+                          std::int64_t end) {
+  auto position{static_cast<std::size_t>(std::distance(
+      begins_.begin(), std::lower_bound(begins_.begin(), begins_.end(),
+                                        begin)))};
+  for (; position < begins_.size() && begins_[position] == begin;
+       ++position) {
+    if (values_[position] != value) continue;
+    ends_[position] = end;
+    Update(position);
+    return;
+  }
+}
+
+std::size_t IntervalTree::Find(std::int64_t begin, std::int64_t end,
+                               std::size_t limit,
+                               std::vector<std::size_t>* values) const {
+  std::size_t total{0};
+  if (!max_ends_.empty()) {
+    Collect((std::size_t{1} << root_level_) - 1, root_level_, begin, end,
+            limit, values, &total);
+  }
+  return total;
+}
+
+void IntervalTree::Collect(std::size_t node, std::size_t level,
+                           std::int64_t begin, std::int64_t end,
+                           std::size_t limit,
+                           std::vector<std::size_t>* values,
+                           std::size_t* total) const {
+  // Nothing below ends after the range begins.
+  if (max_ends_[node] <= begin) return;
+  auto half{level > 0 ? std::size_t{1} << (level - 1) : 0};
+  if (level > 0) {
+    Collect(node - half, level - 1, begin, end, limit, values, total);
+  }
+  // Indexes past the last interval have none on their right either, and
+  // the ones right of an interval beginning after the range begin later.
+  if (node >= begins_.size() || begins_[node] >= end) return;
+  if (ends_[node] > begin) {
+    if ((*total)++ < limit) values->push_back(values_[node]);
+  }
+  if (level > 0) {
+    Collect(node + half, level - 1, begin, end, limit, values, total);
+  }
+}
+
+std::size_t IntervalTree::ByteSize() const {
+  return begins_.capacity() * sizeof(std::int64_t) +
+         ends_.capacity() * sizeof(std::int64_t) +
+         values_.capacity() * sizeof(Value) +
+         max_ends_.capacity() * sizeof(std::int64_t);
+}
+
+}  // namespace audit
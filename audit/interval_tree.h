@@ -0,0 +1,69 @@
+#ifndef AUDIT_INTERVAL_TREE_H_
+#define AUDIT_INTERVAL_TREE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace audit {
+
+// Intervals [begin, end) with a value each, kept sorted by begin and laid
+// out as an implicit binary search tree: a node of level k is an index
+// whose k lowest bits are set, and its children are 2^(k-1) below and
+// above it. Every node also holds the largest end in its subtree, so the
+// intervals overlapping a range are found in O(log n + k). Indexes past
+// the last interval, up to the next power of two, only hold the maximum
+// of their subtree.
+//
+// Appending in begin order updates one path to the root; an interval that
+// begins earlier than the last one shifts the ones after it.
+class IntervalTree {
+ public:
+  using Value = std::uint32_t;
+
+  IntervalTree() = default;
+  IntervalTree(const IntervalTree&) = delete;
+  IntervalTree& operator=(const IntervalTree&) = delete;
+  IntervalTree(IntervalTree&&) = delete;
+  IntervalTree& operator=(IntervalTree&&) = delete;
+  ~IntervalTree() = default;
+
+  void Insert(std::int64_t begin, std::int64_t end, Value value);
+  // Moves the end of the interval of `value` that begins at `begin`.
+  void SetEnd(std::int64_t begin, Value value, std::int64_t end);
+  // Appends the values of the first `limit` intervals overlapping
+  // [begin, end), in begin order, and returns how many overlap.
+  std::size_t Find(std::int64_t begin, std::int64_t end, std::size_t limit,
+                   std::vector<std::size_t>* values) const;
+  std::size_t Size() const { return begins_.size(); }
+  std::size_t ByteSize() const;
+
+ private:
+  static constexpr std::int64_t kNoEnd{
+      std::numeric_limits<std::int64_t>::min()};
+
+  // Number of trailing one bits.
+  static std::size_t Level(std::size_t node);
+  void Grow();
+  void Recompute(std::size_t node, std::size_t level);
+  // Recomputes `node` and its ancestors.
+  void Update(std::size_t node);
+  // Recomputes every node whose subtree holds an index from `first` on.
+  void Rebuild(std::size_t first);
+  void Collect(std::size_t node, std::size_t level, std::int64_t begin,
+               std::int64_t end, std::size_t limit,
+               std::vector<std::size_t>* values, std::size_t* total) const;
+
+  std::vector<std::int64_t> begins_{};
+  std::vector<std::int64_t> ends_{};
+  std::vector<Value> values_{};
+  // Largest end in the subtree of every node, 2^(root_level_ + 1) - 1 of
+  // them.
+  std::vector<std::int64_t> max_ends_{};
+  std::size_t root_level_{0};
+};
+
+}  // namespace audit
+
+#endif  // AUDIT_INTERVAL_TREE_H_
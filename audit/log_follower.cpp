@@ -0,0 +1,263 @@
+#include "audit/log_follower.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <utility>
+
+namespace audit {
+
+namespace {
+
+constexpr std::chrono::milliseconds kFullWait{1};
+
+}  // namespace
+
+LogFollower::LogFollower(std::string path, std::function<void()> notify)
+    : path_{std::move(path)},
+      notify_{std::move(notify)},
+      parser_{[this](const AuditEvent& event) { OnEvent(event); }},
+      buffer_(kReadSize) {
+  // A file that does not exist yet is read from its start once created.
+  if (Reopen()) offset_ = lseek(file_, 0, SEEK_END);
+  // The directory is watched so that a file created in place of a rotated
+  // or missing one wakes the thread too.
+  auto directory{std::filesystem::path{path_}.parent_path()};
+  if (directory.empty()) directory = ".";
+  inotify_ = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+  stop_event_ = eventfd(0, EFD_CLOEXEC);
+  if (inotify_ < 0 || stop_event_ < 0 ||
+      inotify_add_watch(inotify_, directory.c_str(),
+                        IN_MODIFY | IN_CREATE | IN_MOVED_TO) < 0) {
+    for (auto fd : {file_, inotify_, stop_event_}) {
+      if (fd >= 0) close(fd);
+    }
+    throw std::runtime_error("failed to watch " + path_ + "!");
+  }
+  thread_ = std::thread{&LogFollower::Run, this};
+}
+
+LogFollower::~LogFollower() {
+  stop_.store(true, std::memory_order_relaxed);
+  eventfd_write(stop_event_, 1);
+  thread_.join();
+  for (auto fd : {file_, inotify_, stop_event_}) {
+    if (fd >= 0) close(fd);
+  }
+}
+
+std::size_t LogFollower::Apply(EventStore* store, std::size_t limit) {
+  std::size_t count{0};
+  for (; count < limit; ++count) {
+    const auto* event{ring_.Front()};
+    if (!event) break;
+    switch (event->kind) {
+      case Event::Kind::kExecve:
+        store->Append(ExecveEvent{event->time, event->host, event->uid,
+                                  event->pid, event->ppid, event->cwd,
+                                  event->command, event->args});
+        break;
+      case Event::Kind::kExit:
+        store->AppendExit(
+            ExitEvent{event->time, event->host, event->pid, event->code});
+        break;
+      case Event::Kind::kSocket:
+        store->AppendSocket(SocketEvent{
+            event->socket, event->time, event->host, event->uid, event->pid,
+            event->fd, event->command, event->address, event->port});
+        break;
+      case Event::Kind::kFile:
+        store->AppendFile(FileEvent{event->time, event->host, event->uid,
+                                    event->pid, event->path});
+        break;
+      case Event::Kind::kLogin:
+        store->AppendLogin(LoginEvent{event->login, event->time, event->host,
+                                      event->uid, event->pid, event->session,
+                                      event->terminal, event->remote});
+        break;
+      case Event::Kind::kIdentity:
+        store->AppendIdentity(IdentityEvent{event->identity, event->time,
+                                            event->host, event->id,
+                                            event->name, event->group,
+                                            event->removed});
+        break;
+    }
+    ring_.Pop();
+  }
+  return count;
+}
+
+void LogFollower::Run() {
+  std::array<pollfd, 2> fds{{{inotify_, POLLIN, 0}, {stop_event_, POLLIN, 0}}};
+  alignas(inotify_event) std::array<char, 4096> events{};
+  while (!stop_.load(std::memory_order_relaxed)) {
+    // The rest of a rotated file is read before switching to the new one.
+    ReadAppended();
+    if (Replaced() && Reopen()) continue;
+    if (poll(fds.data(), fds.size(), -1) < 0 && errno != EINTR) break;
+    if (fds[1].revents & POLLIN) break;
+    // Which file changed does not matter; every wake reads and checks.
+    while (read(inotify_, events.data(), events.size()) > 0) {
+    }
+  }
+}
+
+bool LogFollower::Reopen() {
+  int file{open(path_.c_str(), O_RDONLY | O_CLOEXEC)};
+  if (file < 0) return false;
+  if (file_ >= 0) close(file_);
+  file_ = file;
+  offset_ = 0;
+  buffered_ = 0;
+  return true;
+}
+
+// Whether `path_` now names another file than the one being read, or
+// names one at all while none is.
+bool LogFollower::Replaced() const {
+  struct stat named {};
+  struct stat current {};
+  if (stat(path_.c_str(), &named) != 0) return false;
+  if (fstat(file_, &current) != 0) return true;
+  return named.st_ino != current.st_ino || named.st_dev != current.st_dev;
+}
+
+void LogFollower::ReadAppended() {
+  if (file_ < 0) return;
+  struct stat st {};
+  if (fstat(file_, &st) == 0 && st.st_size < offset_) {
+    lseek(file_, 0, SEEK_SET);
+    offset_ = 0;
+    buffered_ = 0;
+  }
+  while (!stop_.load(std::memory_order_relaxed)) {
+    // Only a line longer than the buffer fills it.
+    if (buffered_ == buffer_.size()) buffer_.resize(2 * buffer_.size());
+    auto read_size{read(file_, buffer_.data() + buffered_,
+                        buffer_.size() - buffered_)};
+    if (read_size < 0 && errno == EINTR) continue;
+    if (read_size <= 0) break;
+    offset_ += read_size;
+    auto size{buffered_ + static_cast<std::size_t>(read_size)};
+    auto consumed{parser_.Feed({buffer_.data(), size})};
+    // Events still waiting for EOE must not point into the buffer.
+    parser_.Detach();
+    buffered_ = size - consumed;
+    std::memmove(buffer_.data(), buffer_.data() + consumed, buffered_);
+    if (pushed_) {
+      pushed_ = false;
+      notify_();
+    }
+  }
+}
+
+void LogFollower::OnEvent(const AuditEvent& event) {
+  ExecveEvent row{};
+  ExitEvent exit{};
+  SocketEvent socket{};
+  LoginEvent login{};
+  IdentityEvent identity{};
+  auto kind{Event::Kind::kExecve};
+  if (!BuildExecveEvent(event, &buffers_, &row)) {
+    if (BuildExitEvent(event, &exit)) {
+      kind = Event::Kind::kExit;
+    } else if (BuildSocketEvent(event, &buffers_, &socket)) {
+      kind = Event::Kind::kSocket;
+    } else if (BuildFileEvents(event, &buffers_, &files_)) {
+      kind = Event::Kind::kFile;
+    } else if (BuildLoginEvent(event, &login)) {
+      kind = Event::Kind::kLogin;
+    } else if (BuildIdentityEvent(event, &buffers_, &identity)) {
+      kind = Event::Kind::kIdentity;
+    } else {
+      return;
+    }
+  }
+  if (kind == Event::Kind::kFile) {
+    for (const auto& file : files_) {
+      auto* slot{WaitForSlot()};
+      if (!slot) return;
+      slot->kind = kind;
+      slot->time = file.time;
+      slot->host.assign(file.host);
+      slot->uid = file.uid;
+      slot->pid = file.pid;
+      slot->path.assign(file.path);
+      ring_.Push();
+      pushed_ = true;
+    }
+    return;
+  }
+  auto* slot{WaitForSlot()};
+  if (!slot) return;
+  slot->kind = kind;
+  if (kind == Event::Kind::kExecve) {
+    slot->time = row.time;
+    slot->host.assign(row.host);
+    slot->uid = row.uid;
+    slot->pid = row.pid;
+    slot->ppid = row.ppid;
+    slot->cwd.assign(row.cwd);
+    slot->command.assign(row.command);
+    slot->args.assign(row.args);
+  } else if (kind == Event::Kind::kExit) {
+    slot->time = exit.time;
+    slot->host.assign(exit.host);
+    slot->pid = exit.pid;
+    slot->code = exit.code;
+  } else if (kind == Event::Kind::kLogin) {
+    slot->login = login.kind;
+    slot->time = login.time;
+    slot->host.assign(login.host);
+    slot->uid = login.uid;
+    slot->pid = login.pid;
+    slot->session = login.session;
+    slot->terminal.assign(login.terminal);
+    slot->remote.assign(login.address);
+  } else if (kind == Event::Kind::kIdentity) {
+    slot->identity = identity.kind;
+    slot->time = identity.time;
+    slot->host.assign(identity.host);
+    slot->id = identity.id;
+    slot->name.assign(identity.name);
+    slot->group.assign(identity.group);
+    slot->removed = identity.removed;
+  } else {
+    slot->socket = socket.kind;
+    slot->time = socket.time;
+    slot->host.assign(socket.host);
+    slot->uid = socket.uid;
+    slot->pid = socket.pid;
+    slot->fd = socket.fd;
+    slot->command.assign(socket.command);
+    slot->address = socket.address;
+    slot->port = socket.port;
+  }
+  ring_.Push();
+  pushed_ = true;
+}
+
+// Backpressure: waits for the consumer rather than dropping or buffering.
+LogFollower::Event* LogFollower::WaitForSlot() {
+  while (true) {
+    if (auto* slot{ring_.Back()}) return slot;
+    if (stop_.load(std::memory_order_relaxed)) return nullptr;
+    if (pushed_) {
+      pushed_ = false;
+      notify_();
+    }
+    std::this_thread::sleep_for(kFullWait);
+  }
+}
+
+}  // namespace audit
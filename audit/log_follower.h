@@ -0,0 +1,106 @@
+#ifndef AUDIT_LOG_FOLLOWER_H_
+#define AUDIT_LOG_FOLLOWER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "audit/audit_event.h"
+#include "audit/audit_log_parser.h"
+#include "audit/event_store.h"
+#include "audit/ingestor.h"
+#include "audit/spsc_ring.h"
+
+namespace audit {
+
+// Follows a growing audit.log like `tail -F`. A thread woken by inotify
+// parses the bytes appended since its last read and hands the events to a
+// single consumer through a ring. When the file is rotated or recreated,
+// the rest of the old file is read and the new one is followed from its
+// start; a truncated file is reread from its start. While the ring is full
+// the thread stops reading, so a slow consumer bounds memory, not input.
+class LogFollower {
+ public:
+  // A creation, exit, socket, file access, login or account change copied
+  // out of the parser. Ring slots are reused, so the strings keep their
+  // capacity.
+  struct Event {
+    enum class Kind { kExecve, kExit, kSocket, kFile, kLogin, kIdentity };
+    Kind kind{Kind::kExecve};
+    std::int64_t time{0};
+    std::string host{};
+    std::uint32_t uid{0};
+    std::int32_t pid{0};
+    std::int32_t ppid{0};
+    std::int32_t code{0};
+    std::string cwd{};
+    std::string command{};
+    std::string args{};
+    ConnectionStore::Kind socket{ConnectionStore::Kind::kConnect};
+    std::int32_t fd{0};
+    ConnectionStore::Address address{};
+    std::uint16_t port{0};
+    std::string path{};
+    SessionStore::Kind login{SessionStore::Kind::kLogin};
+    std::uint32_t session{SessionStore::kNoSession};
+    std::string terminal{};
+    std::string remote{};
+    IdentityStore::Kind identity{IdentityStore::Kind::kUser};
+    std::uint32_t id{0};
+    std::string name{};
+    std::string group{};
+    bool removed{false};
+  };
+
+  // Follows `path` from its current end, or from its start once it is
+  // created if it does not exist yet; only its directory must. `notify`
+  // runs on the follower thread whenever events were pushed.
+  LogFollower(std::string path, std::function<void()> notify);
+  LogFollower(const LogFollower&) = delete;
+  LogFollower& operator=(const LogFollower&) = delete;
+  LogFollower(LogFollower&&) = delete;
+  LogFollower& operator=(LogFollower&&) = delete;
+  ~LogFollower();
+
+  // Consumer: appends at most `limit` events to `store` in arrival order
+  // and returns how many. The caller must be the store's writer.
+  std::size_t Apply(EventStore* store, std::size_t limit);
+  // Consumer: whether events are waiting.
+  bool Pending() const { return !ring_.Empty(); }
+
+ private:
+  static constexpr std::size_t kRingCapacity{std::size_t{1} << 15};
+  static constexpr std::size_t kReadSize{std::size_t{1} << 20};
+
+  void Run();
+  bool Reopen();
+  bool Replaced() const;
+  void ReadAppended();
+  void OnEvent(const AuditEvent& event);
+  Event* WaitForSlot();
+
+  std::string path_;
+  std::function<void()> notify_;
+  SpscRing<Event> ring_{kRingCapacity};
+  AuditLogParser parser_;
+  DecodeBuffers buffers_{};
+  std::vector<FileEvent> files_{};
+  // Holds a partial last line between reads.
+  std::vector<char> buffer_{};
+  std::size_t buffered_{0};
+  std::int64_t offset_{0};
+  bool pushed_{false};
+  int file_{-1};
+  int inotify_{-1};
+  int stop_event_{-1};
+  std::atomic<bool> stop_{false};
+  std::thread thread_{};
+};
+
+}  // namespace audit
+
+#endif  // AUDIT_LOG_FOLLOWER_H_
@@ -1,10 +1,113 @@
+#include <sys/stat.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
 
 #include "audit/mainwindow.h"
+#include "audit/mapped_file.h"
+#include "audit/parallel_ingestor.h"
+#include "audit/synthetic.h"
+
+namespace {
+
+using imgui_glfw_vulkan::FrameStats;
+
+void PrintFrameStats(const FrameStats& stats) {
+  auto frames{stats.Snapshot()};
+  std::printf("%zu frames\n%-14s %10s %10s\n", frames.size(), "phase",
+              "p50_ms", "p99_ms");
+  for (int i{0}; i < FrameStats::kPhaseCount; ++i) {
+    auto phase{static_cast<FrameStats::Phase>(i)};
+    std::printf("%-14s %10.3f %10.3f\n", FrameStats::kPhaseNames[phase],
+                static_cast<double>(FrameStats::Quantile(frames, phase, 0.5)),
+                static_cast<double>(FrameStats::Quantile(frames, phase, 0.99)));
+  }
+}
+
+// Loads HOST=PATH, a passwd or group file of HOST, as of when the file
+// was last modified.
+void LoadAccounts(audit::MainWindow* app, const std::string& argument,
+                  bool groups) {
+  auto equals{argument.find('=')};
+  if (equals == std::string::npos) {
+    throw std::runtime_error("expected HOST=PATH: " + argument);
+  }
+  app->Load([host = argument.substr(0, equals),
+             path = argument.substr(equals + 1),
+             groups](audit::EventStore* store) {
+    struct stat st {};
+    if (stat(path.c_str(), &st) != 0) {
+      throw std::runtime_error("cannot stat " + path);
+    }
+    auto time{std::int64_t{st.st_mtim.tv_sec} * 1000 +
+              st.st_mtim.tv_nsec / 1000000};
+    audit::MappedFile file{path};
+    if (groups) {
+      store->LoadGroup(host, time, file.Data());
+    } else {
+      store->LoadPasswd(host, time, file.Data());
+    }
+  });
+}
+
+}  // namespace
 
-int main() try {
-  audit::MainWindow app{};
-  app.Run();
+// --headless N renders N frames offscreen once the loads are done, prints
+// per-phase percentiles and writes frame_times.csv. --passwd HOST=PATH and
+// --group HOST=PATH load the accounts of a host.
+int main(int argc, char* argv[]) try {
+  std::optional<std::size_t> headless_frames{};
+  for (int i{1}; i + 1 < argc; ++i) {
+    if (std::strcmp(argv[i], "--headless") == 0) {
+      headless_frames = std::stoul(argv[i + 1]);
+    }
+  }
+  audit::MainWindow app{
+      "window", headless_frames ? 1920 : 800, headless_frames ? 1080 : 600,
+      headless_frames ? audit::MainWindow::Target::kOffscreen
+                      : audit::MainWindow::Target::kWindow};
+  for (int i{1}; i + 1 < argc; ++i) {
+    if (std::strcmp(argv[i], "--db") == 0) app.Open(argv[i + 1]);
+  }
+  for (int i{1}; i + 1 < argc; ++i) {
+    if (std::strcmp(argv[i], "--synthetic") == 0) {
+      app.Load([rows = std::stoul(argv[++i])](audit::EventStore* store) {
+        audit::FillSynthetic(rows, store);
+      });
+    } else if (std::strcmp(argv[i], "--log") == 0) {
+      app.Load([path = std::string{argv[++i]}](audit::EventStore* store) {
+        audit::ThreadPool pool{};
+        audit::ParallelIngestor ingestor{store, &pool};
+        ingestor.IngestFile(path);
+      });
+    } else if (std::strcmp(argv[i], "--passwd") == 0) {
+      LoadAccounts(&app, argv[++i], false);
+    } else if (std::strcmp(argv[i], "--group") == 0) {
+      LoadAccounts(&app, argv[++i], true);
+    } else if (std::strcmp(argv[i], "--follow") == 0) {
+      app.Follow(argv[++i]);
+    } else if (std::strcmp(argv[i], "--db") == 0 ||
+               std::strcmp(argv[i], "--headless") == 0) {
+      ++i;
+    }
+  }
+  if (!headless_frames) {
+    app.Run();
+    return 0;
+  }
+  while (app.Loading()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+  }
+  app.RunFrames(*headless_frames);
+  PrintFrameStats(app.Stats());
+  app.Stats().WriteCsv("frame_times.csv");
   return 0;
 } catch (const std::exception& e) {
   std::cerr << e.what() << std::endl;
@@ -1,19 +1,165 @@
 #include "audit/mainwindow.h"
 
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cfloat>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
 #include <iostream>
+#include <stdexcept>
+#include <string_view>
+
+#include "audit/timestamp.h"
 
 namespace audit {
 
-MainWindow::MainWindow(std::string_view name, int width, int height)
-    : ImGuiGlfwVulkan{name, width, height, kConfigFlags} {
-  io_->Fonts->AddFontFromFileTTF(
+namespace {
+
+// Accepts "N" or "N-M".
+template <typename T>
+EventFilter::Range<T> ParseRange(const char* text) {
+  std::string_view input{text};
+  if (input.empty()) return std::nullopt;
+  auto dash{input.find('-', 1)};
+  auto first{input.substr(0, dash)};
+  auto last{dash == std::string_view::npos ? first : input.substr(dash + 1)};
+  T lo{};
+  T hi{};
+  if (std::from_chars(first.data(), first.data() + first.size(), lo).ec !=
+          std::errc{} ||
+      std::from_chars(last.data(), last.data() + last.size(), hi).ec !=
+          std::errc{}) {
+    return std::nullopt;
+  }
+  return std::pair{lo, hi};
+}
+
+// "1.250 с" under a minute, then "12:05" or "3:12:05".
+void FormatDuration(std::int64_t ms, char (&text)[32]) {
+  if (ms < 60000) {
+    std::snprintf(text, sizeof(text), "%.3f с", static_cast<double>(ms) / 1e3);
+    return;
+  }
+  auto seconds{ms / 1000};
+  if (seconds < 3600) {
+    std::snprintf(text, sizeof(text), "%lld:%02lld",
+                  static_cast<long long>(seconds / 60),
+                  static_cast<long long>(seconds % 60));
+  } else {
+    std::snprintf(text, sizeof(text), "%lld:%02lld:%02lld",
+                  static_cast<long long>(seconds / 3600),
+                  static_cast<long long>(seconds / 60 % 60),
+                  static_cast<long long>(seconds % 60));
+  }
+}
+
+// Arguments are shown as stored unless they hold control bytes, such as
+// the newlines of hex-decoded arguments, which are escaped into `escaped`.
+void EscapeArgs(std::string_view args, std::string* escaped) {
+  auto control{[](char c) {
+    return static_cast<unsigned char>(c) < 0x20 || c == '\x7f';
+  }};
+  if (std::none_of(args.begin(), args.end(), control)) return;
+  for (char c : args) {
+    if (!control(c)) {
+      escaped->push_back(c);
+    } else if (c == '\n') {
+      escaped->append("\\n");
+    } else if (c == '\t') {
+      escaped->append("\\t");
+    } else {
+      char hex[8];
+      std::snprintf(hex, sizeof(hex), "\\x%02x", static_cast<unsigned char>(c));
+      escaped->append(hex);
+    }
+  }
+}
+
+}  // namespace
+
+MainWindow::MainWindow(std::string_view name, int width, int height,
+                       Target target)
+    : ImGuiGlfwVulkan{name, width, height, kConfigFlags, target} {
+  constexpr const char* kFont{
       "/home/nikita/documents/projects/c_c++/audit/imgui_glfw_vulkan/imgui/"
-      "misc/fonts/Roboto-Medium.ttf",
-      20.f, nullptr, io_->Fonts->GetGlyphRangesCyrillic());
+      "misc/fonts/Roboto-Medium.ttf"};
+  // Benchmark machines may not have it; ImGui asserts on a missing file.
+  if (std::filesystem::exists(kFont)) {
+    io_->Fonts->AddFontFromFileTTF(kFont, 20.f, nullptr,
+                                   io_->Fonts->GetGlyphRangesCyrillic());
+  }
   ImGui::StyleColorsLight();
+  SetLoopMode(LoopMode::kOnDemand);
+}
+
+void MainWindow::Open(const std::string& directory) {
+  database_ = std::make_unique<Database>(directory);
+  database_->Open(&events_);
+  // Mapped strings are indexed in the background; until then substring
+  // filters compare them directly.
+  Load([](EventStore*) {});
+}
+
+void MainWindow::Load(std::function<void(EventStore*)> load) {
+  ++loading_;
+  auto posted{executor_.Post([this, load = std::move(load)] {
+    try {
+      std::lock_guard lock{load_mutex_};
+      load(&events_);
+      events_.UpdateIndexes();
+      if (database_) database_->Sync(events_);
+    } catch (const std::exception& e) {
+      std::cerr << e.what() << std::endl;
+    }
+    --loading_;
+    Wake();
+  })};
+  if (!posted) --loading_;
+}
+
+void MainWindow::Follow(const std::string& path) {
+  follower_ = std::make_unique<LogFollower>(path, [this] { Wake(); });
+}
+
+// The render thread only posts: a worker becomes the store's writer for a
+// batch and indexes it, so appends and index updates never take the side
+// stores' locks on the render thread. While a load holds the store the
+// events wait in the ring.
+void MainWindow::ApplyTail() {
+  if (!follower_) return;
+  // One batch at a time; events arriving meanwhile wait for the next one.
+  if (follower_->Pending() && !tail_applying_.exchange(true)) {
+    auto posted{executor_.Post([this] {
+      try {
+        std::lock_guard lock{load_mutex_};
+        if (follower_->Apply(&events_, kTailBatch) > 0) {
+          events_.UpdateIndexes();
+          tail_unsynced_ = true;
+        }
+      } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+      }
+      tail_applying_ = false;
+      Wake();
+    })};
+    if (!posted) tail_applying_ = false;
+  }
+  // Persisting is left to a worker, at most once per kTailSync and only
+  // when something arrived.
+  auto now{std::chrono::steady_clock::now()};
+  if (database_ && now - tail_synced_ >= kTailSync &&
+      tail_unsynced_.exchange(false)) {
+    tail_synced_ = now;
+    Load([](EventStore*) {});
+  }
 }
 
 void MainWindow::Render() {
+  auto start{std::chrono::steady_clock::now()};
+  ApplyTail();
   ImGuiViewport* viewport{ImGui::GetMainViewport()};
   ImGui::SetNextWindowPos(viewport->Pos);
   ImGui::SetNextWindowSize(viewport->Size);
@@ -30,6 +176,18 @@ void MainWindow::Render() {
   ImGui::EndChild();
   ImGui::End();
   // ImGui::ShowDemoWindow(nullptr);
+  std::chrono::duration<double, std::micro> elapsed{
+      std::chrono::steady_clock::now() - start};
+  render_time_us_ = render_time_us_ * 0.95 + elapsed.count() * 0.05;
+  // Rows keep arriving and results may land at any moment.
+  if (loading_ > 0 || filter_query_.Running() ||
+      (sort_ && (sort_query_.Running() || sort_rows_ != events_.Size())) ||
+      rollup_query_.Running() || files_query_.Running() ||
+      merge_query_.Running() || connections_query_.Running() ||
+      sessions_query_.Running() || group_query_.Running() ||
+      (follower_ && (follower_->Pending() || tail_applying_))) {
+    RequestRedraw(kBusyRedraw);
+  }
 }
 
 void MainWindow::DrawLeft() {
@@ -57,30 +215,41 @@ void MainWindow::DrawLeft() {
     node_open = ImGui::TreeNodeEx("Пользователи", node_flags);
     if (ImGui::IsItemClicked() && !ImGui::IsItemToggledOpen()) selected = 2;
     if (node_open) {
-      ImGui::BulletText("Blah blah\nBlah Blah");
+      ImGui::BulletText("Учётных записей: %zu",
+                        events_.Identities().UserCount());
       ImGui::TreePop();
     }
 
     if (ImGui::TreeNode("Группы пользователей")) {
+      DrawGroups();
+      ImGui::TreePop();
     }
 
     if (ImGui::TreeNode("Вход пользователей в систему")) {
+      DrawSessions();
       ImGui::TreePop();
     }
 
     if (ImGui::TreeNode("Создание процессов")) {
+      ImGui::BulletText("Строк: %zu", events_.Size());
+      if (database_) {
+        ImGui::BulletText("Сегментов: %zu", database_->SegmentCount());
+      }
       ImGui::TreePop();
     }
 
     if (ImGui::TreeNode("Файлы")) {
+      DrawFiles();
       ImGui::TreePop();
     }
 
     if (ImGui::TreeNode("TCP-соединения")) {
+      DrawConnections();
       ImGui::TreePop();
     }
 
     if (ImGui::TreeNode("Завершение процессов")) {
+      ImGui::BulletText("Строк: %zu", events_.ExitCount());
       ImGui::TreePop();
     }
 
@@ -90,9 +259,72 @@ void MainWindow::DrawLeft() {
 }
 
 void MainWindow::DrawRight() {
+  user_names_.clear();
   ImGui::SetNextItemWidth(20.f);
   ImGui::SeparatorText("События");
-  if (ImGui::BeginTable("split", 8, ImGuiTableFlags_Resizable | ImGuiTableFlags_Borders)) {
+  DrawFilters();
+  auto size{events_.Size()};
+  if (!filter_.Empty() && !filter_query_.Running() && filter_rows_ != size) {
+    SubmitFilter();
+  }
+  std::shared_ptr<const Selection> selection{};
+  if (!filter_.Empty()) selection = filter_query_.Snapshot();
+  // Until the index of the sorted column is ready the rows stay unsorted;
+  // while it catches up with new rows the previous one is shown.
+  std::shared_ptr<const SortedRows> sorted{};
+  if (sort_) {
+    sorted = sort_query_.Snapshot();
+    if (sorted) {
+      sort_indexes_[static_cast<std::size_t>(sorted->index->GetColumn())] =
+          sorted->index;
+      if (sorted->index->GetColumn() != sort_->column ||
+          (sorted->selection != nullptr) == filter_.Empty()) {
+        sorted = nullptr;
+      }
+    }
+    // Extending an index copies it, so appended rows alone are sorted in
+    // only once they add a fraction of it or kSortInterval passed.
+    auto grown{size > sort_rows_ &&
+               (size - sort_rows_ >= sort_rows_ / kSortGrowth ||
+                std::chrono::steady_clock::now() - sort_submitted_ >=
+                    kSortInterval)};
+    if (!sort_query_.Running() && (filter_.Empty() || selection) &&
+        (sort_column_ != sort_->column || grown ||
+         sort_selection_ != selection)) {
+      SubmitSort(size, selection);
+    }
+  }
+  auto count{sorted            ? sorted->Rows().size()
+             : filter_.Empty() ? size
+             : selection       ? selection->Count()
+                               : 0};
+  ImGui::Text("Строк: %zu из %zu, кадр: %.1f мкс%s%s%s", count, size,
+              render_time_us_, loading_ > 0 ? ", загрузка..." : "",
+              filter_query_.Running() ? ", поиск..." : "",
+              sort_ && sort_query_.Running() ? ", сортировка..." : "");
+  if (follower_) {
+    ImGui::SameLine();
+    ImGui::Checkbox("Следить за концом", &follow_tail_);
+  }
+  if (!rollup_query_.Running() &&
+      (rollup_rows_ != events_.Aggregates().Size() ||
+       rollup_time_ != filter_.time)) {
+    SubmitRollups();
+  }
+  const auto& rollup{rollup_query_.Snapshot()};
+  if (rollup && !rollup->bars.empty()) {
+    constexpr std::array<const char*, Rollups::kLevelCount> kLevelNames{
+        "событий в минуту", "событий в час", "событий в день"};
+    ImGui::PlotHistogram(
+        "##histogram", rollup->bars.data(),
+        static_cast<int>(rollup->bars.size()), 0,
+        kLevelNames[static_cast<std::size_t>(rollup->level)], 0.f, FLT_MAX,
+        {-FLT_MIN, 80.f});
+  }
+  auto table_width{ImGui::GetContentRegionAvail().x * 0.75f};
+  ImGui::BeginChild("Events", {table_width, 0});
+  if (ImGui::BeginTable("split", 11, kEventsTableFlags)) {
+    ImGui::TableSetupScrollFreeze(0, 1);
     ImGui::TableSetupColumn("Дата");
     ImGui::TableSetupColumn("ID хоста");
     ImGui::TableSetupColumn("UID");
@@ -101,15 +333,649 @@ void MainWindow::DrawRight() {
     ImGui::TableSetupColumn("Рабочий каталог");
     ImGui::TableSetupColumn("Команда");
     ImGui::TableSetupColumn("Аргументы");
+    // Exits are joined as they arrive, so these columns have no index.
+    ImGui::TableSetupColumn("Завершение", ImGuiTableColumnFlags_NoSort);
+    ImGui::TableSetupColumn("Длительность", ImGuiTableColumnFlags_NoSort);
+    ImGui::TableSetupColumn("Код выхода", ImGuiTableColumnFlags_NoSort);
+    if (auto* specs{ImGui::TableGetSortSpecs()}; specs && specs->SpecsDirty) {
+      // The first columns are in the order of EventStore::Column.
+      sort_.reset();
+      if (specs->SpecsCount > 0) {
+        sort_ = SortSpec{
+            static_cast<EventStore::Column>(specs->Specs[0].ColumnIndex),
+            specs->Specs[0].SortDirection == ImGuiSortDirection_Descending};
+      }
+      specs->SpecsDirty = false;
+      RequestRedraw(kBusyRedraw);
+    }
     ImGui::TableHeadersRow();
-    for (int i = 0; i < 96; i++) {
+    UpdateCells();
+    ImGuiListClipper clipper{};
+    clipper.Begin(static_cast<int>(std::min<std::size_t>(count, INT_MAX)));
+    while (clipper.Step()) {
+      auto first{static_cast<std::size_t>(clipper.DisplayStart)};
+      auto last{static_cast<std::size_t>(clipper.DisplayEnd)};
+      if (sorted) {
+        const auto& rows{sorted->Rows()};
+        visible_ids_.clear();
+        for (auto rank{first}; rank < last; ++rank) {
+          visible_ids_.push_back(
+              rows[sort_->descending ? rows.size() - 1 - rank : rank]);
+        }
+      } else if (selection) {
+        visible_ids_.clear();
+        selection->Select(first, last, &visible_ids_);
+      } else {
+        // Sharded rows in time order across hosts, then the rows not
+        // sharded yet in arrival order. The merge is redone on a worker
+        // only when the window or the shards changed; until it lands, the
+        // ranks it does not cover are shown in arrival order too. The first
+        // step of a fresh clipper only measures a row, so the window is
+        // taken from the visible range that follows.
+        auto sharded{std::min(events_.Shards().Size(), size)};
+        std::array<std::size_t, 3> window{first, last, sharded};
+        if (clipper.ItemsHeight > 0.f && window != merged_window_ &&
+            !merge_query_.Running()) {
+          merged_window_ = window;
+          SubmitMerge(first, std::min(last, sharded));
+        }
+        const auto& merged{merge_query_.Snapshot()};
+        visible_ids_.clear();
+        for (auto rank{first}; rank < last; ++rank) {
+          auto covered{merged && rank >= merged->first &&
+                       rank - merged->first < merged->rows.size()};
+          visible_ids_.push_back(covered ? merged->rows[rank - merged->first]
+                                         : rank);
+        }
+      }
+      FormatCells();
+      for (auto row : visible_ids_) DrawEventRow(row, cells_.find(row)->second);
+    }
+    if (follower_ && follow_tail_) ImGui::SetScrollY(ImGui::GetScrollMaxY());
+    ImGui::EndTable();
+  }
+  for (auto it{cells_.begin()}; it != cells_.end();) {
+    it = it->second.frame != frame_ ? cells_.erase(it) : std::next(it);
+  }
+  ImGui::EndChild();
+  ImGui::SameLine();
+  ImGui::BeginChild("Summary", {0, 0}, ImGuiChildFlags_Border);
+  if (rollup) DrawSummary(*rollup);
+  ImGui::EndChild();
+}
+
+void MainWindow::DrawSummary(const RollupView& view) {
+  constexpr std::array<const char*, Rollups::kDimensionCount> kTitles{
+      "Пользователи", "Команды", "Хосты"};
+  ImGui::Text("Строк за период: %zu", view.summary.rows);
+  for (std::size_t i{0}; i < kTitles.size(); ++i) {
+    ImGui::SeparatorText(kTitles[i]);
+    if (!ImGui::BeginTable(kTitles[i], 2, ImGuiTableFlags_RowBg)) continue;
+    auto dimension{static_cast<Rollups::Dimension>(i)};
+    for (auto [value, rows] : view.summary.top[i]) {
+      ImGui::TableNextRow();
       ImGui::TableNextColumn();
-      ImGui::Text(" ");
+      if (dimension == Rollups::Dimension::kUid) {
+        ImGui::Text("%u", value);
+      } else {
+        auto name{dimension == Rollups::Dimension::kCommand
+                      ? events_.CommandDictionary().Get(value)
+                      : events_.HostDictionary().Get(value)};
+        ImGui::TextUnformatted(name.data(), name.data() + name.size());
+      }
+      ImGui::TableNextColumn();
+      ImGui::Text("%zu", rows);
     }
     ImGui::EndTable();
   }
 }
 
+void MainWindow::DrawConnections() {
+  std::string_view input{endpoint_input_.data()};
+  if (!connections_query_.Running() &&
+      (connections_endpoint_ != input ||
+       connections_changes_ != events_.Connections().Changes())) {
+    SubmitConnections();
+  }
+  const auto& view{connections_query_.Snapshot()};
+  if (view) {
+    ImGui::BulletText("Соединений: %zu", view->connections);
+    ImGui::BulletText("Адресов и портов: %zu", view->endpoints);
+    ImGui::BulletText("Память: %.1f МБ",
+                      static_cast<double>(view->bytes) / (1 << 20));
+  }
+  ImGui::SetNextItemWidth(-FLT_MIN);
+  ImGui::InputTextWithHint("##endpoint", "адрес:порт", endpoint_input_.data(),
+                           endpoint_input_.size());
+  if (endpoint_input_[0] == '\0') return;
+  if (!ConnectionStore::ParseEndpoint(endpoint_input_.data())) {
+    ImGui::TextDisabled("10.0.0.5:443 или [2001:db8::1]:443");
+    return;
+  }
+  if (!view || view->endpoint != endpoint_input_.data()) return;
+  ImGui::Text("Найдено: %zu", view->found);
+  char date[32];
+  for (const auto& connection : view->newest) {
+    auto host{events_.HostDictionary().Get(connection.host)};
+    auto command{events_.Connections().Commands().Get(connection.command)};
+    timestamps_.Format(connection.opened, date);
+    ImGui::BulletText("%s %s %.*s pid %d uid %u %.*s", date,
+                      connection.incoming ? "←" : "→",
+                      static_cast<int>(host.size()), host.data(),
+                      connection.pid, connection.uid,
+                      static_cast<int>(command.size()), command.data());
+    if (connection.closed) {
+      FormatDuration(*connection.closed - connection.opened, date);
+      ImGui::SameLine();
+      ImGui::TextDisabled("%s", date);
+    }
+  }
+}
+
+void MainWindow::SubmitConnections() {
+  connections_endpoint_ = endpoint_input_.data();
+  connections_changes_ = events_.Connections().Changes();
+  connections_query_.Submit(
+      [this, endpoint = connections_endpoint_](const auto&)
+          -> std::shared_ptr<const ConnectionView> {
+        const auto& connections{events_.Connections()};
+        auto view{std::make_shared<ConnectionView>()};
+        view->endpoint = endpoint;
+        view->connections = connections.Size();
+        view->endpoints = connections.EndpointCount();
+        view->bytes = connections.ByteSize();
+        if (auto parsed{ConnectionStore::ParseEndpoint(endpoint)}) {
+          std::vector<std::size_t> found{};
+          view->found = connections.Find(parsed->first, parsed->second,
+                                         kConnectionRows, &found);
+          for (auto id : found) view->newest.push_back(connections.Get(id));
+        }
+        return view;
+      });
+}
+
+// Sessions on the chosen host or of the typed UID that overlap the range,
+// or the moment when only its start is typed.
+void MainWindow::DrawSessions() {
+  std::optional<std::uint32_t> uid{};
+  auto uids{ParseRange<std::uint32_t>(session_uid_input_.data())};
+  if (uids && uids->first == uids->second) uid = uids->first;
+  auto from{ParseLocalTime(session_from_input_.data())};
+  auto to{ParseLocalTime(session_to_input_.data())};
+  SessionQuery query{session_host_input_, uid, from.value_or(INT64_MIN),
+                     to ? *to : from ? *from + 1 : INT64_MAX};
+  if (!sessions_query_.Running() &&
+      (sessions_input_ != query ||
+       sessions_changes_ != events_.Sessions().Changes())) {
+    SubmitSessions(query);
+  }
+  const auto& view{sessions_query_.Snapshot()};
+  if (view) {
+    ImGui::BulletText("Сеансов: %zu, открыто: %zu", view->sessions,
+                      view->open);
+    ImGui::BulletText("Память: %.1f МБ",
+                      static_cast<double>(view->bytes) / (1 << 20));
+  }
+  const auto& hosts{events_.HostDictionary()};
+  auto host_name{session_host_input_ ? hosts.Get(*session_host_input_)
+                                     : "все хосты"};
+  ImGui::SetNextItemWidth(-FLT_MIN);
+  if (ImGui::BeginCombo("##session_host", std::string{host_name}.c_str())) {
+    if (ImGui::Selectable("все хосты", !session_host_input_)) {
+      session_host_input_.reset();
+    }
+    for (std::size_t id{1}; id < hosts.Size(); ++id) {
+      auto host{static_cast<EventStore::Id>(id)};
+      if (ImGui::Selectable(std::string{hosts.Get(host)}.c_str(),
+                            session_host_input_ == host)) {
+        session_host_input_ = host;
+      }
+    }
+    ImGui::EndCombo();
+  }
+  auto input{[](const char* label, const char* hint, auto* buffer) {
+    ImGui::SetNextItemWidth(-FLT_MIN);
+    ImGui::InputTextWithHint(label, hint, buffer->data(), buffer->size());
+  }};
+  input("##session_uid", "UID", &session_uid_input_);
+  input("##session_from", "с YYYY-MM-DD HH:MM", &session_from_input_);
+  input("##session_to", "по YYYY-MM-DD HH:MM", &session_to_input_);
+  if (!session_host_input_ && !uid) return;
+  if (!view || view->query != query) return;
+  ImGui::Text("Найдено: %zu", view->found);
+  const auto& origins{events_.Sessions().Origins()};
+  char date[32];
+  for (const auto& session : view->first) {
+    auto host{hosts.Get(session.host)};
+    auto terminal{origins.Get(session.terminal)};
+    auto address{origins.Get(session.address)};
+    timestamps_.Format(session.begin, date);
+    ImGui::BulletText("%s %.*s uid %u %.*s %.*s", date,
+                      static_cast<int>(host.size()), host.data(),
+                      session.uid, static_cast<int>(terminal.size()),
+                      terminal.data(), static_cast<int>(address.size()),
+                      address.data());
+    ImGui::SameLine();
+    if (!session.end) {
+      ImGui::TextDisabled("открыт");
+      continue;
+    }
+    FormatDuration(*session.end - session.begin, date);
+    ImGui::TextDisabled("%s%s", date,
+                        session.rebooted ? ", до перезагрузки" : "");
+  }
+}
+
+void MainWindow::SubmitSessions(const SessionQuery& query) {
+  sessions_input_ = query;
+  sessions_changes_ = events_.Sessions().Changes();
+  sessions_query_.Submit(
+      [this, query](const auto&) -> std::shared_ptr<const SessionView> {
+        const auto& sessions{events_.Sessions()};
+        auto view{std::make_shared<SessionView>()};
+        view->query = query;
+        view->sessions = sessions.Size();
+        view->open = sessions.OpenCount();
+        view->bytes = sessions.ByteSize();
+        const auto& [host, uid, begin, end] = query;
+        std::vector<std::size_t> found{};
+        if (host && uid) {
+          view->found = sessions.FindOfUserOnHost(*uid, *host, begin, end,
+                                                  kSessionRows, &found);
+        } else if (host) {
+          view->found =
+              sessions.FindOnHost(*host, begin, end, kSessionRows, &found);
+        } else if (uid) {
+          view->found =
+              sessions.FindOfUser(*uid, begin, end, kSessionRows, &found);
+        }
+        for (auto id : found) view->first.push_back(sessions.Get(id));
+        return view;
+      });
+}
+
+// Members of the typed group on every host, looked up again only when the
+// name or the accounts change.
+void MainWindow::DrawGroups() {
+  const auto& identities{events_.Identities()};
+  ImGui::BulletText("Групп: %zu", identities.GroupCount());
+  ImGui::SetNextItemWidth(-FLT_MIN);
+  ImGui::InputTextWithHint("##group", "wheel", group_input_.data(),
+                           group_input_.size());
+  std::string_view group{group_input_.data()};
+  if (group.empty()) return;
+  if (!group_query_.Running() &&
+      (group_name_ != group || group_changes_ != identities.Changes())) {
+    SubmitGroup();
+  }
+  const auto& view{group_query_.Snapshot()};
+  if (!view || view->group != group) return;
+  ImGui::Text("Участников: %zu", view->members);
+  const auto& hosts{events_.HostDictionary()};
+  for (std::size_t i{0}; i < view->first.size(); ++i) {
+    auto [host, uid]{view->first[i]};
+    auto host_name{hosts.Get(host)};
+    auto name{view->names[i]};
+    ImGui::BulletText("%.*s %.*s (%u)", static_cast<int>(host_name.size()),
+                      host_name.data(), static_cast<int>(name.size()),
+                      name.data(), uid);
+  }
+}
+
+void MainWindow::SubmitGroup() {
+  group_name_ = group_input_.data();
+  group_changes_ = events_.Identities().Changes();
+  group_query_.Submit([this, group = group_name_](const auto&)
+                          -> std::shared_ptr<const GroupView> {
+    const auto& identities{events_.Identities()};
+    auto view{std::make_shared<GroupView>()};
+    view->group = group;
+    auto members{identities.MembersOf(group)};
+    view->members = members.size();
+    members.resize(std::min(members.size(), kGroupRows));
+    for (auto [host, uid] : members) {
+      view->names.push_back(identities.UserName(host, uid, INT64_MAX).name);
+    }
+    view->first = std::move(members);
+    return view;
+  });
+}
+
+void MainWindow::DrawFiles() {
+  const auto& paths{events_.Paths()};
+  ImGui::BulletText("Обращений: %zu", events_.FileCount());
+  ImGui::BulletText("Путей: %zu", paths.Size());
+  ImGui::BulletText("Память путей: %.1f МБ, строками %.1f МБ",
+                    static_cast<double>(paths.ByteSize()) / (1 << 20),
+                    static_cast<double>(paths.PathBytes()) / (1 << 20));
+  ImGui::SetNextItemWidth(-FLT_MIN);
+  ImGui::InputTextWithHint("##directory", "/etc/ssh/",
+                           directory_input_.data(), directory_input_.size());
+  std::string_view directory{directory_input_.data()};
+  if (directory.empty()) return;
+  if (!files_query_.Running() && (files_directory_ != directory ||
+                                  files_rows_ != events_.FileCount())) {
+    SubmitFiles();
+  }
+  const auto& view{files_query_.Snapshot()};
+  if (!view) return;
+  ImGui::Text("Путей: %zu, обращений: %zu", view->paths, view->accesses);
+  for (const auto& path : view->sample) {
+    ImGui::BulletText("%s", path.c_str());
+  }
+}
+
+void MainWindow::SubmitFiles() {
+  files_directory_ = directory_input_.data();
+  files_rows_ = events_.FileCount();
+  files_query_.Submit([this, directory = files_directory_,
+                       rows = files_rows_](const std::atomic<bool>& cancelled)
+                          -> std::shared_ptr<const FileView> {
+    auto view{std::make_shared<FileView>()};
+    const auto& paths{events_.Paths()};
+    // Read after `rows`, so it covers the path of every file below it.
+    auto under{paths.Under(directory, paths.Size())};
+    view->paths = under.Count();
+    const auto& column{events_.FilePaths()};
+    using Column = ChunkedColumn<PathDictionary::Id>;
+    for (std::size_t block{0}; block < Column::BlockCount(rows); ++block) {
+      if (cancelled.load(std::memory_order_relaxed)) return nullptr;
+      const auto* ids{column.Block(block)};
+      for (std::size_t i{0}; i < Column::BlockRows(block, rows); ++i) {
+        view->accesses += under.Test(ids[i]);
+      }
+    }
+    std::vector<std::size_t> sample{};
+    under.Select(0, std::min(kFileRows, under.Count()), &sample);
+    for (auto id : sample) {
+      paths.Get(static_cast<PathDictionary::Id>(id),
+                &view->sample.emplace_back());
+    }
+    return view;
+  });
+}
+
+void MainWindow::SubmitMerge(std::size_t first, std::size_t last) {
+  auto posted{merge_query_.Submit(
+      [this, first, last](const std::atomic<bool>&)
+          -> std::shared_ptr<const MergedRows> {
+        auto merged{std::make_shared<MergedRows>()};
+        merged->first = first;
+        events_.Shards().Merge(first, last, &merged->rows);
+        return merged;
+      })};
+  if (!posted) merged_window_ = {};
+}
+
+void MainWindow::DrawFilters() {
+  bool changed{false};
+  auto input{[&changed](const char* label, const char* hint, auto* buffer,
+                        float width) {
+    ImGui::SetNextItemWidth(width);
+    changed |= ImGui::InputTextWithHint(label, hint, buffer->data(),
+                                        buffer->size());
+    ImGui::SameLine();
+  }};
+  input("##time_from", "с YYYY-MM-DD HH:MM", &time_from_input_, 170.f);
+  input("##time_to", "по YYYY-MM-DD HH:MM", &time_to_input_, 170.f);
+  const auto& hosts{events_.HostDictionary()};
+  auto host_name{host_input_ ? hosts.Get(*host_input_) : "все хосты"};
+  ImGui::SetNextItemWidth(150.f);
+  if (ImGui::BeginCombo("##host", std::string{host_name}.c_str())) {
+    if (ImGui::Selectable("все хосты", !host_input_)) {
+      host_input_.reset();
+      changed = true;
+    }
+    for (std::size_t id{1}; id < hosts.Size(); ++id) {
+      auto host{static_cast<EventStore::Id>(id)};
+      if (ImGui::Selectable(std::string{hosts.Get(host)}.c_str(),
+                            host_input_ == host)) {
+        host_input_ = host;
+        changed = true;
+      }
+    }
+    ImGui::EndCombo();
+  }
+  ImGui::SameLine();
+  input("##uid", "UID", &uid_input_, 80.f);
+  input("##pid", "PID от-до", &pid_input_, 110.f);
+  input("##ppid", "PPID от-до", &ppid_input_, 110.f);
+  ImGui::NewLine();
+  ImGui::SetNextItemWidth(-FLT_MIN);
+  if (ImGui::InputTextWithHint("##expression",
+                               "uid == 0 && command ~ \"curl\" && ppid != 1",
+                               expression_input_.data(),
+                               expression_input_.size())) {
+    try {
+      expression_ = FilterExpression::Parse(expression_input_.data());
+      expression_error_.clear();
+    } catch (const std::invalid_argument& e) {
+      expression_.reset();
+      expression_error_ = e.what();
+    }
+    changed = true;
+  }
+  if (!expression_error_.empty()) {
+    ImGui::TextColored({0.8f, 0.f, 0.f, 1.f}, "%s", expression_error_.c_str());
+  }
+  if (lineage_input_) {
+    ImGui::Text("%s процесса из строки %zu",
+                lineage_input_->descendants ? "Потомки" : "Предки",
+                lineage_input_->row + 1);
+    ImGui::SameLine();
+    if (ImGui::SmallButton("Сбросить")) {
+      lineage_input_.reset();
+      changed = true;
+    }
+  }
+  if (changed) UpdateFilter();
+}
+
+void MainWindow::UpdateFilter() {
+  filter_ = {};
+  auto from{ParseLocalTime(time_from_input_.data())};
+  auto to{ParseLocalTime(time_to_input_.data())};
+  if (from || to) {
+    filter_.time = std::pair{from.value_or(INT64_MIN),
+                             to.value_or(INT64_MAX)};
+  }
+  filter_.host = host_input_;
+  filter_.uid = ParseRange<std::uint32_t>(uid_input_.data());
+  filter_.pid = ParseRange<std::int32_t>(pid_input_.data());
+  filter_.ppid = ParseRange<std::int32_t>(ppid_input_.data());
+  filter_.expression = expression_;
+  filter_.lineage = lineage_input_;
+  if (!filter_.Empty()) SubmitFilter();
+}
+
+void MainWindow::SubmitFilter() {
+  filter_rows_ = events_.Size();
+  filter_query_.Submit(
+      [this, filter = filter_, rows = filter_rows_](const auto& cancelled) {
+        return filter.Evaluate(events_, rows, cancelled);
+      });
+}
+
+// Extends the cached index of the sorted column by the rows added since,
+// then picks the rows of `selection` in index order.
+void MainWindow::SubmitSort(std::size_t rows,
+                            std::shared_ptr<const Selection> selection) {
+  auto column{sort_->column};
+  auto base{sort_indexes_[static_cast<std::size_t>(column)]};
+  auto posted{sort_query_.Submit(
+      [this, column, rows, base, selection](const auto& cancelled)
+          -> std::shared_ptr<const SortedRows> {
+        auto sorted{std::make_shared<SortedRows>()};
+        sorted->index = base && base->Size() == rows
+                            ? base
+                            : SortIndex::Build(events_, column, rows,
+                                               base.get(), &sort_pool_,
+                                               cancelled);
+        if (!sorted->index) return nullptr;
+        sorted->selection = selection;
+        if (selection) {
+          sorted->rows.reserve(selection->Count());
+          for (auto row : sorted->index->Rows()) {
+            if (row < selection->Rows() && selection->Test(row)) {
+              sorted->rows.push_back(row);
+            }
+          }
+        }
+        return sorted;
+      })};
+  if (!posted) return;
+  sort_submitted_ = std::chrono::steady_clock::now();
+  sort_column_ = column;
+  sort_rows_ = rows;
+  sort_selection_ = std::move(selection);
+}
+
+// Rollups follow the time filter only; the other filters would need the
+// rows themselves.
+void MainWindow::SubmitRollups() {
+  rollup_rows_ = events_.Aggregates().Size();
+  rollup_time_ = filter_.time;
+  rollup_query_.Submit([this, time = filter_.time](const auto&)
+                           -> std::shared_ptr<const RollupView> {
+    auto view{std::make_shared<RollupView>()};
+    const auto& rollups{events_.Aggregates()};
+    auto span{rollups.Span()};
+    if (!span) return view;
+    auto [from, to]{time.value_or(*span)};
+    from = std::max(from, span->first);
+    to = std::min(to, span->second);
+    // The finest level that fits in kHistogramBars.
+    auto length{to < from ? 0 : static_cast<std::uint64_t>(to - from)};
+    for (auto level : {Rollups::Level::kMinute, Rollups::Level::kHour,
+                       Rollups::Level::kDay}) {
+      view->level = level;
+      auto width{static_cast<std::uint64_t>(Rollups::Width(level))};
+      if (length / width < kHistogramBars) break;
+    }
+    std::vector<std::size_t> rows{};
+    rollups.Histogram(view->level, from, to, &rows);
+    view->bars.assign(rows.begin(), rows.end());
+    rollups.Summarize(from, to, kSummaryValues, &view->summary);
+    return view;
+  });
+}
+
+void MainWindow::UpdateCells() {
+  ++frame_;
+  auto changes{events_.Identities().Changes()};
+  if (changes != cells_identities_) {
+    cells_identities_ = changes;
+    cells_.clear();
+  }
+  // Both counts are atomics, read before the ends, so ends joined
+  // meanwhile are read again next frame. Neither read takes the tree lock.
+  const auto& processes{events_.Processes()};
+  std::array<std::size_t, 2> version{processes.Size(), processes.ExitCount()};
+  if (version == cells_processes_) return;
+  cells_processes_ = version;
+  for (auto& [row, cells] : cells_) {
+    if (cells.event.exit_time) continue;
+    auto end{processes.EndOf(row)};
+    if (!end) continue;
+    cells.event.exit_time = end->time;
+    if (end->exit) cells.event.exit_code = events_.ExitCodes()[*end->exit];
+    FormatEnd(&cells);
+  }
+}
+
+void MainWindow::FormatCells() {
+  new_ids_.clear();
+  for (auto row : visible_ids_) {
+    auto it{cells_.find(row)};
+    if (it == cells_.end()) {
+      new_ids_.push_back(row);
+    } else {
+      it->second.frame = frame_;
+    }
+  }
+  if (new_ids_.empty()) return;
+  events_.GetRows(new_ids_, &new_rows_);
+  for (std::size_t i{0}; i < new_ids_.size(); ++i) {
+    auto row{new_ids_[i]};
+    const auto& event{new_rows_[i]};
+    auto& cells{cells_[row]};
+    cells.frame = frame_;
+    cells.event = event;
+    timestamps_.Format(event.time, cells.date);
+    auto user{UserName(row, event)};
+    cells.user = std::to_string(event.uid);
+    if (!user.empty()) cells.user = std::string{user} + " (" + cells.user + ")";
+    std::snprintf(cells.pid, sizeof(cells.pid), "%d", event.pid);
+    std::snprintf(cells.ppid, sizeof(cells.ppid), "%d", event.ppid);
+    EscapeArgs(event.args, &cells.args);
+    FormatEnd(&cells);
+  }
+}
+
+void MainWindow::FormatEnd(RowCells* cells) {
+  const auto& event{cells->event};
+  if (!event.exit_time) return;
+  timestamps_.Format(*event.exit_time, cells->exit_time);
+  FormatDuration(*event.exit_time - event.time, cells->duration);
+  if (event.exit_code) {
+    std::snprintf(cells->exit_code, sizeof(cells->exit_code), "%d",
+                  *event.exit_code);
+  }
+}
+
+void MainWindow::DrawEventRow(std::size_t row, const RowCells& cells) {
+  const auto& event{cells.event};
+  auto text{[](std::string_view value) {
+    ImGui::TableNextColumn();
+    ImGui::TextUnformatted(value.data(), value.data() + value.size());
+  }};
+  ImGui::TableNextRow();
+  ImGui::TableNextColumn();
+  ImGui::PushID(static_cast<int>(row));
+  ImGui::Selectable(cells.date, false, ImGuiSelectableFlags_SpanAllColumns);
+  if (ImGui::BeginPopupContextItem("lineage")) {
+    if (ImGui::MenuItem("Предки процесса")) {
+      lineage_input_ = EventFilter::Lineage{row, false};
+      UpdateFilter();
+    }
+    if (ImGui::MenuItem("Потомки процесса")) {
+      lineage_input_ = EventFilter::Lineage{row, true};
+      UpdateFilter();
+    }
+    ImGui::EndPopup();
+  }
+  ImGui::PopID();
+  text(event.host);
+  text(cells.user);
+  text(cells.pid);
+  text(cells.ppid);
+  text(event.cwd);
+  text(event.command);
+  text(cells.args.empty() ? event.args : cells.args);
+  text(event.exit_time ? cells.exit_time : "");
+  text(event.exit_time ? cells.duration : "");
+  text(event.exit_code ? cells.exit_code : "");
+}
+
+std::string_view MainWindow::UserName(std::size_t row,
+                                      const EventStore::Row& event) {
+  auto host{events_.Hosts()[row]};
+  auto key{std::uint64_t{host} << 32 | event.uid};
+  auto it{user_names_.find(key)};
+  if (it == user_names_.end() || event.time < it->second.from ||
+      event.time >= it->second.to) {
+    auto name{events_.Identities().TryUserName(host, event.uid, event.time)};
+    // The writer is adding accounts; once it is done Changes() moves and
+    // the cells are formatted again.
+    if (!name) {
+      RequestRedraw(kBusyRedraw);
+      return {};
+    }
+    it = user_names_.insert_or_assign(key, *name).first;
+  }
+  return it->second.name;
+}
+
 }  // namespace audit
 
 /*
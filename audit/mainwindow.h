@@ -1,6 +1,31 @@
 #ifndef AUDIT_MAINWINDOW_H_
 #define AUDIT_MAINWINDOW_H_
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "audit/database.h"
+#include "audit/event_filter.h"
+#include "audit/event_store.h"
+#include "audit/filter_expression.h"
+#include "audit/log_follower.h"
+#include "audit/query_executor.h"
+#include "audit/rollups.h"
+#include "audit/selection.h"
+#include "audit/sort_index.h"
+#include "audit/thread_pool.h"
+#include "audit/timestamp.h"
 #include "imgui_glfw_vulkan/imgui_glfw_vulkan.h"
 
 namespace audit {
@@ -8,17 +33,130 @@ namespace audit {
 class MainWindow : public imgui_glfw_vulkan::ImGuiGlfwVulkan {
  public:
   MainWindow(std::string_view name = "window", int width = 800,
-             int height = 600);
-  MainWindow(const MainWindow&) = default;
-  MainWindow& operator=(const MainWindow&) = default;
-  MainWindow(MainWindow&&) = default;
-  MainWindow& operator=(MainWindow&&) = default;
+             int height = 600, Target target = Target::kWindow);
+  MainWindow(const MainWindow&) = delete;
+  MainWindow& operator=(const MainWindow&) = delete;
+  MainWindow(MainWindow&&) = delete;
+  MainWindow& operator=(MainWindow&&) = delete;
   ~MainWindow() = default;
   void Render() override;
+  // Maps the database in `directory`; later loads are persisted there.
+  // Call before Load() and Run().
+  void Open(const std::string& directory);
+  // Runs `load` on a worker; loads are applied one at a time.
+  void Load(std::function<void(EventStore*)> load);
+  // Appends what is written to the audit.log at `path` from now on.
+  void Follow(const std::string& path);
+  bool Loading() const { return loading_ > 0; }
 
  private:
+  struct SortSpec {
+    EventStore::Column column{EventStore::Column::kTime};
+    bool descending{false};
+  };
+  // Rows of the events table in sort order; under a filter, only those of
+  // `selection`.
+  struct SortedRows {
+    std::shared_ptr<const SortIndex> index{};
+    std::shared_ptr<const Selection> selection{};
+    std::vector<std::uint32_t> rows{};
+    const std::vector<std::uint32_t>& Rows() const {
+      return selection ? rows : index->Rows();
+    }
+  };
+  // Histogram and summary of the rows in the time filter.
+  struct RollupView {
+    Rollups::Level level{Rollups::Level::kMinute};
+    std::vector<float> bars{};
+    Rollups::Summary summary{};
+  };
+  // Paths under the directory typed in the "Файлы" node, and accesses to
+  // them.
+  struct FileView {
+    std::size_t paths{0};
+    std::size_t accesses{0};
+    std::vector<std::string> sample{};
+  };
+  // Totals of the "TCP-соединения" node and the newest connections of the
+  // endpoint typed there.
+  struct ConnectionView {
+    std::string endpoint{};
+    std::size_t connections{0};
+    std::size_t endpoints{0};
+    std::size_t bytes{0};
+    std::size_t found{0};
+    std::vector<ConnectionStore::Connection> newest{};
+  };
+  // Host and uid picked in the "Сеансы" node and the [begin, end) range
+  // typed there.
+  using SessionQuery =
+      std::tuple<std::optional<EventStore::Id>, std::optional<std::uint32_t>,
+                 std::int64_t, std::int64_t>;
+  // Totals of the "Сеансы" node and the first sessions matching `query`.
+  struct SessionView {
+    SessionQuery query{};
+    std::size_t sessions{0};
+    std::size_t open{0};
+    std::size_t bytes{0};
+    std::size_t found{0};
+    std::vector<SessionStore::Session> first{};
+  };
+  // Members of the group typed in the "Группы пользователей" node, and the
+  // current names of the first of them.
+  struct GroupView {
+    std::string group{};
+    std::size_t members{0};
+    IdentityStore::Users first{};
+    std::vector<std::string_view> names{};
+  };
+  // Rows of the time-ordered ranks from `first` on, over all hosts.
+  struct MergedRows {
+    std::size_t first{0};
+    std::vector<std::size_t> rows{};
+  };
+  // Text of a visible row, formatted when the row comes into view and kept
+  // while it stays there. The exit cells are filled in once it ends.
+  struct RowCells {
+    std::uint64_t frame{0};
+    EventStore::Row event{};
+    char date[32]{};
+    std::string user{};
+    char pid[12]{};
+    char ppid[12]{};
+    // Escaped arguments, empty when they are shown as stored.
+    std::string args{};
+    char exit_time[32]{};
+    char duration[32]{};
+    char exit_code[12]{};
+  };
+
+  void ApplyTail();
   void DrawLeft();
   void DrawRight();
+  void DrawFilters();
+  void UpdateFilter();
+  void SubmitFilter();
+  void SubmitSort(std::size_t rows,
+                  std::shared_ptr<const Selection> selection);
+  void SubmitRollups();
+  void DrawSummary(const RollupView& view);
+  void DrawConnections();
+  void SubmitConnections();
+  void DrawSessions();
+  void SubmitSessions(const SessionQuery& query);
+  void DrawGroups();
+  void SubmitGroup();
+  void DrawFiles();
+  void SubmitFiles();
+  void SubmitMerge(std::size_t first, std::size_t last);
+  // Drops or completes the cells whose data changed since the last frame.
+  void UpdateCells();
+  // Formats the visible rows that have no cells yet.
+  void FormatCells();
+  void FormatEnd(RowCells* cells);
+  void DrawEventRow(std::size_t row, const RowCells& cells);
+  // Name of the user of a row, or empty when it is unknown.
+  std::string_view UserName(std::size_t row, const EventStore::Row& event);
   static constexpr ImGuiConfigFlags kConfigFlags{
       ImGuiConfigFlags_NavEnableKeyboard | ImGuiConfigFlags_NavEnableGamepad};
   static constexpr ImGuiWindowFlags kMainWindowFlags{
@@ -28,6 +166,103 @@ class MainWindow : public imgui_glfw_vulkan::ImGuiGlfwVulkan {
       ImGuiChildFlags_ResizeX | ImGuiChildFlags_Border};
   static constexpr ImGuiChildFlags kMainWindowRightChildFlags{
       ImGuiChildFlags_Border};
+  static constexpr ImGuiTableFlags kEventsTableFlags{
+      ImGuiTableFlags_Resizable | ImGuiTableFlags_Borders |
+      ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY |
+      ImGuiTableFlags_Sortable | ImGuiTableFlags_SortTristate};
+  static constexpr double kBusyRedraw{1.0 / 60};
+  // Tailed events applied per frame, several times 50K/s at 60 fps.
+  static constexpr std::size_t kTailBatch{4096};
+  static constexpr std::chrono::seconds kTailSync{1};
+  // Appended rows are sorted in once they add 1/kSortGrowth of the index,
+  // so copying it stays amortized O(1) per row, or after kSortInterval.
+  static constexpr std::size_t kSortGrowth{8};
+  static constexpr std::chrono::seconds kSortInterval{1};
+  static constexpr std::size_t kHistogramBars{240};
+  static constexpr std::size_t kSummaryValues{20};
+  // Connections of the looked up endpoint listed, newest first.
+  static constexpr std::size_t kConnectionRows{50};
+  static constexpr std::size_t kFileRows{50};
+  static constexpr std::size_t kSessionRows{50};
+  static constexpr std::size_t kGroupRows{50};
+  EventStore events_{};
+  // Owns the mapped segments, so it is declared before the executor whose
+  // queries read them.
+  std::unique_ptr<Database> database_{};
+  std::mutex load_mutex_{};
+  std::atomic<int> loading_{0};
+  // Drained by worker tasks, so it and their flags outlive the executor.
+  std::unique_ptr<LogFollower> follower_{};
+  std::atomic<bool> tail_applying_{false};
+  // Tailed rows not yet persisted.
+  std::atomic<bool> tail_unsynced_{false};
+  // Used by sort queries, so it outlives the executor.
+  ThreadPool sort_pool_{};
+  QueryExecutor executor_{};
+  bool follow_tail_{true};
+  std::chrono::steady_clock::time_point tail_synced_{};
+  std::array<char, 32> time_from_input_{};
+  std::array<char, 32> time_to_input_{};
+  std::array<char, 32> uid_input_{};
+  std::array<char, 32> pid_input_{};
+  std::array<char, 32> ppid_input_{};
+  std::optional<EventStore::Id> host_input_{};
+  std::array<char, 256> expression_input_{};
+  std::shared_ptr<const FilterExpression> expression_{};
+  std::string expression_error_{};
+  std::optional<EventFilter::Lineage> lineage_input_{};
+  EventFilter filter_{};
+  std::size_t filter_rows_{0};
+  AsyncQuery<Selection> filter_query_{&executor_};
+  std::optional<SortSpec> sort_{};
+  // The latest index of each column, extended rather than rebuilt when the
+  // column is sorted again.
+  std::array<std::shared_ptr<const SortIndex>, EventStore::kColumnCount>
+      sort_indexes_{};
+  std::size_t sort_rows_{0};
+  std::chrono::steady_clock::time_point sort_submitted_{};
+  std::optional<EventStore::Column> sort_column_{};
+  std::shared_ptr<const Selection> sort_selection_{};
+  AsyncQuery<SortedRows> sort_query_{&executor_};
+  std::size_t rollup_rows_{0};
+  EventFilter::Range<std::int64_t> rollup_time_{};
+  AsyncQuery<RollupView> rollup_query_{&executor_};
+  std::array<char, 64> endpoint_input_{};
+  std::string connections_endpoint_{};
+  std::size_t connections_changes_{0};
+  AsyncQuery<ConnectionView> connections_query_{&executor_};
+  std::optional<EventStore::Id> session_host_input_{};
+  std::array<char, 32> session_uid_input_{};
+  std::array<char, 32> session_from_input_{};
+  std::array<char, 32> session_to_input_{};
+  SessionQuery sessions_input_{};
+  std::size_t sessions_changes_{0};
+  AsyncQuery<SessionView> sessions_query_{&executor_};
+  std::array<char, 64> group_input_{};
+  std::string group_name_{};
+  std::size_t group_changes_{0};
+  AsyncQuery<GroupView> group_query_{&executor_};
+  // Names resolved this frame by (host, uid) with the times they hold for,
+  // so the visible rows look each user up once.
+  std::unordered_map<std::uint64_t, IdentityStore::Name> user_names_{};
+  std::array<char, 256> directory_input_{};
+  std::string files_directory_{};
+  std::size_t files_rows_{0};
+  AsyncQuery<FileView> files_query_{&executor_};
+  std::vector<std::size_t> visible_ids_{};
+  std::array<std::size_t, 3> merged_window_{};
+  AsyncQuery<MergedRows> merge_query_{&executor_};
+  // Cells of the rows in view by row id, so an unchanged view is drawn
+  // without formatting anything. Rows not drawn in a frame are dropped.
+  std::unordered_map<std::size_t, RowCells> cells_{};
+  std::uint64_t frame_{0};
+  std::size_t cells_identities_{0};
+  // Size() and ExitCount() of the process tree when ends were last read.
+  std::array<std::size_t, 2> cells_processes_{};
+  std::vector<std::size_t> new_ids_{};
+  std::vector<EventStore::Row> new_rows_{};
+  TimestampFormatter timestamps_{};
+  double render_time_us_{0.0};
 };
 
 }  // namespace audit
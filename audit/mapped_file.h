@@ -0,0 +1,34 @@
+#ifndef AUDIT_MAPPED_FILE_H_
+#define AUDIT_MAPPED_FILE_H_
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace audit {
+
+// Read-only memory mapping of a whole file.
+class MappedFile {
+ public:
+  // Hints the kernel about the access pattern for read-ahead.
+  enum class Access { kSequential, kRandom };
+
+  explicit MappedFile(const std::string& path,
+                      Access access = Access::kSequential);
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  MappedFile(MappedFile&& other) noexcept;
+  MappedFile& operator=(MappedFile&& other) noexcept;
+  ~MappedFile();
+
+  std::string_view Data() const { return {data_, size_}; }
+  std::size_t Size() const { return size_; }
+
+ private:
+  const char* data_{nullptr};
+  std::size_t size_{0};
+};
+
+}  // namespace audit
+
+#endif  // AUDIT_MAPPED_FILE_H_
@@ -0,0 +1,82 @@
+#ifndef AUDIT_MPMC_QUEUE_H_
+#define AUDIT_MPMC_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace audit {
+
+// Bounded lock-free multi-producer multi-consumer queue (Vyukov). The
+// capacity must be a power of two. Push and pop never block.
+template <typename T>
+class MpmcQueue {
+ public:
+  explicit MpmcQueue(std::size_t capacity)
+      : cells_{std::make_unique<Cell[]>(capacity)}, mask_{capacity - 1} {
+    for (std::size_t i{0}; i < capacity; ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+  MpmcQueue(const MpmcQueue&) = delete;
+  MpmcQueue& operator=(const MpmcQueue&) = delete;
+  MpmcQueue(MpmcQueue&&) = delete;
+  MpmcQueue& operator=(MpmcQueue&&) = delete;
+  ~MpmcQueue() = default;
+
+  bool TryPush(T&& value) {
+    auto pos{enqueue_pos_.load(std::memory_order_relaxed)};
+    while (true) {
+      auto& cell{cells_[pos & mask_]};
+      auto sequence{cell.sequence.load(std::memory_order_acquire)};
+      if (sequence == pos) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          cell.value = std::move(value);
+          cell.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (sequence < pos) {
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  bool TryPop(T* value) {
+    auto pos{dequeue_pos_.load(std::memory_order_relaxed)};
+    while (true) {
+      auto& cell{cells_[pos & mask_]};
+      auto sequence{cell.sequence.load(std::memory_order_acquire)};
+      if (sequence == pos + 1) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          *value = std::move(cell.value);
+          cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (sequence < pos + 1) {
+        return false;
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+ private:
+  struct Cell {
+    std::atomic<std::size_t> sequence{0};
+    T value{};
+  };
+
+  std::unique_ptr<Cell[]> cells_;
+  std::size_t mask_;
+  alignas(64) std::atomic<std::size_t> enqueue_pos_{0};
+  alignas(64) std::atomic<std::size_t> dequeue_pos_{0};
+};
+
+}  // namespace audit
+
+#endif  // AUDIT_MPMC_QUEUE_H_
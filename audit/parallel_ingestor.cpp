@@ -0,0 +1,322 @@
+#include "audit/parallel_ingestor.h"
+
+#include <algorithm>
+#include <future>
+#include <memory>
+#include <queue>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "audit/audit_log_parser.h"
+#include "audit/ingestor.h"
+#include "audit/mapped_file.h"
+#include "audit/string_dictionary.h"
+
+namespace audit {
+
+namespace {
+
+using Column = EventStore::Column;
+
+// Rows of one chunk with ids local to the chunk's own dictionaries.
+struct ParsedChunk {
+  StringDictionary hosts{};
+  StringDictionary cwds{};
+  StringDictionary commands{};
+  StringDictionary args{};
+  PathDictionary paths{};
+  StringDictionary origins{};
+  StringDictionary names{};
+  StringDictionary socket_commands{};
+  std::vector<EventStore::EncodedRow> rows{};
+  std::vector<EventStore::EncodedExit> exits{};
+  std::vector<ConnectionStore::Socket> sockets{};
+  std::vector<EventStore::EncodedFile> files{};
+  std::vector<SessionStore::Login> logins{};
+  std::vector<IdentityStore::Change> identities{};
+  std::vector<AuditEvent> fragments{};
+  DecodeBuffers buffers{};
+  std::vector<FileEvent> file_events{};
+
+  void Add(const AuditEvent& event) {
+    ExecveEvent row{};
+    ExitEvent exit{};
+    SocketEvent socket{};
+    LoginEvent login{};
+    IdentityEvent identity{};
+    if (BuildExecveEvent(event, &buffers, &row)) {
+      rows.push_back({row.time, hosts.Intern(row.host), row.uid, row.pid,
+                      row.ppid, cwds.Intern(row.cwd),
+                      commands.Intern(row.command), args.Intern(row.args)});
+    } else if (BuildExitEvent(event, &exit)) {
+      exits.push_back(
+          {exit.time, hosts.Intern(exit.host), exit.pid, exit.code});
+    } else if (BuildSocketEvent(event, &buffers, &socket)) {
+      sockets.push_back({socket.kind, socket.time, hosts.Intern(socket.host),
+                         socket.uid, socket.pid, socket.fd,
+                         socket_commands.Intern(socket.command), socket.address,
+                         socket.port});
+    } else if (BuildFileEvents(event, &buffers, &file_events)) {
+      for (const auto& file : file_events) {
+        files.push_back({file.time, hosts.Intern(file.host), file.uid,
+                         file.pid, paths.Intern(file.path)});
+      }
+    } else if (BuildLoginEvent(event, &login)) {
+      logins.push_back({login.kind, login.time, hosts.Intern(login.host),
+                        login.uid, login.pid, login.session,
+                        origins.Intern(login.terminal),
+                        origins.Intern(login.address)});
+    } else if (BuildIdentityEvent(event, &buffers, &identity)) {
+      identities.push_back(
+          {identity.kind, identity.time, hosts.Intern(identity.host),
+           identity.id, names.Intern(identity.name),
+           names.Intern(identity.group), identity.removed});
+    }
+  }
+
+  void SortByTime() {
+    auto earlier{[](const auto& a, const auto& b) { return a.time < b.time; }};
+    if (!std::is_sorted(rows.begin(), rows.end(), earlier)) {
+      std::stable_sort(rows.begin(), rows.end(), earlier);
+    }
+    if (!std::is_sorted(exits.begin(), exits.end(), earlier)) {
+      std::stable_sort(exits.begin(), exits.end(), earlier);
+    }
+    if (!std::is_sorted(sockets.begin(), sockets.end(), earlier)) {
+      std::stable_sort(sockets.begin(), sockets.end(), earlier);
+    }
+    if (!std::is_sorted(files.begin(), files.end(), earlier)) {
+      std::stable_sort(files.begin(), files.end(), earlier);
+    }
+    if (!std::is_sorted(logins.begin(), logins.end(), earlier)) {
+      std::stable_sort(logins.begin(), logins.end(), earlier);
+    }
+    if (!std::is_sorted(identities.begin(), identities.end(), earlier)) {
+      std::stable_sort(identities.begin(), identities.end(), earlier);
+    }
+  }
+};
+
+// An event is cut by a chunk boundary when it never saw its EOE record, or
+// when it starts after the SYSCALL record that always opens a syscall event.
+bool IsFragment(const AuditEvent& event) {
+  if (!event.complete) return true;
+  auto first{event.records.front().type};
+  return first != "SYSCALL" && AuditLogParser::IsSyscallRecord(first);
+}
+
+void ParseChunk(std::string_view data, ParsedChunk* chunk) {
+  AuditLogParser parser{[chunk](const AuditEvent& event) {
+    if (IsFragment(event)) {
+      chunk->fragments.push_back(event);
+    } else {
+      chunk->Add(event);
+    }
+  }};
+  parser.Parse(data);
+  chunk->SortByTime();
+}
+
+void Stitch(const std::vector<std::unique_ptr<ParsedChunk>>& chunks,
+            ParsedChunk* stitched) {
+  std::vector<AuditEvent> events{};
+  for (const auto& chunk : chunks) {
+    for (const auto& fragment : chunk->fragments) {
+      auto it{std::find_if(events.rbegin(), events.rend(), [&](const auto& e) {
+        return e.serial == fragment.serial && e.node == fragment.node;
+      })};
+      if (it == events.rend()) {
+        events.push_back(fragment);
+      } else {
+        it->records.insert(it->records.end(), fragment.records.begin(),
+                           fragment.records.end());
+      }
+    }
+  }
+  for (const auto& event : events) stitched->Add(event);
+  stitched->SortByTime();
+}
+
+std::vector<EventStore::Id> Remap(const StringDictionary& local, Column column,
+                                  EventStore* store) {
+  std::vector<EventStore::Id> ids(local.Size());
+  for (std::size_t i{0}; i < ids.size(); ++i) {
+    ids[i] = store->Intern(column, local.Get(static_cast<EventStore::Id>(i)));
+  }
+  return ids;
+}
+
+// Like Remap() for the dictionaries kept outside the columns, interned by
+// `intern`.
+template <typename Intern>
+std::vector<EventStore::Id> RemapWith(const StringDictionary& local,
+                                      Intern intern) {
+  std::vector<EventStore::Id> ids(local.Size());
+  for (std::size_t i{0}; i < ids.size(); ++i) {
+    ids[i] = intern(local.Get(static_cast<EventStore::Id>(i)));
+  }
+  return ids;
+}
+
+// Only the paths the chunk's files use; the directories on their way are
+// added by the store's own dictionary.
+std::vector<PathDictionary::Id> RemapPaths(const ParsedChunk& chunk,
+                                           EventStore* store) {
+  std::vector<PathDictionary::Id> ids(chunk.paths.Size());
+  std::vector<bool> mapped(ids.size());
+  std::string path{};
+  for (const auto& file : chunk.files) {
+    if (mapped[file.path]) continue;
+    mapped[file.path] = true;
+    path.clear();
+    chunk.paths.Get(file.path, &path);
+    ids[file.path] = store->InternPath(path);
+  }
+  return ids;
+}
+
+// Interns every chunk's dictionaries into the store, then appends the rows,
+// exits, sockets, files, logins and account changes with a k-way merge on
+// time. Ties put rows first, so a short-lived process is created before it
+// exits, and keep chunk order, i.e. file order, so a socket is opened
+// before it is closed.
+void Merge(const std::vector<std::unique_ptr<ParsedChunk>>& chunks,
+           EventStore* store) {
+  struct Remapped {
+    std::vector<EventStore::Id> hosts;
+    std::vector<EventStore::Id> cwds;
+    std::vector<EventStore::Id> commands;
+    std::vector<EventStore::Id> args;
+    std::vector<PathDictionary::Id> paths;
+    std::vector<EventStore::Id> origins;
+    std::vector<EventStore::Id> names;
+    std::vector<EventStore::Id> socket_commands;
+  };
+  std::vector<Remapped> remapped{};
+  remapped.reserve(chunks.size());
+  for (const auto& chunk : chunks) {
+    remapped.push_back({Remap(chunk->hosts, Column::kHost, store),
+                        Remap(chunk->cwds, Column::kCwd, store),
+                        Remap(chunk->commands, Column::kCommand, store),
+                        Remap(chunk->args, Column::kArgs, store),
+                        RemapPaths(*chunk, store),
+                        RemapWith(chunk->origins,
+                                  [store](std::string_view origin) {
+                                    return store->InternOrigin(origin);
+                                  }),
+                        RemapWith(chunk->names, [store](std::string_view name) {
+                          return store->InternName(name);
+                        }),
+                        RemapWith(chunk->socket_commands,
+                                  [store](std::string_view command) {
+                                    return store->InternSocketCommand(command);
+                                  })});
+  }
+  enum Stream { kRows, kExits, kSockets, kFiles, kLogins, kIdentities };
+  // (time, stream, chunk, index)
+  using Cursor = std::tuple<std::int64_t, Stream, std::size_t, std::size_t>;
+  std::priority_queue<Cursor, std::vector<Cursor>, std::greater<Cursor>>
+      heap{};
+  auto push{[&](Stream stream, std::size_t chunk, std::size_t index) {
+    const auto& parsed{*chunks[chunk]};
+    if (stream == kRows && index < parsed.rows.size()) {
+      heap.emplace(parsed.rows[index].time, stream, chunk, index);
+    } else if (stream == kExits && index < parsed.exits.size()) {
+      heap.emplace(parsed.exits[index].time, stream, chunk, index);
+    } else if (stream == kSockets && index < parsed.sockets.size()) {
+      heap.emplace(parsed.sockets[index].time, stream, chunk, index);
+    } else if (stream == kFiles && index < parsed.files.size()) {
+      heap.emplace(parsed.files[index].time, stream, chunk, index);
+    } else if (stream == kLogins && index < parsed.logins.size()) {
+      heap.emplace(parsed.logins[index].time, stream, chunk, index);
+    } else if (stream == kIdentities && index < parsed.identities.size()) {
+      heap.emplace(parsed.identities[index].time, stream, chunk, index);
+    }
+  }};
+  for (std::size_t i{0}; i < chunks.size(); ++i) {
+    push(kRows, i, 0);
+    push(kExits, i, 0);
+    push(kSockets, i, 0);
+    push(kFiles, i, 0);
+    push(kLogins, i, 0);
+    push(kIdentities, i, 0);
+  }
+  while (!heap.empty()) {
+    auto [time, stream, chunk, index] = heap.top();
+    heap.pop();
+    const auto& ids{remapped[chunk]};
+    if (stream == kExits) {
+      auto encoded{chunks[chunk]->exits[index]};
+      encoded.host = ids.hosts[encoded.host];
+      store->AppendExit(encoded);
+    } else if (stream == kSockets) {
+      auto encoded{chunks[chunk]->sockets[index]};
+      encoded.host = ids.hosts[encoded.host];
+      encoded.command = ids.socket_commands[encoded.command];
+      store->AppendSocket(encoded);
+    } else if (stream == kFiles) {
+      auto encoded{chunks[chunk]->files[index]};
+      encoded.host = ids.hosts[encoded.host];
+      encoded.path = ids.paths[encoded.path];
+      store->AppendFile(encoded);
+    } else if (stream == kLogins) {
+      auto encoded{chunks[chunk]->logins[index]};
+      encoded.host = ids.hosts[encoded.host];
+      encoded.terminal = ids.origins[encoded.terminal];
+      encoded.address = ids.origins[encoded.address];
+      store->AppendLogin(encoded);
+    } else if (stream == kIdentities) {
+      auto encoded{chunks[chunk]->identities[index]};
+      encoded.host = ids.hosts[encoded.host];
+      encoded.name = ids.names[encoded.name];
+      encoded.group = ids.names[encoded.group];
+      store->AppendIdentity(encoded);
+    } else {
+      auto encoded{chunks[chunk]->rows[index]};
+      encoded.host = ids.hosts[encoded.host];
+      encoded.cwd = ids.cwds[encoded.cwd];
+      encoded.command = ids.commands[encoded.command];
+      encoded.args = ids.args[encoded.args];
+      store->Append(encoded);
+    }
+    push(stream, chunk, index + 1);
+  }
+}
+
+}  // namespace
+
+ParallelIngestor::ParallelIngestor(EventStore* store, ThreadPool* pool)
+    : store_{store}, pool_{pool} {}
+
+void ParallelIngestor::IngestFile(const std::string& path) {
+  MappedFile file{path};
+  Ingest(file.Data());
+}
+
+void ParallelIngestor::Ingest(std::string_view data) {
+  auto chunk_size{std::max(kMinChunkSize,
+                           data.size() / (pool_->Size() * kChunksPerThread))};
+  std::vector<std::unique_ptr<ParsedChunk>> chunks{};
+  std::vector<std::future<void>> futures{};
+  std::size_t begin{0};
+  while (begin < data.size()) {
+    auto end{std::min(data.size(), begin + chunk_size)};
+    if (end < data.size()) {
+      auto newline{data.find('\n', end)};
+      end = newline == std::string_view::npos ? data.size() : newline + 1;
+    }
+    chunks.push_back(std::make_unique<ParsedChunk>());
+    futures.push_back(pool_->Submit(
+        [part = data.substr(begin, end - begin), chunk = chunks.back().get()] {
+          ParseChunk(part, chunk);
+        }));
+    begin = end;
+  }
+  for (auto& future : futures) future.get();
+  chunks.push_back(std::make_unique<ParsedChunk>());
+  Stitch(chunks, chunks.back().get());
+  Merge(chunks, store_);
+}
+
+}  // namespace audit
@@ -0,0 +1,37 @@
+#ifndef AUDIT_PARALLEL_INGESTOR_H_
+#define AUDIT_PARALLEL_INGESTOR_H_
+
+#include <string>
+#include <string_view>
+
+#include "audit/event_store.h"
+#include "audit/thread_pool.h"
+
+namespace audit {
+
+// Splits a mapped log at line boundaries and parses the chunks on a thread
+// pool. Each chunk interns strings into its own dictionaries, so workers share
+// nothing. Events cut by a chunk boundary are stitched by (node, serial). The
+// chunks are then merged into the store in timestamp order.
+class ParallelIngestor {
+ public:
+  ParallelIngestor(EventStore* store, ThreadPool* pool);
+  ParallelIngestor(const ParallelIngestor&) = delete;
+  ParallelIngestor& operator=(const ParallelIngestor&) = delete;
+  ParallelIngestor(ParallelIngestor&&) = delete;
+  ParallelIngestor& operator=(ParallelIngestor&&) = delete;
+  ~ParallelIngestor() = default;
+
+  void IngestFile(const std::string& path);
+  void Ingest(std::string_view data);
+
+ private:
+  static constexpr std::size_t kChunksPerThread{4};
+  static constexpr std::size_t kMinChunkSize{1 << 20};
+  EventStore* store_;
+  ThreadPool* pool_;
+};
+
+}  // namespace audit
+
+#endif  // AUDIT_PARALLEL_INGESTOR_H_
@@ -0,0 +1,163 @@
+#include "audit/path_dictionary.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace audit {
+
+namespace {
+
+// A walk of the links costs about as much per node as this many nodes of
+// a sequential scan.
+constexpr std::size_t kScanRatio{64};
+
+}  // namespace
+
+PathDictionary::PathDictionary() {
+  parents_.PushBack(kNone);
+  components_.PushBack(0);
+  first_children_.EmplaceBack().store(kNone, std::memory_order_relaxed);
+  next_siblings_.PushBack(kNone);
+  size_.store(1, std::memory_order_release);
+}
+
+std::uint64_t PathDictionary::Hash(Id parent,
+                                   StringDictionary::Id component) {
+  auto value{std::uint64_t{parent} << 32 | component};
+  value ^= value >> 33;
+  value *= 0xff51afd7ed558ccdULL;
+  return value ^ (value >> 33);
+}
+
+PathDictionary::Id PathDictionary::Intern(std::string_view path) {
+  auto nodes{parents_.Size()};
+  auto bytes{path.size()};
+  Id node{0};
+  while (!path.empty()) {
+    auto end{std::min(path.find('/'), path.size() - 1) + 1};
+    auto names{names_.Size()};
+    auto component{names_.Intern(path.substr(0, end))};
+    if (names_.Size() != names) {
+      name_bytes_.fetch_add(end, std::memory_order_relaxed);
+    }
+    node = Child(node, component);
+    path.remove_prefix(end);
+  }
+  if (node >= nodes) path_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+  return node;
+}
+
+// Finds or adds the node of `component` under `parent`.
+PathDictionary::Id PathDictionary::Child(Id parent,
+                                         StringDictionary::Id component) {
+  auto mask{slots_.size() - 1};
+  auto slot{slots_.empty() ? 0 : Hash(parent, component) & mask};
+  for (; !slots_.empty() && slots_[slot] != kNone; slot = (slot + 1) & mask) {
+    auto node{slots_[slot]};
+    if (parents_[node] == parent && components_[node] == component) {
+      return node;
+    }
+  }
+  auto node{parents_.Size()};
+  if (node >= kNone) throw std::runtime_error("path dictionary is full!");
+  parents_.PushBack(parent);
+  components_.PushBack(component);
+  first_children_.EmplaceBack().store(kNone, std::memory_order_relaxed);
+  auto& first_child{first_children_.Mutable(parent)};
+  next_siblings_.PushBack(first_child.load(std::memory_order_relaxed));
+  first_child.store(static_cast<Id>(node), std::memory_order_release);
+  if (2 * (node + 1) > slots_.size()) {
+    Rehash(std::max<std::size_t>(2 * slots_.size(), 1024));
+  } else {
+    slots_[slot] = static_cast<Id>(node);
+  }
+  size_.store(parents_.Size(), std::memory_order_release);
+  return static_cast<Id>(node);
+}
+
+void PathDictionary::Rehash(std::size_t capacity) {
+  slots_.assign(capacity, kNone);
+  auto mask{capacity - 1};
+  // Node 0 is the root, never a child.
+  for (std::size_t node{1}; node < parents_.Size(); ++node) {
+    auto slot{Hash(parents_[node], components_[node]) & mask};
+    while (slots_[slot] != kNone) slot = (slot + 1) & mask;
+    slots_[slot] = static_cast<Id>(node);
+  }
+  slot_count_.store(capacity, std::memory_order_relaxed);
+}
+
+void PathDictionary::Get(Id id, std::string* path) const {
+  std::vector<StringDictionary::Id> components{};
+  for (; id != 0; id = parents_[id]) components.push_back(components_[id]);
+  for (auto it{components.rbegin()}; it != components.rend(); ++it) {
+    path->append(names_.Get(*it));
+  }
+}
+
+Selection PathDictionary::Under(std::string_view directory,
+                                std::size_t paths) const {
+  paths = std::min(paths, Size());
+  Selection selection{paths};
+  std::string prefix{directory};
+  if (prefix.empty() || prefix.back() != '/') prefix.push_back('/');
+  // Nodes on the way to the directory with the bytes of the prefix their
+  // paths match, then nodes inside it. Ids of children are above their
+  // parent's, so a node from `paths` on has no children below it either.
+  std::vector<std::pair<Id, std::size_t>> ways{};
+  std::vector<Id> inside{};
+  if (paths > 0) ways.emplace_back(0, 0);
+  while (!ways.empty()) {
+    auto [node, state]{ways.back()};
+    ways.pop_back();
+    std::string_view rest{prefix};
+    rest.remove_prefix(state);
+    for (auto child{first_children_[node].load(std::memory_order_acquire)};
+         child != kNone; child = next_siblings_[child]) {
+      if (child >= paths) continue;
+      auto name{names_.Get(components_[child])};
+      if (name.size() >= rest.size() && name.substr(0, rest.size()) == rest) {
+        inside.push_back(child);
+      } else if (rest.substr(0, name.size()) == name) {
+        ways.emplace_back(child, state + name.size());
+      }
+    }
+  }
+  // The subtrees are walked through their links while that costs well
+  // below a scan of the ids from the first of them, which then takes over.
+  auto first{paths};
+  for (auto node : inside) {
+    selection.Set(node);
+    first = std::min<std::size_t>(first, node);
+  }
+  auto budget{(paths - first) / kScanRatio};
+  while (!inside.empty() && budget > 0) {
+    auto node{inside.back()};
+    inside.pop_back();
+    for (auto child{first_children_[node].load(std::memory_order_acquire)};
+         child != kNone && budget > 0; child = next_siblings_[child]) {
+      if (child >= paths) continue;
+      selection.Set(child);
+      inside.push_back(child);
+      --budget;
+    }
+  }
+  if (!inside.empty()) {
+    for (auto node{first + 1}; node < paths; ++node) {
+      if (selection.Test(parents_[node])) selection.Set(node);
+    }
+  }
+  selection.Finalize();
+  return selection;
+}
+
+std::size_t PathDictionary::ByteSize() const {
+  return Size() * (3 * sizeof(Id) + sizeof(StringDictionary::Id)) +
+         slot_count_.load(std::memory_order_relaxed) * sizeof(Id) +
+         names_.Size() * sizeof(std::string_view) +
+         name_bytes_.load(std::memory_order_relaxed);
+}
+
+}  // namespace audit
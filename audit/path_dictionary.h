@@ -0,0 +1,83 @@
+#ifndef AUDIT_PATH_DICTIONARY_H_
+#define AUDIT_PATH_DICTIONARY_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "audit/chunked_column.h"
+#include "audit/selection.h"
+#include "audit/string_dictionary.h"
+
+namespace audit {
+
+// Interns paths into a dense id space as a trie of components, so a prefix
+// shared by a million paths is stored once. A component keeps the slash
+// that ends it: "/etc/ssh/sshd_config" is "/", "etc/", "ssh/" and
+// "sshd_config", and every path is its parent's path plus one component.
+// A node is 16 bytes: its parent and component ids, and links to its newest
+// child and next older sibling; component strings live in a
+// StringDictionary. Id 0 is always the empty path.
+//
+// The paths under a directory are found by following the links down to it,
+// comparing only the children of its ancestors, and then visiting its
+// subtree. Readers on other threads may use ids below Size() while a single
+// writer interns.
+class PathDictionary {
+ public:
+  using Id = std::uint32_t;
+
+  PathDictionary();
+  PathDictionary(const PathDictionary&) = delete;
+  PathDictionary& operator=(const PathDictionary&) = delete;
+  PathDictionary(PathDictionary&&) = delete;
+  PathDictionary& operator=(PathDictionary&&) = delete;
+  ~PathDictionary() = default;
+
+  // Writer thread only.
+  Id Intern(std::string_view path);
+  // Appends the path of `id` to `path`.
+  void Get(Id id, std::string* path) const;
+  std::size_t Size() const { return size_.load(std::memory_order_acquire); }
+  // Paths starting with `directory` followed by a slash, and the directory
+  // itself if it was interned with a trailing slash, among the first
+  // `paths` ids.
+  Selection Under(std::string_view directory, std::size_t paths) const;
+  // Bytes of the nodes, the intern table and the component strings.
+  std::size_t ByteSize() const;
+  // Bytes the interned paths take as separate strings. A path first added
+  // as the directory of another one is not counted.
+  std::size_t PathBytes() const {
+    return path_bytes_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  static constexpr Id kNone{~Id{0}};
+
+  static std::uint64_t Hash(Id parent, StringDictionary::Id component);
+  Id Child(Id parent, StringDictionary::Id component);
+  void Rehash(std::size_t capacity);
+
+  ChunkedColumn<Id> parents_{};
+  ChunkedColumn<StringDictionary::Id> components_{};
+  // Children are prepended, so a node's first child is the only link that
+  // changes after it is added; kNone ends a list.
+  ChunkedColumn<std::atomic<Id>> first_children_{};
+  ChunkedColumn<Id> next_siblings_{};
+  StringDictionary names_{};
+  // Writer only: node ids by (parent, component), kNone where empty; at
+  // most half full.
+  std::vector<Id> slots_{};
+  // Published for ByteSize() and PathBytes() on other threads.
+  std::atomic<std::size_t> slot_count_{0};
+  std::atomic<std::size_t> name_bytes_{0};
+  std::atomic<std::size_t> path_bytes_{0};
+  std::atomic<std::size_t> size_{0};
+};
+
+}  // namespace audit
+
+#endif  // AUDIT_PATH_DICTIONARY_H_
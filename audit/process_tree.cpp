@@ -0,0 +1,133 @@
+#include "audit/process_tree.h"
+
+#include <algorithm>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+
+#include "audit/event_store.h"
+
+namespace audit {
+
+ProcessTree::ProcessTree(const ChunkedColumn<std::int64_t>* times,
+                         const ChunkedColumn<std::int64_t>* exit_times)
+    : times_{times}, exit_times_{exit_times} {}
+
+void ProcessTree::Update(const EventStore& store) {
+  auto rows{store.Size()};
+  auto exits{store.ExitCount()};
+  if (rows >= kReplaced || exits >= kReplaced) {
+    throw std::runtime_error("process tree is full!");
+  }
+  // Both streams are in time order; the lock is taken per batch.
+  while (nodes_.size() < rows || exits_ < exits) {
+    std::unique_lock lock{mutex_};
+    for (std::size_t n{0}; n < kUpdateBatch; ++n) {
+      bool row{nodes_.size() < rows};
+      if (row && exits_ < exits) {
+        row = (*times_)[nodes_.size()] <= (*exit_times_)[exits_];
+      }
+      if (row) {
+        AddProcess(store, nodes_.size());
+      } else if (exits_ < exits) {
+        AddExit(store, exits_++);
+      } else {
+        break;
+      }
+    }
+    size_.store(nodes_.size(), std::memory_order_release);
+    exit_count_.store(exits_, std::memory_order_release);
+  }
+}
+
+void ProcessTree::AddProcess(const EventStore& store, std::size_t row) {
+  auto id{static_cast<NodeId>(row)};
+  auto host{store.Hosts()[row]};
+  nodes_.emplace_back();
+  ends_.EmplaceBack().store(kNone, std::memory_order_relaxed);
+  auto& node{nodes_.back()};
+  auto parent{running_.find(Key(host, store.Ppids()[row]))};
+  if (parent != running_.end()) {
+    node.parent = parent->second;
+    node.next_sibling = nodes_[parent->second].first_child;
+    nodes_[parent->second].first_child = id;
+  }
+  auto [it, inserted]{running_.try_emplace(Key(host, store.Pids()[row]), id)};
+  if (!inserted) {
+    ends_.Mutable(it->second).store(kReplaced | id, std::memory_order_release);
+    it->second = id;
+  } else if (running_.size() > kMaxRunning) {
+    EvictOldest();
+  }
+}
+
+// An exited process gets no more children, so it leaves `running_`.
+void ProcessTree::AddExit(const EventStore& store, std::size_t exit) {
+  auto it{
+      running_.find(Key(store.ExitHosts()[exit], store.ExitPids()[exit]))};
+  if (it == running_.end()) return;
+  ends_.Mutable(it->second)
+      .store(static_cast<NodeId>(exit), std::memory_order_release);
+  running_.erase(it);
+}
+
+// Drops at least half of the running processes, the ones that started
+// first, so eviction costs O(1) amortized per process.
+void ProcessTree::EvictOldest() {
+  std::vector<std::int64_t> starts{};
+  starts.reserve(running_.size());
+  for (const auto& [key, id] : running_) starts.push_back((*times_)[id]);
+  auto middle{starts.begin() + static_cast<std::ptrdiff_t>(starts.size() / 2)};
+  std::nth_element(starts.begin(), middle, starts.end());
+  auto cutoff{*middle};
+  for (auto it{running_.begin()}; it != running_.end();) {
+    it = (*times_)[it->second] <= cutoff ? running_.erase(it) : std::next(it);
+  }
+}
+
+std::int64_t ProcessTree::EndTime(NodeId end) const {
+  if (end == kNone) return std::numeric_limits<std::int64_t>::max();
+  if (end & kReplaced) return (*times_)[end & ~kReplaced];
+  return (*exit_times_)[end];
+}
+
+void ProcessTree::Ancestors(std::size_t row,
+                            std::vector<std::size_t>* rows) const {
+  std::shared_lock lock{mutex_};
+  if (row >= nodes_.size()) return;
+  // A parent is always an older node, so the chain ends.
+  for (auto id{nodes_[row].parent}; id != kNone; id = nodes_[id].parent) {
+    rows->push_back(id);
+  }
+}
+
+void ProcessTree::Descendants(std::size_t row, std::int64_t from,
+                              std::int64_t to,
+                              std::vector<std::size_t>* rows) const {
+  std::shared_lock lock{mutex_};
+  if (row >= nodes_.size()) return;
+  std::vector<NodeId> stack{nodes_[row].first_child};
+  while (!stack.empty()) {
+    auto id{stack.back()};
+    stack.pop_back();
+    if (id == kNone) continue;
+    const auto& node{nodes_[id]};
+    stack.push_back(node.next_sibling);
+    // Descendants start no earlier than their ancestors.
+    if ((*times_)[id] > to) continue;
+    if (EndTime(ends_[id].load(std::memory_order_relaxed)) >= from) {
+      rows->push_back(id);
+    }
+    stack.push_back(node.first_child);
+  }
+}
+
+std::optional<ProcessTree::End> ProcessTree::EndOf(std::size_t row) const {
+  if (row >= Size()) return std::nullopt;
+  auto end{ends_[row].load(std::memory_order_acquire)};
+  if (end == kNone) return std::nullopt;
+  if (end & kReplaced) return End{EndTime(end), std::nullopt};
+  return End{EndTime(end), end};
+}
+
+}  // namespace audit
@@ -0,0 +1,109 @@
+#ifndef AUDIT_PROCESS_TREE_H_
+#define AUDIT_PROCESS_TREE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "audit/chunked_column.h"
+
+namespace audit {
+
+class EventStore;
+
+// Process tree over the creation rows and exits of an EventStore. Node `i`
+// is the process created at row `i`, so a process is identified by (host,
+// pid, start time) and reused pids are separate nodes. The parent of a
+// process is the newest process with its ppid on its host that started no
+// later. A new process with a pid that is still running ends the previous
+// one: either it was replaced by exec or its exit was not logged.
+//
+// Building the tree is a streaming hash join of creations with exits on
+// (host, pid): running processes wait in a table that exits remove them
+// from. Exits of processes that started before the log are dropped. The
+// table is bounded by kMaxRunning; past it, the older half is evicted and
+// treated as if their exits were not logged.
+class ProcessTree {
+ public:
+  // How a process ended: at its exit, the index of which in the exit
+  // stream is `exit`, or at the start of the process that replaced it.
+  struct End {
+    std::int64_t time{0};
+    std::optional<std::size_t> exit{};
+  };
+
+  ProcessTree(const ChunkedColumn<std::int64_t>* times,
+              const ChunkedColumn<std::int64_t>* exit_times);
+  ProcessTree(const ProcessTree&) = delete;
+  ProcessTree& operator=(const ProcessTree&) = delete;
+  ProcessTree(ProcessTree&&) = delete;
+  ProcessTree& operator=(ProcessTree&&) = delete;
+  ~ProcessTree() = default;
+
+  // Adds the rows and exits appended to `store` since the last call in time
+  // order, creations first on ties. Writer thread only.
+  void Update(const EventStore& store);
+  std::size_t Size() const { return size_.load(std::memory_order_acquire); }
+  // Exits joined so far. Ends only change before this or Size() does, and
+  // never once set.
+  std::size_t ExitCount() const {
+    return exit_count_.load(std::memory_order_acquire);
+  }
+
+  // Rows of the ancestors of the process created at `row`, parent first.
+  void Ancestors(std::size_t row, std::vector<std::size_t>* rows) const;
+  // Rows of the descendants of the process created at `row` that were
+  // running at some point in [from, to]. Subtrees that start after `to` are
+  // not visited.
+  void Descendants(std::size_t row, std::int64_t from, std::int64_t to,
+                   std::vector<std::size_t>* rows) const;
+  // End of the process created at `row`, nullopt while running or not
+  // joined yet. Takes no lock, so it never waits for Update().
+  std::optional<End> EndOf(std::size_t row) const;
+
+ private:
+  using NodeId = std::uint32_t;
+  static constexpr NodeId kNone{std::numeric_limits<NodeId>::max()};
+  // Set in an end when it holds the replacing row rather than an exit.
+  static constexpr NodeId kReplaced{NodeId{1} << 31};
+  static constexpr std::size_t kMaxRunning{std::size_t{1} << 22};
+
+  // 12 bytes; the start time, host and pid are read from the store, and
+  // the end from ends_.
+  struct Node {
+    NodeId parent{kNone};
+    NodeId first_child{kNone};
+    NodeId next_sibling{kNone};
+  };
+
+  static std::uint64_t Key(std::uint32_t host, std::int32_t pid) {
+    return std::uint64_t{host} << 32 | static_cast<std::uint32_t>(pid);
+  }
+  void AddProcess(const EventStore& store, std::size_t row);
+  void AddExit(const EventStore& store, std::size_t exit);
+  void EvictOldest();
+  std::int64_t EndTime(NodeId end) const;
+
+  static constexpr std::size_t kUpdateBatch{4096};
+  const ChunkedColumn<std::int64_t>* times_;
+  const ChunkedColumn<std::int64_t>* exit_times_;
+  mutable std::shared_mutex mutex_{};
+  std::vector<Node> nodes_{};
+  // Per node, kNone while running, else an exit index or kReplaced | row.
+  // Readable without the lock below Size().
+  ChunkedColumn<std::atomic<NodeId>> ends_{};
+  // Newest running node of every (host, pid).
+  std::unordered_map<std::uint64_t, NodeId> running_{};
+  std::size_t exits_{0};
+  std::atomic<std::size_t> size_{0};
+  std::atomic<std::size_t> exit_count_{0};
+};
+
+}  // namespace audit
+
+#endif  // AUDIT_PROCESS_TREE_H_
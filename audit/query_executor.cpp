@@ -0,0 +1,45 @@
+#include "audit/query_executor.h"
+
+#include <cerrno>
+#include <stdexcept>
+
+namespace audit {
+
+QueryExecutor::QueryExecutor(std::size_t threads) {
+  if (sem_init(&semaphore_, 0, 0) != 0) {
+    throw std::runtime_error("failed to create semaphore!");
+  }
+  if (threads == 0) threads = 1;
+  workers_.reserve(threads);
+  for (std::size_t i{0}; i < threads; ++i) {
+    workers_.emplace_back([this] { Work(); });
+  }
+}
+
+QueryExecutor::~QueryExecutor() {
+  stop_.store(true, std::memory_order_release);
+  for (std::size_t i{0}; i < workers_.size(); ++i) sem_post(&semaphore_);
+  for (auto& worker : workers_) worker.join();
+  sem_destroy(&semaphore_);
+}
+
+bool QueryExecutor::Post(std::function<void()> task) {
+  if (!queue_.TryPush(std::move(task))) return false;
+  sem_post(&semaphore_);
+  return true;
+}
+
+void QueryExecutor::Work() {
+  while (true) {
+    while (sem_wait(&semaphore_) != 0 && errno == EINTR) {
+    }
+    if (stop_.load(std::memory_order_acquire)) return;
+    std::function<void()> task{};
+    // The token guarantees an item; a concurrent producer may still be
+    // finishing the write of an earlier slot.
+    while (!queue_.TryPop(&task)) std::this_thread::yield();
+    task();
+  }
+}
+
+}  // namespace audit
@@ -0,0 +1,159 @@
+#ifndef AUDIT_QUERY_EXECUTOR_H_
+#define AUDIT_QUERY_EXECUTOR_H_
+
+#include <semaphore.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "audit/mpmc_queue.h"
+
+namespace audit {
+
+// Worker pool for work that must stay off the render thread. Posting goes
+// through a lock-free queue and a semaphore, so the caller never waits on a
+// lock that a worker holds.
+class QueryExecutor {
+ public:
+  explicit QueryExecutor(
+      std::size_t threads = std::thread::hardware_concurrency());
+  QueryExecutor(const QueryExecutor&) = delete;
+  QueryExecutor& operator=(const QueryExecutor&) = delete;
+  QueryExecutor(QueryExecutor&&) = delete;
+  QueryExecutor& operator=(QueryExecutor&&) = delete;
+  ~QueryExecutor();
+
+  // Returns false if the queue is full; the caller may retry next frame.
+  bool Post(std::function<void()> task);
+
+ private:
+  void Work();
+
+  static constexpr std::size_t kQueueCapacity{1024};
+  MpmcQueue<std::function<void()>> queue_{kQueueCapacity};
+  sem_t semaphore_{};
+  std::atomic<bool> stop_{false};
+  std::vector<std::thread> workers_{};
+};
+
+// Wait-free handoff of immutable snapshots from workers to one reader.
+// Three slots rotate between the writer, the reader and the latest
+// published value, so neither side ever waits for the other.
+template <typename T>
+class SnapshotBuffer {
+ public:
+  // Writer side. Concurrent writers must serialize among themselves.
+  void Publish(std::shared_ptr<const T> value) {
+    slots_[back_] = std::move(value);
+    back_ = middle_.exchange(back_ | kFresh, std::memory_order_acq_rel) &
+            kIndexMask;
+  }
+
+  // Reader side: returns the most recently published snapshot.
+  const std::shared_ptr<const T>& Latest() {
+    if (middle_.load(std::memory_order_relaxed) & kFresh) {
+      front_ = middle_.exchange(front_, std::memory_order_acq_rel) & kIndexMask;
+    }
+    return slots_[front_];
+  }
+
+ private:
+  static constexpr unsigned kFresh{4};
+  static constexpr unsigned kIndexMask{3};
+  std::array<std::shared_ptr<const T>, 3> slots_{};
+  unsigned front_{0};
+  std::atomic<unsigned> middle_{1};
+  unsigned back_{2};
+};
+
+// A query the UI may restart at any time. Submit() cancels the computation
+// in flight; only results of the latest submission are published. Errors
+// thrown by a computation are logged rather than escaping the worker.
+template <typename Result>
+class AsyncQuery {
+ public:
+  using Compute = std::function<std::shared_ptr<const Result>(
+      const std::atomic<bool>& cancelled)>;
+
+  explicit AsyncQuery(QueryExecutor* executor) : executor_{executor} {}
+  AsyncQuery(const AsyncQuery&) = delete;
+  AsyncQuery& operator=(const AsyncQuery&) = delete;
+  AsyncQuery(AsyncQuery&&) = delete;
+  AsyncQuery& operator=(AsyncQuery&&) = delete;
+  ~AsyncQuery() {
+    if (cancelled_) cancelled_->store(true, std::memory_order_relaxed);
+  }
+
+  // Returns false if the executor's queue is full. The computation in
+  // flight then carries on, and Running() ends when it does.
+  bool Submit(Compute compute) {
+    auto cancelled{std::make_shared<std::atomic<bool>>(false)};
+    auto generation{state_->submitted + 1};
+    auto posted{executor_->Post([state = state_, cancelled, generation,
+                                 compute = std::move(compute)] {
+      if (cancelled->load(std::memory_order_relaxed)) return;
+      std::shared_ptr<const Result> result{};
+      bool failed{false};
+      try {
+        result = compute(*cancelled);
+      } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        failed = true;
+      }
+      if (cancelled->load(std::memory_order_relaxed)) return;
+      std::lock_guard lock{state->writer_mutex};
+      if (generation <= state->completed.load(std::memory_order_relaxed)) {
+        return;
+      }
+      // A failed computation keeps the previous snapshot but still ends
+      // its generation, so Running() clears.
+      if (!failed) state->snapshots.Publish(std::move(result));
+      state->completed.store(generation, std::memory_order_release);
+    })};
+    if (!posted) {
+      running_ = state_->completed.load(std::memory_order_acquire) !=
+                 state_->submitted;
+      return false;
+    }
+    if (cancelled_) cancelled_->store(true, std::memory_order_relaxed);
+    cancelled_ = std::move(cancelled);
+    state_->submitted = generation;
+    running_ = true;
+    return true;
+  }
+
+  const std::shared_ptr<const Result>& Snapshot() {
+    running_ = state_->completed.load(std::memory_order_acquire) !=
+               state_->submitted;
+    return state_->snapshots.Latest();
+  }
+
+  bool Running() const { return running_; }
+
+ private:
+  // Shared with in-flight tasks, which may outlive the query object.
+  struct State {
+    SnapshotBuffer<Result> snapshots{};
+    std::mutex writer_mutex{};
+    std::uint64_t submitted{0};
+    std::atomic<std::uint64_t> completed{0};
+  };
+
+  QueryExecutor* executor_;
+  std::shared_ptr<State> state_{std::make_shared<State>()};
+  std::shared_ptr<std::atomic<bool>> cancelled_{};
+  bool running_{false};
+};
+
+}  // namespace audit
+
+#endif  // AUDIT_QUERY_EXECUTOR_H_
@@ -0,0 +1,202 @@
+#include "audit/rollups.h"
+
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+
+#include "audit/event_store.h"
+
+namespace audit {
+
+namespace {
+
+std::int64_t FloorDiv(std::int64_t value, std::int64_t divisor) {
+  auto quotient{value / divisor};
+  return quotient * divisor > value ? quotient - 1 : quotient;
+}
+
+std::int64_t CeilDiv(std::int64_t value, std::int64_t divisor) {
+  auto quotient{value / divisor};
+  return quotient * divisor < value ? quotient + 1 : quotient;
+}
+
+// Adds `delta` to `counts`, both sorted by value. Values already counted
+// are added in place, so only new values cost a pass over `counts`.
+template <typename Count>
+void AddCounts(const std::vector<Count>& delta, std::vector<Count>* counts,
+               std::vector<Count>* scratch) {
+  auto less{[](const Count& count, std::uint32_t value) {
+    return count.first < value;
+  }};
+  bool added{true};
+  auto it{counts->begin()};
+  for (auto [value, rows] : delta) {
+    it = std::lower_bound(it, counts->end(), value, less);
+    if (it != counts->end() && it->first == value) {
+      it->second += rows;
+    } else {
+      added = false;
+    }
+  }
+  if (added) return;
+  scratch->clear();
+  it = counts->begin();
+  for (auto [value, rows] : delta) {
+    for (; it != counts->end() && it->first < value; ++it) {
+      scratch->push_back(*it);
+    }
+    if (it == counts->end() || it->first != value) {
+      scratch->emplace_back(value, rows);
+    }
+  }
+  scratch->insert(scratch->end(), it, counts->end());
+  counts->swap(*scratch);
+}
+
+}  // namespace
+
+std::uint32_t Rollups::UidSlot(std::uint32_t uid) {
+  auto [it, added]{uid_slots_.try_emplace(
+      uid, static_cast<std::uint32_t>(slot_uids_.size()))};
+  if (added) slot_uids_.push_back(uid);
+  return it->second;
+}
+
+void Rollups::Commit(std::size_t level) {
+  auto& run{runs_[level]};
+  if (run.rows == 0) return;
+  auto& bucket{levels_[level][run.key]};
+  bucket.rows += run.rows;
+  run.rows = 0;
+  for (std::size_t i{0}; i < kDimensionCount; ++i) {
+    delta_.clear();
+    for (auto value : run.seen[i]) {
+      delta_.emplace_back(i == 0 ? slot_uids_[value] : value,
+                          run.tallies[i][value]);
+      run.tallies[i][value] = 0;
+    }
+    run.seen[i].clear();
+    std::sort(delta_.begin(), delta_.end());
+    AddCounts(delta_, &bucket.counts[i], &scratch_);
+  }
+}
+
+template <typename Visitor>
+void Rollups::Cover(std::size_t level, std::int64_t first, std::int64_t last,
+                    const Visitor& visit) const {
+  if (first >= last) return;
+  auto width{kWidths[level] / kWidths[0]};
+  auto begin{CeilDiv(first, width)};
+  auto end{FloorDiv(last, width)};
+  if (begin >= end) {
+    Cover(level - 1, first, last, visit);
+    return;
+  }
+  if (level > 0) Cover(level - 1, first, begin * width, visit);
+  const auto& buckets{levels_[level]};
+  for (auto it{buckets.lower_bound(begin)};
+       it != buckets.end() && it->first < end; ++it) {
+    visit(it->second);
+  }
+  if (level > 0) Cover(level - 1, end * width, last, visit);
+}
+
+void Rollups::Update(const EventStore& store) {
+  auto rows{store.Size()};
+  std::vector<std::pair<std::int64_t, std::size_t>> chunk{};
+  auto first{rows_.load(std::memory_order_relaxed)};
+  while (first < rows) {
+    auto last{std::min(rows, first + kUpdateRows)};
+    chunk.clear();
+    for (auto row{first}; row < last; ++row) {
+      chunk.emplace_back(store.Times()[row], row);
+    }
+    // In time order every bucket is filled in one run.
+    if (!std::is_sorted(chunk.begin(), chunk.end())) {
+      std::sort(chunk.begin(), chunk.end());
+    }
+    std::unique_lock lock{mutex_};
+    span_ = std::pair{std::min(span_ ? span_->first : chunk.front().first,
+                               chunk.front().first),
+                      std::max(span_ ? span_->second : chunk.back().first,
+                               chunk.back().first)};
+    for (auto [time, row] : chunk) {
+      std::array<std::uint32_t, kDimensionCount> values{
+          UidSlot(store.Uids()[row]), store.Commands()[row],
+          store.Hosts()[row]};
+      for (std::size_t level{0}; level < kLevelCount; ++level) {
+        auto& run{runs_[level]};
+        auto key{FloorDiv(time, kWidths[level])};
+        if (run.rows != 0 && run.key != key) Commit(level);
+        run.key = key;
+        ++run.rows;
+        for (std::size_t i{0}; i < kDimensionCount; ++i) {
+          auto& tally{run.tallies[i]};
+          if (values[i] >= tally.size()) tally.resize(values[i] + 1);
+          if (tally[values[i]]++ == 0) run.seen[i].push_back(values[i]);
+        }
+      }
+    }
+    for (std::size_t level{0}; level < kLevelCount; ++level) Commit(level);
+    rows_.store(last, std::memory_order_release);
+    first = last;
+  }
+}
+
+std::optional<std::pair<std::int64_t, std::int64_t>> Rollups::Span() const {
+  std::shared_lock lock{mutex_};
+  return span_;
+}
+
+void Rollups::Summarize(std::int64_t from, std::int64_t to, std::size_t limit,
+                        Summary* summary) const {
+  *summary = {};
+  if (from > to) return;
+  std::array<std::unordered_map<std::uint32_t, std::size_t>, kDimensionCount>
+      totals{};
+  {
+    std::shared_lock lock{mutex_};
+    Cover(kLevelCount - 1, FloorDiv(from, kWidths[0]),
+          FloorDiv(to, kWidths[0]) + 1, [&](const Bucket& bucket) {
+            summary->rows += bucket.rows;
+            for (std::size_t i{0}; i < kDimensionCount; ++i) {
+              for (auto [value, rows] : bucket.counts[i]) {
+                totals[i][value] += rows;
+              }
+            }
+          });
+  }
+  for (std::size_t i{0}; i < kDimensionCount; ++i) {
+    auto& top{summary->top[i]};
+    top.assign(totals[i].begin(), totals[i].end());
+    auto end{top.begin() + static_cast<std::ptrdiff_t>(
+                               std::min(limit, top.size()))};
+    std::partial_sort(top.begin(), end, top.end(),
+                      [](const auto& a, const auto& b) {
+                        return a.second > b.second ||
+                               (a.second == b.second && a.first < b.first);
+                      });
+    top.erase(end, top.end());
+  }
+}
+
+void Rollups::Histogram(Level level, std::int64_t from, std::int64_t to,
+                        std::vector<std::size_t>* rows) const {
+  rows->clear();
+  std::shared_lock lock{mutex_};
+  if (!span_) return;
+  from = std::max(from, span_->first);
+  to = std::min(to, span_->second);
+  if (from > to) return;
+  auto width{kWidths[static_cast<std::size_t>(level)]};
+  auto first{FloorDiv(from, width)};
+  auto last{FloorDiv(to, width)};
+  rows->resize(static_cast<std::size_t>(last - first + 1));
+  const auto& buckets{levels_[static_cast<std::size_t>(level)]};
+  for (auto it{buckets.lower_bound(first)};
+       it != buckets.end() && it->first <= last; ++it) {
+    (*rows)[static_cast<std::size_t>(it->first - first)] = it->second.rows;
+  }
+}
+
+}  // namespace audit
@@ -0,0 +1,112 @@
+#ifndef AUDIT_ROLLUPS_H_
+#define AUDIT_ROLLUPS_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <shared_mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace audit {
+
+class EventStore;
+
+// Row counts of an EventStore per time bucket, in total and per uid,
+// command and host, kept at three levels: minutes, hours and days. Every
+// row is counted at all levels as it is added, so a range is covered by the
+// widest buckets that fit in it and the narrower ones at its edges: a month
+// merges about thirty days and a few hundred edge buckets, however many
+// rows it holds.
+class Rollups {
+ public:
+  enum class Level { kMinute, kHour, kDay };
+  static constexpr std::size_t kLevelCount{3};
+  enum class Dimension { kUid, kCommand, kHost };
+  static constexpr std::size_t kDimensionCount{3};
+  // (value, rows) pairs; command and host values are dictionary ids.
+  using Counts = std::vector<std::pair<std::uint32_t, std::size_t>>;
+
+  struct Summary {
+    std::size_t rows{0};
+    // The most frequent values of each dimension, most frequent first.
+    std::array<Counts, kDimensionCount> top{};
+  };
+
+  Rollups() = default;
+  Rollups(const Rollups&) = delete;
+  Rollups& operator=(const Rollups&) = delete;
+  Rollups(Rollups&&) = delete;
+  Rollups& operator=(Rollups&&) = delete;
+  ~Rollups() = default;
+
+  // Counts the rows appended to `store` since the last call. Writer thread
+  // only.
+  void Update(const EventStore& store);
+  // Rows counted so far.
+  std::size_t Size() const { return rows_.load(std::memory_order_acquire); }
+  // Times of the earliest and the latest row counted.
+  std::optional<std::pair<std::int64_t, std::int64_t>> Span() const;
+
+  // Summary of the rows in the minutes that overlap [from, to], with at
+  // most `limit` values per dimension.
+  void Summarize(std::int64_t from, std::int64_t to, std::size_t limit,
+                 Summary* summary) const;
+  // Rows per bucket of `level` for the buckets that overlap [from, to].
+  void Histogram(Level level, std::int64_t from, std::int64_t to,
+                 std::vector<std::size_t>* rows) const;
+  // Milliseconds per bucket of `level`.
+  static constexpr std::int64_t Width(Level level) {
+    return kWidths[static_cast<std::size_t>(level)];
+  }
+
+ private:
+  // (value, rows) pairs sorted by value.
+  using Count = std::pair<std::uint32_t, std::uint32_t>;
+  struct Bucket {
+    std::size_t rows{0};
+    std::array<std::vector<Count>, kDimensionCount> counts{};
+  };
+  using Buckets = std::map<std::int64_t, Bucket>;
+  // Rows of the bucket being filled at one level, counted by dense value:
+  // command and host ids as they are, uids by the slot given to each.
+  struct Run {
+    std::int64_t key{0};
+    std::size_t rows{0};
+    std::array<std::vector<std::uint32_t>, kDimensionCount> tallies{};
+    std::array<std::vector<std::uint32_t>, kDimensionCount> seen{};
+  };
+
+  static constexpr std::array<std::int64_t, kLevelCount> kWidths{
+      60'000, 3'600'000, 86'400'000};
+  static constexpr std::size_t kUpdateRows{std::size_t{1} << 14};
+
+  // Adds the buckets covering minutes [first, last) at `level` and below.
+  template <typename Visitor>
+  void Cover(std::size_t level, std::int64_t first, std::int64_t last,
+             const Visitor& visit) const;
+  std::uint32_t UidSlot(std::uint32_t uid);
+  // Adds the run of `level` to its bucket and empties it.
+  void Commit(std::size_t level);
+
+  // Guards everything below but the writer's scratch; Update() releases it
+  // every kUpdateRows rows.
+  mutable std::shared_mutex mutex_{};
+  std::array<Buckets, kLevelCount> levels_{};
+  std::optional<std::pair<std::int64_t, std::int64_t>> span_{};
+  std::atomic<std::size_t> rows_{0};
+  // Writer only.
+  std::array<Run, kLevelCount> runs_{};
+  std::unordered_map<std::uint32_t, std::uint32_t> uid_slots_{};
+  std::vector<std::uint32_t> slot_uids_{};
+  std::vector<Count> delta_{};
+  std::vector<Count> scratch_{};
+};
+
+}  // namespace audit
+
+#endif  // AUDIT_ROLLUPS_H_
@@ -0,0 +1,79 @@
+#include "audit/selection.h"
+
+#include <algorithm>
+
+namespace audit {
+
+Selection::Selection(std::size_t rows, bool selected)
+    : rows_{rows}, words_((rows + 63) / 64, selected ? ~std::uint64_t{0} : 0) {
+  ClearTail();
+}
+
+Selection& Selection::And(const Selection& other) {
+  auto words{std::min(words_.size(), other.words_.size())};
+  for (std::size_t i{0}; i < words; ++i) words_[i] &= other.words_[i];
+  std::fill(words_.begin() + static_cast<std::ptrdiff_t>(words), words_.end(),
+            0);
+  return *this;
+}
+
+Selection& Selection::Or(const Selection& other) {
+  auto words{std::min(words_.size(), other.words_.size())};
+  for (std::size_t i{0}; i < words; ++i) words_[i] |= other.words_[i];
+  return *this;
+}
+
+Selection& Selection::Not() {
+  for (auto& word : words_) word = ~word;
+  ClearTail();
+  return *this;
+}
+
+void Selection::ClearTail() {
+  if (rows_ % 64 != 0) {
+    words_.back() &= (std::uint64_t{1} << (rows_ % 64)) - 1;
+  }
+}
+
+void Selection::Finalize() {
+  ranks_.clear();
+  count_ = 0;
+  for (std::size_t i{0}; i < words_.size(); ++i) {
+    if (i % kWordsPerRank == 0) ranks_.push_back(count_);
+    count_ += static_cast<std::size_t>(__builtin_popcountll(words_[i]));
+  }
+}
+
+std::size_t Selection::Select(std::size_t rank) const {
+  auto it{std::upper_bound(ranks_.begin(), ranks_.end(), rank)};
+  auto block{static_cast<std::size_t>(it - ranks_.begin()) - 1};
+  auto remaining{rank - ranks_[block]};
+  for (auto word{block * kWordsPerRank}; word < words_.size(); ++word) {
+    auto bits{words_[word]};
+    auto count{static_cast<std::size_t>(__builtin_popcountll(bits))};
+    if (remaining < count) {
+      for (; remaining > 0; --remaining) bits &= bits - 1;
+      return word * 64 + static_cast<std::size_t>(__builtin_ctzll(bits));
+    }
+    remaining -= count;
+  }
+  return rows_;
+}
+
+void Selection::Select(std::size_t first, std::size_t last,
+                       std::vector<std::size_t>* rows) const {
+  if (first >= last || first >= count_) return;
+  auto row{Select(first)};
+  auto needed{std::min(last, count_) - first};
+  auto word{row >> 6};
+  auto bits{words_[word] & (~std::uint64_t{0} << (row & 63))};
+  while (needed > 0) {
+    while (bits == 0) bits = words_[++word];
+    rows->push_back(word * 64 +
+                    static_cast<std::size_t>(__builtin_ctzll(bits)));
+    bits &= bits - 1;
+    --needed;
+  }
+}
+
+}  // namespace audit
@@ -0,0 +1,54 @@
+#ifndef AUDIT_SELECTION_H_
+#define AUDIT_SELECTION_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace audit {
+
+// Bitmap of selected rows. Bit `i` of word `i / 64` stands for row `i`.
+// After Finalize() the selection can be paged by rank, which is how the
+// events table walks the rows of a filtered view.
+class Selection {
+ public:
+  Selection() = default;
+  explicit Selection(std::size_t rows, bool selected = false);
+
+  std::size_t Rows() const { return rows_; }
+  std::uint64_t* Words() { return words_.data(); }
+  const std::uint64_t* Words() const { return words_.data(); }
+  std::size_t WordCount() const { return words_.size(); }
+  bool Test(std::size_t row) const {
+    return (words_[row >> 6] >> (row & 63)) & 1;
+  }
+  void Set(std::size_t row) {
+    words_[row >> 6] |= std::uint64_t{1} << (row & 63);
+  }
+
+  Selection& And(const Selection& other);
+  Selection& Or(const Selection& other);
+  Selection& Not();
+
+  // Builds the rank directory used by Count() and Select().
+  void Finalize();
+  std::size_t Count() const { return count_; }
+  // Row index of the selected row with the given rank, i.e. the k-th set bit.
+  std::size_t Select(std::size_t rank) const;
+  // Appends the rows with ranks in [first, last) to `rows`.
+  void Select(std::size_t first, std::size_t last,
+              std::vector<std::size_t>* rows) const;
+
+ private:
+  void ClearTail();
+
+  static constexpr std::size_t kWordsPerRank{512};
+  std::size_t rows_{0};
+  std::vector<std::uint64_t> words_{};
+  std::vector<std::size_t> ranks_{};
+  std::size_t count_{0};
+};
+
+}  // namespace audit
+
+#endif  // AUDIT_SELECTION_H_
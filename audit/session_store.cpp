@@ -0,0 +1,140 @@
+#include "audit/session_store.h"
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+
+namespace audit {
+
+std::size_t SessionStore::OpenKeyHash::operator()(const OpenKey& key) const {
+  return std::hash<std::uint64_t>{}(
+      (std::uint64_t{key.host} << 32 | key.session) ^
+      (std::uint64_t{key.terminal} << 16));
+}
+
+SessionStore::OpenKey SessionStore::KeyOf(const Login& login) {
+  if (login.session != kNoSession) return {login.host, login.session, 0};
+  return {login.host, kNoSession, login.terminal};
+}
+
+void SessionStore::Append(const Login& login) {
+  std::unique_lock lock{mutex_};
+  if (login.kind == Kind::kLogin) {
+    Open(login);
+  } else if (login.kind == Kind::kBoot) {
+    for (auto it{open_.begin()}; it != open_.end();) {
+      if (it->first.host != login.host) {
+        ++it;
+        continue;
+      }
+      Close(it->second, login.time, true);
+      it = open_.erase(it);
+    }
+  } else {
+    auto it{open_.find(KeyOf(login))};
+    if (it == open_.end()) return;
+    // su and sudo end PAM sessions inside the login session too.
+    if (login.kind == Kind::kEnd && records_[it->second].pid != login.pid) {
+      return;
+    }
+    Close(it->second, login.time, false);
+    open_.erase(it);
+  }
+  changes_.fetch_add(1, std::memory_order_release);
+}
+
+void SessionStore::Open(const Login& login) {
+  if (records_.size() >= kNoSession) {
+    throw std::runtime_error("session store is full!");
+  }
+  auto session{static_cast<std::uint32_t>(records_.size())};
+  auto key{KeyOf(login)};
+  auto it{open_.find(key)};
+  // The session still open with this key lost its logout.
+  if (it != open_.end()) {
+    Close(it->second, login.time, false);
+    it->second = session;
+  } else {
+    open_.emplace(key, session);
+  }
+  records_.push_back({login.time, kOpen, login.host, login.uid, login.pid,
+                      login.terminal, login.address, false});
+  by_host_[login.host].Insert(login.time, kOpen, session);
+  by_user_[login.uid].Insert(login.time, kOpen, session);
+  by_user_on_host_[UserOnHost(login.uid, login.host)].Insert(login.time, kOpen,
+                                                            session);
+}
+
+void SessionStore::Close(std::uint32_t session, std::int64_t time,
+                         bool rebooted) {
+  auto& record{records_[session]};
+  record.end = std::max(time, record.begin);
+  record.rebooted = rebooted;
+  by_host_[record.host].SetEnd(record.begin, session, record.end);
+  by_user_[record.uid].SetEnd(record.begin, session, record.end);
+  by_user_on_host_[UserOnHost(record.uid, record.host)].SetEnd(
+      record.begin, session, record.end);
+}
+
+std::size_t SessionStore::Size() const {
+  std::shared_lock lock{mutex_};
+  return records_.size();
+}
+
+std::size_t SessionStore::OpenCount() const {
+  std::shared_lock lock{mutex_};
+  return open_.size();
+}
+
+std::size_t SessionStore::ByteSize() const {
+  std::shared_lock lock{mutex_};
+  auto bytes{records_.capacity() * sizeof(Record)};
+  for (const auto& [host, tree] : by_host_) bytes += tree.ByteSize();
+  for (const auto& [uid, tree] : by_user_) bytes += tree.ByteSize();
+  for (const auto& [key, tree] : by_user_on_host_) bytes += tree.ByteSize();
+  return bytes;
+}
+
+SessionStore::Session SessionStore::Get(std::size_t session) const {
+  std::shared_lock lock{mutex_};
+  const auto& record{records_[session]};
+  Session result{record.begin,    std::nullopt, record.rebooted,
+                 record.host,     record.uid,   record.terminal,
+                 record.address};
+  if (record.end != kOpen) result.end = record.end;
+  return result;
+}
+
+std::size_t SessionStore::FindOnHost(
+    Id host, std::int64_t begin, std::int64_t end, std::size_t limit,
+    std::vector<std::size_t>* sessions) const {
+  sessions->clear();
+  std::shared_lock lock{mutex_};
+  auto it{by_host_.find(host)};
+  return it == by_host_.end() ? 0
+                              : it->second.Find(begin, end, limit, sessions);
+}
+
+std::size_t SessionStore::FindOfUser(
+    std::uint32_t uid, std::int64_t begin, std::int64_t end,
+    std::size_t limit, std::vector<std::size_t>* sessions) const {
+  sessions->clear();
+  std::shared_lock lock{mutex_};
+  auto it{by_user_.find(uid)};
+  return it == by_user_.end() ? 0
+                              : it->second.Find(begin, end, limit, sessions);
+}
+
+std::size_t SessionStore::FindOfUserOnHost(
+    std::uint32_t uid, Id host, std::int64_t begin, std::int64_t end,
+    std::size_t limit, std::vector<std::size_t>* sessions) const {
+  sessions->clear();
+  std::shared_lock lock{mutex_};
+  auto it{by_user_on_host_.find(UserOnHost(uid, host))};
+  return it == by_user_on_host_.end()
+             ? 0
+             : it->second.Find(begin, end, limit, sessions);
+}
+
+}  // namespace audit
@@ -0,0 +1,148 @@
+#ifndef AUDIT_SESSION_STORE_H_
+#define AUDIT_SESSION_STORE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "audit/interval_tree.h"
+#include "audit/string_dictionary.h"
+
+namespace audit {
+
+// Login sessions behind the "Вход пользователей в систему" node, built
+// from login, logout and boot records. A session opens at a successful
+// login and is keyed by its host and audit session id, or by its terminal
+// when it has none. It closes at a logout with the same key, at the end of
+// the PAM session of the process that logged in, at a newer login with
+// the same key, or at a boot or shutdown of its host.
+//
+// Sessions are kept as intervals in a tree per host, per user and per user
+// on a host, so who was logged in on a host at a moment and the sessions
+// of a user during a range, on one host or all, are found in O(log n + k).
+// A single writer appends while any number of readers query.
+class SessionStore {
+ public:
+  using Id = StringDictionary::Id;
+
+  // Audit session id of a process that never logged in.
+  static constexpr std::uint32_t kNoSession{
+      std::numeric_limits<std::uint32_t>::max()};
+
+  // USER_LOGIN, USER_LOGOUT, USER_END and SYSTEM_BOOT or SYSTEM_SHUTDOWN.
+  enum class Kind : std::uint8_t { kLogin, kLogout, kEnd, kBoot };
+
+  // Login, logout or boot record with its host an id of the host
+  // dictionary, and its terminal and remote address ids of Origins().
+  struct Login {
+    Kind kind{Kind::kLogin};
+    std::int64_t time{0};
+    Id host{0};
+    std::uint32_t uid{0};
+    std::int32_t pid{0};
+    std::uint32_t session{kNoSession};
+    Id terminal{0};
+    Id address{0};
+  };
+
+  struct Session {
+    std::int64_t begin{0};
+    // Unset while the session is open.
+    std::optional<std::int64_t> end{};
+    // Closed by a boot or shutdown rather than by a logout.
+    bool rebooted{false};
+    Id host{0};
+    std::uint32_t uid{0};
+    Id terminal{0};
+    Id address{0};
+  };
+
+  SessionStore() = default;
+  SessionStore(const SessionStore&) = delete;
+  SessionStore& operator=(const SessionStore&) = delete;
+  SessionStore(SessionStore&&) = delete;
+  SessionStore& operator=(SessionStore&&) = delete;
+  ~SessionStore() = default;
+
+  // Records must arrive in time order per host. Writer thread only.
+  void Append(const Login& login);
+  // Interns a terminal or remote address. Writer thread only.
+  Id InternOrigin(std::string_view origin) { return origins_.Intern(origin); }
+  const StringDictionary& Origins() const { return origins_; }
+  // Counts the records that opened or closed sessions, to tell when cached
+  // answers went stale.
+  std::size_t Changes() const {
+    return changes_.load(std::memory_order_acquire);
+  }
+  std::size_t Size() const;
+  std::size_t OpenCount() const;
+  // Bytes held by the sessions and the trees.
+  std::size_t ByteSize() const;
+  Session Get(std::size_t session) const;
+  // Sessions on `host`, of `uid`, or of `uid` on `host`, overlapping
+  // [begin, end): the total and the first `limit` of them in login order.
+  std::size_t FindOnHost(Id host, std::int64_t begin, std::int64_t end,
+                         std::size_t limit,
+                         std::vector<std::size_t>* sessions) const;
+  std::size_t FindOfUser(std::uint32_t uid, std::int64_t begin,
+                         std::int64_t end, std::size_t limit,
+                         std::vector<std::size_t>* sessions) const;
+  std::size_t FindOfUserOnHost(std::uint32_t uid, Id host, std::int64_t begin,
+                               std::int64_t end, std::size_t limit,
+                               std::vector<std::size_t>* sessions) const;
+
+ private:
+  static constexpr std::int64_t kOpen{
+      std::numeric_limits<std::int64_t>::max()};
+
+  struct Record {
+    std::int64_t begin{0};
+    std::int64_t end{kOpen};
+    Id host{0};
+    std::uint32_t uid{0};
+    std::int32_t pid{0};
+    Id terminal{0};
+    Id address{0};
+    bool rebooted{false};
+  };
+  struct OpenKey {
+    Id host{0};
+    std::uint32_t session{kNoSession};
+    // Only when there is no session id.
+    Id terminal{0};
+    bool operator==(const OpenKey& other) const {
+      return host == other.host && session == other.session &&
+             terminal == other.terminal;
+    }
+  };
+  struct OpenKeyHash {
+    std::size_t operator()(const OpenKey& key) const;
+  };
+
+  static OpenKey KeyOf(const Login& login);
+  static std::uint64_t UserOnHost(std::uint32_t uid, Id host) {
+    return std::uint64_t{host} << 32 | uid;
+  }
+  void Open(const Login& login);
+  void Close(std::uint32_t session, std::int64_t time, bool rebooted);
+
+  mutable std::shared_mutex mutex_{};
+  StringDictionary origins_{};
+  std::vector<Record> records_{};
+  std::unordered_map<Id, IntervalTree> by_host_{};
+  std::unordered_map<std::uint32_t, IntervalTree> by_user_{};
+  std::unordered_map<std::uint64_t, IntervalTree> by_user_on_host_{};
+  // Session of every open key.
+  std::unordered_map<OpenKey, std::uint32_t, OpenKeyHash> open_{};
+  std::atomic<std::size_t> changes_{0};
+};
+
+}  // namespace audit
+
+#endif  // AUDIT_SESSION_STORE_H_
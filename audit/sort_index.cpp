@@ -0,0 +1,237 @@
+#include "audit/sort_index.h"
+
+#include <algorithm>
+#include <array>
+#include <future>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+
+namespace audit {
+
+namespace {
+
+constexpr std::size_t kDigitBits{8};
+constexpr std::size_t kBuckets{std::size_t{1} << kDigitBits};
+constexpr std::uint64_t kDigitMask{kBuckets - 1};
+// Smaller batches are sorted on the calling thread.
+constexpr std::size_t kParallelRows{std::size_t{1} << 16};
+
+// Sort keys compare as unsigned integers.
+std::uint64_t Key(std::int64_t value) {
+  return static_cast<std::uint64_t>(value) ^ (std::uint64_t{1} << 63);
+}
+std::uint64_t Key(std::int32_t value) {
+  return static_cast<std::uint32_t>(value) ^ (std::uint32_t{1} << 31);
+}
+std::uint64_t Key(std::uint32_t value) { return value; }
+
+std::size_t BitWidth(std::uint64_t value) {
+  std::size_t bits{0};
+  for (; value != 0; value >>= 1) ++bits;
+  return bits;
+}
+
+bool HasDictionary(SortIndex::Column column) {
+  return column == SortIndex::Column::kHost ||
+         column == SortIndex::Column::kCwd ||
+         column == SortIndex::Column::kCommand ||
+         column == SortIndex::Column::kArgs;
+}
+
+// Calls `visit` with a function from a row to its sort key. `ranks` maps
+// the ids of a string column to their lexicographic ranks.
+template <typename Visit>
+void VisitKey(const EventStore& store, SortIndex::Column column,
+              const std::vector<std::uint32_t>& ranks, Visit visit) {
+  auto plain{[](const auto& values) {
+    return [&values](std::size_t row) { return Key(values[row]); };
+  }};
+  auto ranked{[&ranks](const ChunkedColumn<StringDictionary::Id>& ids) {
+    return [&ranks, &ids](std::size_t row) {
+      return std::uint64_t{ranks[ids[row]]};
+    };
+  }};
+  switch (column) {
+    case SortIndex::Column::kTime:
+      return visit(plain(store.Times()));
+    case SortIndex::Column::kHost:
+      return visit(ranked(store.Hosts()));
+    case SortIndex::Column::kUid:
+      return visit(plain(store.Uids()));
+    case SortIndex::Column::kPid:
+      return visit(plain(store.Pids()));
+    case SortIndex::Column::kPpid:
+      return visit(plain(store.Ppids()));
+    case SortIndex::Column::kCwd:
+      return visit(ranked(store.Cwds()));
+    case SortIndex::Column::kCommand:
+      return visit(ranked(store.Commands()));
+    case SortIndex::Column::kArgs:
+      return visit(ranked(store.Args()));
+  }
+}
+
+// Runs `task(part)` for every part, part 0 on the calling thread.
+template <typename Task>
+void ForParts(ThreadPool* pool, std::size_t parts, const Task& task) {
+  std::vector<std::future<void>> futures{};
+  for (std::size_t part{1}; part < parts; ++part) {
+    futures.push_back(pool->Submit([&task, part] { task(part); }));
+  }
+  task(0);
+  for (auto& future : futures) future.get();
+}
+
+// Stable LSD radix sort of `values` by their bits [shift, shift + bits).
+// Every pass counts digits per part, then each part scatters its values to
+// the offsets reserved for it. Returns false if cancelled.
+bool RadixSort(std::vector<std::uint64_t>* values, std::size_t shift,
+               std::size_t bits, ThreadPool* pool,
+               const std::atomic<bool>& cancelled) {
+  auto size{values->size()};
+  std::size_t parts{pool && size >= kParallelRows ? pool->Size() : 1};
+  auto begin{[size, parts](std::size_t part) { return size * part / parts; }};
+  std::vector<std::array<std::size_t, kBuckets>> offsets(parts);
+  std::vector<std::uint64_t> sorted(size);
+  for (auto digit{shift}; digit < shift + bits; digit += kDigitBits) {
+    if (cancelled.load(std::memory_order_relaxed)) return false;
+    const auto* in{values->data()};
+    ForParts(pool, parts, [&](std::size_t part) {
+      auto& counts{offsets[part]};
+      counts.fill(0);
+      for (auto i{begin(part)}; i < begin(part + 1); ++i) {
+        ++counts[(in[i] >> digit) & kDigitMask];
+      }
+    });
+    std::size_t offset{0};
+    bool uniform{false};
+    for (std::size_t bucket{0}; bucket < kBuckets; ++bucket) {
+      auto first{offset};
+      for (auto& counts : offsets) {
+        auto count{counts[bucket]};
+        counts[bucket] = offset;
+        offset += count;
+      }
+      uniform = uniform || offset - first == size;
+    }
+    // A digit all values share moves nothing.
+    if (uniform) continue;
+    auto* out{sorted.data()};
+    ForParts(pool, parts, [&](std::size_t part) {
+      auto& next{offsets[part]};
+      for (auto i{begin(part)}; i < begin(part + 1); ++i) {
+        out[next[(in[i] >> digit) & kDigitMask]++] = in[i];
+      }
+    });
+    values->swap(sorted);
+  }
+  return true;
+}
+
+// Rows [first, last) ordered by `key`, ties by row. Each row is packed with
+// its key into one word, the key above the row offset, so only the key bits
+// are radix sorted. Keys too wide for that are compared instead.
+template <typename KeyOf>
+std::vector<std::uint32_t> SortRows(const KeyOf& key, std::size_t first,
+                                    std::size_t last, ThreadPool* pool,
+                                    const std::atomic<bool>& cancelled) {
+  std::vector<std::uint32_t> rows(last - first);
+  std::iota(rows.begin(), rows.end(), static_cast<std::uint32_t>(first));
+  if (rows.empty()) return rows;
+  std::vector<std::uint64_t> packed(rows.size());
+  auto low{std::numeric_limits<std::uint64_t>::max()};
+  std::uint64_t high{0};
+  for (std::size_t i{0}; i < packed.size(); ++i) {
+    packed[i] = key(first + i);
+    low = std::min(low, packed[i]);
+    high = std::max(high, packed[i]);
+  }
+  auto row_bits{BitWidth(rows.size() - 1)};
+  auto key_bits{BitWidth(high - low)};
+  if (row_bits + key_bits > 64) {
+    std::stable_sort(rows.begin(), rows.end(),
+                     [&key](std::uint32_t a, std::uint32_t b) {
+                       return key(a) < key(b);
+                     });
+    return rows;
+  }
+  for (std::size_t i{0}; i < packed.size(); ++i) {
+    packed[i] = (packed[i] - low) << row_bits | i;
+  }
+  if (!RadixSort(&packed, row_bits, key_bits, pool, cancelled)) return {};
+  auto mask{(std::uint64_t{1} << row_bits) - 1};
+  for (std::size_t i{0}; i < packed.size(); ++i) {
+    rows[i] = static_cast<std::uint32_t>(first + (packed[i] & mask));
+  }
+  return rows;
+}
+
+// Merges `batch` into `base`, both sorted by `less`, with items of the batch
+// after equal ones of base. The batch is usually much smaller, so each of
+// its items is placed by a binary search and base is copied in runs.
+template <typename T, typename Less>
+std::vector<T> MergeBatch(const std::vector<T>& base,
+                          const std::vector<T>& batch, const Less& less) {
+  std::vector<T> merged{};
+  merged.reserve(base.size() + batch.size());
+  auto from{base.begin()};
+  for (const auto& item : batch) {
+    auto to{std::upper_bound(from, base.end(), item, less)};
+    merged.insert(merged.end(), from, to);
+    merged.push_back(item);
+    from = to;
+  }
+  merged.insert(merged.end(), from, base.end());
+  return merged;
+}
+
+}  // namespace
+
+std::shared_ptr<const SortIndex> SortIndex::Build(
+    const EventStore& store, Column column, std::size_t rows,
+    const SortIndex* base, ThreadPool* pool,
+    const std::atomic<bool>& cancelled) {
+  if (rows > std::numeric_limits<std::uint32_t>::max()) {
+    throw std::runtime_error("sort index is full!");
+  }
+  if (base && (base->column_ != column || base->Size() > rows)) {
+    base = nullptr;
+  }
+  auto index{std::make_shared<SortIndex>(column)};
+  std::vector<std::uint32_t> ranks{};
+  if (HasDictionary(column)) {
+    // Read after `rows`, so every id of those rows is below it.
+    const auto& dictionary{store.Dictionary(column)};
+    std::vector<StringDictionary::Id> added(dictionary.Size() -
+                                            (base ? base->order_.size() : 0));
+    std::iota(added.begin(), added.end(),
+              static_cast<StringDictionary::Id>(base ? base->order_.size()
+                                                     : 0));
+    auto less{[&dictionary](StringDictionary::Id a, StringDictionary::Id b) {
+      return dictionary.Get(a) < dictionary.Get(b);
+    }};
+    std::sort(added.begin(), added.end(), less);
+    index->order_ =
+        base ? MergeBatch(base->order_, added, less) : std::move(added);
+    ranks.resize(index->order_.size());
+    for (std::size_t rank{0}; rank < index->order_.size(); ++rank) {
+      ranks[index->order_[rank]] = static_cast<std::uint32_t>(rank);
+    }
+  }
+  if (cancelled.load(std::memory_order_relaxed)) return nullptr;
+  VisitKey(store, column, ranks, [&](const auto& key) {
+    auto batch{SortRows(key, base ? base->Size() : 0, rows, pool, cancelled)};
+    if (cancelled.load(std::memory_order_relaxed)) return;
+    index->rows_ = base ? MergeBatch(base->rows_, batch,
+                                     [&key](std::uint32_t a, std::uint32_t b) {
+                                       return key(a) < key(b);
+                                     })
+                        : std::move(batch);
+  });
+  if (cancelled.load(std::memory_order_relaxed)) return nullptr;
+  return index;
+}
+
+}  // namespace audit
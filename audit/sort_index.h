@@ -0,0 +1,57 @@
+#ifndef AUDIT_SORT_INDEX_H_
+#define AUDIT_SORT_INDEX_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "audit/event_store.h"
+#include "audit/thread_pool.h"
+
+namespace audit {
+
+// Rows of an EventStore ordered by one column, ties broken by row. Numeric
+// columns sort by value and string columns by their strings, through the
+// lexicographic rank of each dictionary id; ids are assigned in arrival
+// order, so their own order means nothing.
+//
+// An index is immutable once built. A newer one is built from an older one
+// by sorting only the rows appended since and merging them in: old rows keep
+// their relative order as rows and strings are added, since ranks of old ids
+// only shift to make room for new ones.
+class SortIndex {
+ public:
+  using Column = EventStore::Column;
+
+  explicit SortIndex(Column column) : column_{column} {}
+  SortIndex(const SortIndex&) = delete;
+  SortIndex& operator=(const SortIndex&) = delete;
+  SortIndex(SortIndex&&) = delete;
+  SortIndex& operator=(SortIndex&&) = delete;
+  ~SortIndex() = default;
+
+  // Index of `column` over the first `rows` rows of `store`, extending
+  // `base` if it indexes the same column. The new rows are radix sorted on
+  // `pool`. Returns nullptr if `cancelled` is raised.
+  static std::shared_ptr<const SortIndex> Build(
+      const EventStore& store, Column column, std::size_t rows,
+      const SortIndex* base, ThreadPool* pool,
+      const std::atomic<bool>& cancelled);
+
+  Column GetColumn() const { return column_; }
+  std::size_t Size() const { return rows_.size(); }
+  // Rows in ascending order.
+  const std::vector<std::uint32_t>& Rows() const { return rows_; }
+
+ private:
+  Column column_;
+  std::vector<std::uint32_t> rows_{};
+  // String columns: dictionary ids ordered by their strings.
+  std::vector<StringDictionary::Id> order_{};
+};
+
+}  // namespace audit
+
+#endif  // AUDIT_SORT_INDEX_H_
@@ -0,0 +1,71 @@
+#ifndef AUDIT_SPSC_RING_H_
+#define AUDIT_SPSC_RING_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace audit {
+
+// Bounded lock-free single-producer single-consumer ring. The capacity must
+// be a power of two. Slots are written and read in place and never
+// destroyed, so values that own buffers keep them from one lap to the next.
+template <typename T>
+class SpscRing {
+ public:
+  explicit SpscRing(std::size_t capacity)
+      : slots_{std::make_unique<T[]>(capacity)}, mask_{capacity - 1} {}
+  SpscRing(const SpscRing&) = delete;
+  SpscRing& operator=(const SpscRing&) = delete;
+  SpscRing(SpscRing&&) = delete;
+  SpscRing& operator=(SpscRing&&) = delete;
+  ~SpscRing() = default;
+
+  // Producer: the slot to fill next, nullptr while the ring is full.
+  T* Back() {
+    auto tail{tail_.load(std::memory_order_relaxed)};
+    if (tail - head_cache_ > mask_) {
+      head_cache_ = head_.load(std::memory_order_acquire);
+      if (tail - head_cache_ > mask_) return nullptr;
+    }
+    return &slots_[tail & mask_];
+  }
+  // Producer: hands the slot returned by Back() to the consumer.
+  void Push() {
+    tail_.store(tail_.load(std::memory_order_relaxed) + 1,
+                std::memory_order_release);
+  }
+
+  // Consumer: the oldest slot, nullptr while the ring is empty.
+  T* Front() {
+    auto head{head_.load(std::memory_order_relaxed)};
+    if (head == tail_cache_) {
+      tail_cache_ = tail_.load(std::memory_order_acquire);
+      if (head == tail_cache_) return nullptr;
+    }
+    return &slots_[head & mask_];
+  }
+  // Consumer: returns the slot returned by Front() to the producer.
+  void Pop() {
+    head_.store(head_.load(std::memory_order_relaxed) + 1,
+                std::memory_order_release);
+  }
+
+  bool Empty() const {
+    return head_.load(std::memory_order_acquire) ==
+           tail_.load(std::memory_order_acquire);
+  }
+
+ private:
+  std::unique_ptr<T[]> slots_;
+  std::size_t mask_;
+  // Each side caches the other's index to touch its cache line less.
+  alignas(64) std::atomic<std::size_t> tail_{0};
+  std::size_t head_cache_{0};
+  alignas(64) std::atomic<std::size_t> head_{0};
+  std::size_t tail_cache_{0};
+};
+
+}  // namespace audit
+
+#endif  // AUDIT_SPSC_RING_H_
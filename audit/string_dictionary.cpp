@@ -0,0 +1,146 @@
+#include "audit/string_dictionary.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace audit {
+namespace {
+
+std::uint64_t Mix(std::uint64_t value) {
+  value ^= value >> 33;
+  value *= 0xff51afd7ed558ccdULL;
+  value ^= value >> 33;
+  value *= 0xc4ceb9fe1a85ec53ULL;
+  return value ^ (value >> 33);
+}
+
+}  // namespace
+
+StringDictionary::StringDictionary() { Intern({}); }
+
+std::uint64_t StringDictionary::Hash(std::string_view value) {
+  std::uint64_t hash{value.size() * 0x9e3779b97f4a7c15ULL};
+  std::size_t at{0};
+  for (; at + sizeof(hash) <= value.size(); at += sizeof(hash)) {
+    std::uint64_t word{0};
+    std::memcpy(&word, value.data() + at, sizeof(word));
+    hash = Mix(hash ^ word);
+  }
+  std::uint64_t tail{0};
+  if (at < value.size()) {
+    std::memcpy(&tail, value.data() + at, value.size() - at);
+  }
+  return Mix(hash ^ tail);
+}
+
+StringDictionary::Id StringDictionary::Intern(std::string_view value) {
+  if (auto id{Find(value)}) return *id;
+  auto id{AppendStored(Store(value))};
+  IndexPending();
+  return id;
+}
+
+StringDictionary::Id StringDictionary::AppendStored(std::string_view value) {
+  auto id{values_.Size()};
+  if (id >= kNoId) throw std::runtime_error("string dictionary is full!");
+  values_.PushBack(value);
+  size_.store(values_.Size(), std::memory_order_release);
+  return static_cast<Id>(id);
+}
+
+void StringDictionary::AddStoredBuckets(const std::uint32_t* offsets,
+                                        const Id* ids) {
+  stored_.push_back({offsets, ids});
+  bucket_stored_.resize(kBuckets, 0);
+  indexed_ = values_.Size();
+}
+
+void StringDictionary::GroupByBucket(Id first, Id last,
+                                     std::vector<std::uint32_t>* offsets,
+                                     std::vector<Id>* ids) const {
+  std::vector<std::uint16_t> buckets(last - first);
+  offsets->assign(kBuckets + 1, 0);
+  for (auto id{first}; id < last; ++id) {
+    buckets[id - first] = static_cast<std::uint16_t>(BucketOf(Hash(Get(id))));
+    ++(*offsets)[buckets[id - first] + 1];
+  }
+  for (std::size_t bucket{0}; bucket < kBuckets; ++bucket) {
+    (*offsets)[bucket + 1] += (*offsets)[bucket];
+  }
+  ids->resize(last - first);
+  auto next{*offsets};
+  for (auto id{first}; id < last; ++id) {
+    (*ids)[next[buckets[id - first]]++] = id;
+  }
+}
+
+std::optional<StringDictionary::Id> StringDictionary::Find(
+    std::string_view value) const {
+  IndexPending();
+  auto hash{Hash(value)};
+  if (!stored_.empty()) IndexBucket(BucketOf(hash));
+  if (slots_.empty()) return std::nullopt;
+  auto mask{slots_.size() - 1};
+  for (auto slot{hash & mask};; slot = (slot + 1) & mask) {
+    auto id{slots_[slot]};
+    if (id == kNoId) return std::nullopt;
+    if (values_[id] == value) return id;
+  }
+}
+
+void StringDictionary::IndexPending() const {
+  for (; indexed_ < values_.Size(); ++indexed_) {
+    auto id{static_cast<Id>(indexed_)};
+    Index(id, Hash(values_[id]));
+  }
+}
+
+void StringDictionary::IndexBucket(std::size_t bucket) const {
+  for (; bucket_stored_[bucket] < stored_.size(); ++bucket_stored_[bucket]) {
+    const auto& stored{stored_[bucket_stored_[bucket]]};
+    for (auto at{stored.offsets[bucket]}; at < stored.offsets[bucket + 1];
+         ++at) {
+      auto id{stored.ids[at]};
+      if (id >= indexed_) {
+        throw std::runtime_error("corrupt string dictionary index!");
+      }
+      Index(id, Hash(values_[id]));
+    }
+  }
+}
+
+void StringDictionary::Index(Id id, std::uint64_t hash) const {
+  if (2 * (entries_ + 1) > slots_.size()) {
+    auto old{std::move(slots_)};
+    slots_.assign(std::max<std::size_t>(2 * old.size(), 1024), kNoId);
+    for (auto indexed : old) {
+      if (indexed != kNoId) Place(indexed, Hash(values_[indexed]));
+    }
+  }
+  Place(id, hash);
+  ++entries_;
+}
+
+void StringDictionary::Place(Id id, std::uint64_t hash) const {
+  auto mask{slots_.size() - 1};
+  auto slot{hash & mask};
+  while (slots_[slot] != kNoId) slot = (slot + 1) & mask;
+  slots_[slot] = id;
+}
+
+std::string_view StringDictionary::Store(std::string_view value) {
+  if (value.empty()) return {};
+  if (value.size() > arena_capacity_ - arena_used_) {
+    arena_capacity_ = std::max(kArenaBlockSize, value.size());
+    arena_.emplace_back(new char[arena_capacity_]);
+    arena_used_ = 0;
+  }
+  char* data{arena_.back().get() + arena_used_};
+  std::memcpy(data, value.data(), value.size());
+  arena_used_ += value.size();
+  bytes_ += value.size();
+  return {data, value.size()};
+}
+
+}  // namespace audit
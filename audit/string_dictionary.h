@@ -0,0 +1,91 @@
+#ifndef AUDIT_STRING_DICTIONARY_H_
+#define AUDIT_STRING_DICTIONARY_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "audit/chunked_column.h"
+
+namespace audit {
+
+// Interns strings into a dense id space. Id 0 is always the empty string.
+// Interned bytes live packed in stable arena blocks, so the views returned
+// by Get() stay valid for the lifetime of the dictionary and may be read
+// from other threads for any id below Size(). Each value costs its bytes,
+// its view and about 8 bytes of open-addressing index, which matters for
+// the mostly unique argument strings.
+class StringDictionary {
+ public:
+  using Id = std::uint32_t;
+
+  StringDictionary();
+  StringDictionary(const StringDictionary&) = delete;
+  StringDictionary& operator=(const StringDictionary&) = delete;
+  StringDictionary(StringDictionary&&) = delete;
+  StringDictionary& operator=(StringDictionary&&) = delete;
+  ~StringDictionary() = default;
+
+  // Lookups split values into kBuckets buckets by the top bits of Hash().
+  static constexpr std::size_t kBuckets{4096};
+
+  Id Intern(std::string_view value);
+  // Appends `value` as the next id without copying it; the bytes must
+  // outlive the dictionary. Stored values are indexed by the next Intern()
+  // or Find(), so mapping a large dictionary does not read its bytes.
+  Id AppendStored(std::string_view value);
+  // Indexes the values stored since the last Intern() or AddStoredBuckets()
+  // one bucket at a time, on the first lookup that hashes into it. `offsets`
+  // and `ids` come from GroupByBucket() and must outlive the dictionary.
+  void AddStoredBuckets(const std::uint32_t* offsets, const Id* ids);
+  // Writes the ids in [first, last) grouped by bucket to `ids`, and the
+  // kBuckets + 1 bounds of the groups to `offsets`.
+  void GroupByBucket(Id first, Id last, std::vector<std::uint32_t>* offsets,
+                     std::vector<Id>* ids) const;
+  std::optional<Id> Find(std::string_view value) const;
+  std::string_view Get(Id id) const { return values_[id]; }
+  std::size_t Size() const { return size_.load(std::memory_order_acquire); }
+  std::size_t ByteSize() const { return bytes_; }
+
+ private:
+  static constexpr Id kNoId{std::numeric_limits<Id>::max()};
+
+  struct StoredBuckets {
+    const std::uint32_t* offsets;
+    const Id* ids;
+  };
+
+  // Stable across runs, since buckets are stored with mapped values.
+  static std::uint64_t Hash(std::string_view value);
+  static std::size_t BucketOf(std::uint64_t hash) { return hash >> 52; }
+  std::string_view Store(std::string_view value);
+  void IndexPending() const;
+  void IndexBucket(std::size_t bucket) const;
+  void Index(Id id, std::uint64_t hash) const;
+  void Place(Id id, std::uint64_t hash) const;
+
+  static constexpr std::size_t kArenaBlockSize{1 << 20};
+  std::vector<std::unique_ptr<char[]>> arena_{};
+  std::size_t arena_used_{0};
+  std::size_t arena_capacity_{0};
+  std::size_t bytes_{0};
+  ChunkedColumn<std::string_view> values_{};
+  // Writer-only. Indexed ids by the hash of their value, kNoId where
+  // empty; at most half full. Ids from indexed_ on are not indexed yet,
+  // nor are stored_ groups from bucket_stored_[bucket] on in that bucket.
+  mutable std::vector<Id> slots_{};
+  mutable std::size_t entries_{0};
+  mutable std::size_t indexed_{0};
+  std::vector<StoredBuckets> stored_{};
+  mutable std::vector<std::uint32_t> bucket_stored_{};
+  std::atomic<std::size_t> size_{0};
+};
+
+}  // namespace audit
+
+#endif  // AUDIT_STRING_DICTIONARY_H_
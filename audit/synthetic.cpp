@@ -0,0 +1,39 @@
+#include "audit/synthetic.h"
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+namespace audit {
+
+void FillSynthetic(std::size_t rows, EventStore* store) {
+  constexpr std::array<std::string_view, 8> kCommands{
+      "/usr/bin/bash", "/usr/bin/ls",   "/usr/bin/curl", "/usr/bin/cat",
+      "/usr/bin/grep", "/usr/bin/sshd", "/usr/bin/sudo", "/usr/bin/python3"};
+  constexpr std::array<std::string_view, 4> kCwds{"/", "/root", "/tmp",
+                                                   "/home/user"};
+  constexpr std::int64_t kStartTime{1700000000000};
+  std::uint64_t state{0x9e3779b97f4a7c15};
+  std::string host{};
+  std::string args{};
+  for (std::size_t i{0}; i < rows; ++i) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    host = "host-" + std::to_string(state % 16);
+    args = std::string{kCommands[(state >> 8) % kCommands.size()]} + " -n " +
+           std::to_string((state >> 16) % 1000);
+    ExecveEvent event{};
+    event.time = kStartTime + static_cast<std::int64_t>(i) * 10;
+    event.host = host;
+    event.uid = static_cast<std::uint32_t>((state >> 24) % 4) * 1000;
+    event.pid = static_cast<std::int32_t>(1000 + i % 4000000);
+    event.ppid = static_cast<std::int32_t>(1 + (state >> 32) % 1000);
+    event.cwd = kCwds[(state >> 40) % kCwds.size()];
+    event.command = kCommands[(state >> 8) % kCommands.size()];
+    event.args = args;
+    store->Append(event);
+  }
+}
+
+}  // namespace audit
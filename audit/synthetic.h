@@ -0,0 +1,16 @@
+#ifndef AUDIT_SYNTHETIC_H_
+#define AUDIT_SYNTHETIC_H_
+
+#include <cstddef>
+
+#include "audit/event_store.h"
+
+namespace audit {
+
+// Fills the store with deterministic process creation events, used to
+// measure the UI and the query paths without real audit logs.
+void FillSynthetic(std::size_t rows, EventStore* store);
+
+}  // namespace audit
+
+#endif  // AUDIT_SYNTHETIC_H_
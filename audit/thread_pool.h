@@ -0,0 +1,41 @@
+#ifndef AUDIT_THREAD_POOL_H_
+#define AUDIT_THREAD_POOL_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace audit {
+
+// Fixed set of worker threads draining a FIFO task queue.
+class ThreadPool {
+ public:
+  explicit ThreadPool(
+      std::size_t threads = std::thread::hardware_concurrency());
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+  ThreadPool(ThreadPool&&) = delete;
+  ThreadPool& operator=(ThreadPool&&) = delete;
+  ~ThreadPool();
+
+  std::future<void> Submit(std::function<void()> task);
+  std::size_t Size() const { return workers_.size(); }
+
+ private:
+  void Work();
+
+  std::vector<std::thread> workers_{};
+  std::deque<std::packaged_task<void()>> tasks_{};
+  std::mutex mutex_{};
+  std::condition_variable cv_{};
+  bool stop_{false};
+};
+
+}  // namespace audit
+
+#endif  // AUDIT_THREAD_POOL_H_
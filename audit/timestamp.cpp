@@ -0,0 +1,55 @@
+#include "audit/timestamp.h"
+
+#include <cstring>
+#include <ctime>
+#include <string>
+
+namespace audit {
+
+std::optional<std::int64_t> ParseLocalTime(std::string_view text) {
+  std::string input{text};
+  std::tm tm{};
+  tm.tm_isdst = -1;
+  const char* end{strptime(input.c_str(), "%Y-%m-%d %H:%M", &tm)};
+  if (!end) return std::nullopt;
+  if (*end == ':') strptime(end + 1, "%S", &tm);
+  return static_cast<std::int64_t>(std::mktime(&tm)) * 1000;
+}
+
+void TimestampFormatter::Format(std::int64_t time, char (&text)[32]) {
+  // Floored, so times before the epoch fall in the right second.
+  auto seconds{time / 1000 - (time % 1000 < 0)};
+  if (seconds < from_ || seconds >= to_) {
+    auto now{static_cast<std::time_t>(seconds)};
+    std::tm tm{};
+    localtime_r(&now, &tm);
+    std::strftime(date_, sizeof(date_), "%Y-%m-%d", &tm);
+    midnight_ = seconds - (tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec);
+    from_ = midnight_;
+    to_ = midnight_ + 86400;
+    for (auto edge : {from_, to_ - 1}) {
+      auto at{static_cast<std::time_t>(edge)};
+      std::tm edge_tm{};
+      localtime_r(&at, &edge_tm);
+      if (edge_tm.tm_gmtoff != tm.tm_gmtoff) {
+        from_ = seconds;
+        to_ = seconds + 1;
+      }
+    }
+  }
+  auto second{seconds - midnight_};
+  std::memcpy(text, date_, 10);
+  const auto two{[&text](std::size_t at, std::int64_t value) {
+    text[at] = static_cast<char>('0' + value / 10);
+    text[at + 1] = static_cast<char>('0' + value % 10);
+  }};
+  text[10] = ' ';
+  two(11, second / 3600);
+  text[13] = ':';
+  two(14, second / 60 % 60);
+  text[16] = ':';
+  two(17, second % 60);
+  text[19] = '\0';
+}
+
+}  // namespace audit
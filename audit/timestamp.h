@@ -0,0 +1,32 @@
+#ifndef AUDIT_TIMESTAMP_H_
+#define AUDIT_TIMESTAMP_H_
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace audit {
+
+// Parses local time "YYYY-MM-DD HH:MM[:SS]" into milliseconds since epoch.
+std::optional<std::int64_t> ParseLocalTime(std::string_view text);
+
+// Formats milliseconds since epoch as local "YYYY-MM-DD HH:MM:SS". The date
+// and UTC offset of the last day formatted are kept, so the times of that
+// day are formatted without localtime_r() or strftime(). Days when the
+// offset changes are formatted the slow way.
+class TimestampFormatter {
+ public:
+  void Format(std::int64_t time, char (&text)[32]);
+
+ private:
+  // Seconds since epoch [from_, to_) are on date_, which began at
+  // midnight_.
+  std::int64_t from_{0};
+  std::int64_t to_{0};
+  std::int64_t midnight_{0};
+  char date_[11]{};
+};
+
+}  // namespace audit
+
+#endif  // AUDIT_TIMESTAMP_H_
@@ -0,0 +1,144 @@
+#include "audit/trigram_index.h"
+
+#include <algorithm>
+#include <iterator>
+#include <mutex>
+#include <utility>
+
+namespace audit {
+
+namespace {
+
+std::uint32_t Trigram(const char* bytes) {
+  const auto* data{reinterpret_cast<const unsigned char*>(bytes)};
+  return std::uint32_t{data[0]} << 16 | std::uint32_t{data[1]} << 8 |
+         data[2];
+}
+
+void AppendVarint(std::uint32_t value, std::string* bytes) {
+  while (value >= 0x80) {
+    bytes->push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  bytes->push_back(static_cast<char>(value));
+}
+
+}  // namespace
+
+void TrigramIndex::Update(const StringDictionary& dictionary) {
+  auto size{dictionary.Size()};
+  // The lock is taken per batch so lookups are not held up for long.
+  for (auto first{indexed_}; first < size; first += kUpdateBatch) {
+    auto last{std::min(size, first + kUpdateBatch)};
+    std::unique_lock lock{mutex_};
+    for (auto id{first}; id < last; ++id) {
+      auto value{dictionary.Get(static_cast<Id>(id))};
+      for (std::size_t i{0}; i + 3 <= value.size(); ++i) {
+        Add(Trigram(value.data() + i), static_cast<Id>(id));
+      }
+    }
+    indexed_ = last;
+  }
+}
+
+// Ids only grow, so a trigram repeated within one string is caught by the
+// last posted id. Id 0 is the empty string and posts nothing.
+void TrigramIndex::Add(std::uint32_t trigram, Id id) {
+  auto slot{Slot(trigram)};
+  if (table_.empty() || table_[slot] == 0) {
+    if (postings_.size() + 1 > table_.size() / 2) {
+      Grow();
+      slot = Slot(trigram);
+    }
+    postings_.push_back({trigram, 0, 0, {}});
+    table_[slot] = static_cast<std::uint32_t>(postings_.size());
+  }
+  auto& postings{postings_[table_[slot] - 1]};
+  if (postings.last == id) return;
+  AppendVarint(id - postings.last, &postings.bytes);
+  postings.last = id;
+  ++postings.count;
+}
+
+const TrigramIndex::Postings* TrigramIndex::Find(
+    std::uint32_t trigram) const {
+  if (table_.empty()) return nullptr;
+  auto slot{table_[Slot(trigram)]};
+  return slot == 0 ? nullptr : &postings_[slot - 1];
+}
+
+// The slot holding `trigram`, or the empty slot where it would go.
+std::size_t TrigramIndex::Slot(std::uint32_t trigram) const {
+  if (table_.empty()) return 0;
+  auto mask{table_.size() - 1};
+  auto slot{(trigram * std::size_t{0x9e3779b97f4a7c15} >> 32) & mask};
+  while (table_[slot] != 0 && postings_[table_[slot] - 1].trigram != trigram) {
+    slot = (slot + 1) & mask;
+  }
+  return slot;
+}
+
+void TrigramIndex::Grow() {
+  table_.assign(table_.empty() ? 1024 : table_.size() * 2, 0);
+  for (std::size_t i{0}; i < postings_.size(); ++i) {
+    table_[Slot(postings_[i].trigram)] = static_cast<std::uint32_t>(i + 1);
+  }
+}
+
+std::optional<std::size_t> TrigramIndex::Candidates(
+    std::string_view pattern, std::vector<Id>* ids) const {
+  ids->clear();
+  if (pattern.size() < 3) return std::nullopt;
+  std::shared_lock lock{mutex_};
+  std::vector<const Postings*> lists{};
+  for (std::size_t i{0}; i + 3 <= pattern.size(); ++i) {
+    const auto* postings{Find(Trigram(pattern.data() + i))};
+    if (!postings) return indexed_;
+    lists.push_back(postings);
+  }
+  // Intersects from the shortest list so the candidates only shrink.
+  std::sort(lists.begin(), lists.end(), [](const auto* a, const auto* b) {
+    return a->count < b->count || (a->count == b->count && a < b);
+  });
+  lists.erase(std::unique(lists.begin(), lists.end()), lists.end());
+  Decode(*lists[0], ids);
+  std::vector<Id> other{};
+  std::vector<Id> both{};
+  for (std::size_t i{1}; i < lists.size() && !ids->empty(); ++i) {
+    Decode(*lists[i], &other);
+    both.clear();
+    std::set_intersection(ids->begin(), ids->end(), other.begin(),
+                          other.end(), std::back_inserter(both));
+    ids->swap(both);
+  }
+  return indexed_;
+}
+
+std::size_t TrigramIndex::ByteSize() const {
+  std::shared_lock lock{mutex_};
+  std::size_t bytes{0};
+  for (const auto& postings : postings_) bytes += postings.bytes.size();
+  return bytes;
+}
+
+void TrigramIndex::Decode(const Postings& postings, std::vector<Id>* ids) {
+  ids->clear();
+  ids->reserve(postings.count);
+  Id id{0};
+  std::uint32_t delta{0};
+  int shift{0};
+  for (auto byte : postings.bytes) {
+    auto bits{static_cast<std::uint32_t>(static_cast<unsigned char>(byte))};
+    delta |= (bits & 0x7f) << shift;
+    if (bits & 0x80) {
+      shift += 7;
+      continue;
+    }
+    id += delta;
+    ids->push_back(id);
+    delta = 0;
+    shift = 0;
+  }
+}
+
+}  // namespace audit
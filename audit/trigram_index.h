@@ -0,0 +1,66 @@
+#ifndef AUDIT_TRIGRAM_INDEX_H_
+#define AUDIT_TRIGRAM_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "audit/string_dictionary.h"
+
+namespace audit {
+
+// Substring index over the ids of a StringDictionary. Every distinct byte
+// trigram of a string posts the string id; postings are ascending ids
+// stored as varint deltas. Updates are incremental and may run alongside
+// lookups.
+class TrigramIndex {
+ public:
+  using Id = StringDictionary::Id;
+
+  TrigramIndex() = default;
+  TrigramIndex(const TrigramIndex&) = delete;
+  TrigramIndex& operator=(const TrigramIndex&) = delete;
+  TrigramIndex(TrigramIndex&&) = delete;
+  TrigramIndex& operator=(TrigramIndex&&) = delete;
+  ~TrigramIndex() = default;
+
+  // Indexes the ids added to `dictionary` since the last call. Writer
+  // thread only.
+  void Update(const StringDictionary& dictionary);
+  // Fills `ids` with the ascending indexed ids whose strings contain every
+  // trigram of `pattern`, a superset of the ids containing `pattern`, and
+  // returns how many ids were indexed at that moment. Returns nullopt if
+  // `pattern` is shorter than a trigram.
+  std::optional<std::size_t> Candidates(std::string_view pattern,
+                                        std::vector<Id>* ids) const;
+  std::size_t ByteSize() const;
+
+ private:
+  struct Postings {
+    std::uint32_t trigram{0};
+    Id last{0};
+    std::size_t count{0};
+    std::string bytes{};
+  };
+
+  void Add(std::uint32_t trigram, Id id);
+  const Postings* Find(std::uint32_t trigram) const;
+  std::size_t Slot(std::uint32_t trigram) const;
+  void Grow();
+  static void Decode(const Postings& postings, std::vector<Id>* ids);
+
+  static constexpr std::size_t kUpdateBatch{4096};
+  mutable std::shared_mutex mutex_{};
+  // Open addressing from trigram to 1 + index into postings_, 0 if empty.
+  std::vector<std::uint32_t> table_{};
+  std::vector<Postings> postings_{};
+  std::size_t indexed_{0};
+};
+
+}  // namespace audit
+
+#endif  // AUDIT_TRIGRAM_INDEX_H_
@@ -0,0 +1,57 @@
+#ifndef AUDIT_ZONE_MAP_H_
+#define AUDIT_ZONE_MAP_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+
+#include "audit/chunked_column.h"
+
+namespace audit {
+
+template <typename T>
+struct Zone {
+  T min{};
+  T max{};
+
+  static Zone Of(const T* values, std::size_t count) {
+    Zone zone{values[0], values[0]};
+    for (std::size_t i{1}; i < count; ++i) {
+      zone.min = std::min(zone.min, values[i]);
+      zone.max = std::max(zone.max, values[i]);
+    }
+    return zone;
+  }
+};
+
+// Min and max of every full block of a ChunkedColumn, so scans can skip
+// blocks that cannot match and take blocks that match entirely without
+// reading them. The block still being filled has no zone. Single writer,
+// many readers, like the column itself.
+template <typename T>
+class ZoneMap {
+ public:
+  ZoneMap() = default;
+  ZoneMap(const ZoneMap&) = delete;
+  ZoneMap& operator=(const ZoneMap&) = delete;
+  ZoneMap(ZoneMap&&) = delete;
+  ZoneMap& operator=(ZoneMap&&) = delete;
+  ~ZoneMap() = default;
+
+  void PushBack(const Zone<T>& zone) {
+    zones_.PushBack(zone);
+    size_.store(zones_.Size(), std::memory_order_release);
+  }
+
+  // Number of blocks with a zone.
+  std::size_t Size() const { return size_.load(std::memory_order_acquire); }
+  const Zone<T>& operator[](std::size_t block) const { return zones_[block]; }
+
+ private:
+  ChunkedColumn<Zone<T>> zones_{};
+  std::atomic<std::size_t> size_{0};
+};
+
+}  // namespace audit
+
+#endif  // AUDIT_ZONE_MAP_H_
@@ -0,0 +1,69 @@
+#include "frame_stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+
+namespace imgui_glfw_vulkan {
+
+void FrameStats::Push(const Frame& frame) {
+  auto count{count_.load(std::memory_order_relaxed)};
+  auto& slot{slots_[count % kCapacity]};
+  auto sequence{slot.sequence.load(std::memory_order_relaxed)};
+  slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  for (std::size_t i{0}; i < kPhaseCount; ++i) {
+    slot.ms[i].store(frame[i], std::memory_order_relaxed);
+  }
+  slot.sequence.store(sequence + 2, std::memory_order_release);
+  count_.store(count + 1, std::memory_order_release);
+}
+
+std::vector<FrameStats::Frame> FrameStats::Snapshot() const {
+  auto count{count_.load(std::memory_order_acquire)};
+  auto first{count > kCapacity ? count - kCapacity : 0};
+  std::vector<Frame> frames{};
+  frames.reserve(count - first);
+  for (auto index{first}; index < count; ++index) {
+    const auto& slot{slots_[index % kCapacity]};
+    auto before{slot.sequence.load(std::memory_order_acquire)};
+    Frame frame{};
+    for (std::size_t i{0}; i < kPhaseCount; ++i) {
+      frame[i] = slot.ms[i].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    auto after{slot.sequence.load(std::memory_order_relaxed)};
+    if (before % 2 == 0 && before == after) frames.push_back(frame);
+  }
+  return frames;
+}
+
+float FrameStats::Quantile(const std::vector<Frame>& frames, Phase phase,
+                           double q) {
+  if (frames.empty()) return 0.f;
+  std::vector<float> values{};
+  values.reserve(frames.size());
+  for (const auto& frame : frames) values.push_back(frame[phase]);
+  auto rank{static_cast<std::size_t>(
+      std::lround(q * static_cast<double>(values.size() - 1)))};
+  auto nth{values.begin() + static_cast<std::ptrdiff_t>(rank)};
+  std::nth_element(values.begin(), nth, values.end());
+  return *nth;
+}
+
+void FrameStats::WriteCsv(const std::string& path) const {
+  std::ofstream file{path};
+  file << "frame";
+  for (const auto* name : kPhaseNames) file << ',' << name << "_ms";
+  file << '\n';
+  auto frames{Snapshot()};
+  for (std::size_t i{0}; i < frames.size(); ++i) {
+    file << i;
+    for (auto ms : frames[i]) file << ',' << ms;
+    file << '\n';
+  }
+  if (!file.flush()) throw std::runtime_error("failed to write " + path + "!");
+}
+
+}  // namespace imgui_glfw_vulkan
@@ -0,0 +1,65 @@
+#ifndef IMGUI_GLFW_VULKAN_FRAME_STATS_H_
+#define IMGUI_GLFW_VULKAN_FRAME_STATS_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace imgui_glfw_vulkan {
+
+// Durations of the phases of the last kCapacity frames. The render thread
+// pushes; any thread may take a snapshot without blocking it. Each slot is
+// a seqlock, so a reader skips a slot that is being overwritten.
+class FrameStats {
+ public:
+  enum Phase {
+    kEvents,       // waiting for and handling window events
+    kRender,       // the application's Render()
+    kImGuiRender,  // ImGui::Render(), building draw lists
+    kFenceWait,    // waiting for the frame's previous submission
+    kRecord,       // acquiring, recording and submitting
+    kPresent,      // vkQueuePresentKHR()
+    kGpu,          // the render pass on the GPU, from timestamps
+    kPhaseCount
+  };
+  static constexpr std::array<const char*, kPhaseCount> kPhaseNames{
+      "events", "render", "imgui_render", "fence_wait",
+      "record", "present", "gpu"};
+  static constexpr std::size_t kCapacity{1024};
+
+  using Frame = std::array<float, kPhaseCount>;  // milliseconds
+
+  FrameStats() = default;
+  FrameStats(const FrameStats&) = delete;
+  FrameStats& operator=(const FrameStats&) = delete;
+  FrameStats(FrameStats&&) = delete;
+  FrameStats& operator=(FrameStats&&) = delete;
+  ~FrameStats() = default;
+
+  // Render thread only.
+  void Push(const Frame& frame);
+  // The stored frames, oldest first.
+  std::vector<Frame> Snapshot() const;
+  // The q-quantile of `phase` over `frames`, q in [0, 1].
+  static float Quantile(const std::vector<Frame>& frames, Phase phase,
+                        double q);
+  // Writes a snapshot as CSV with one row per frame.
+  void WriteCsv(const std::string& path) const;
+
+ private:
+  struct Slot {
+    // Odd while the slot is written.
+    std::atomic<std::uint64_t> sequence{0};
+    std::array<std::atomic<float>, kPhaseCount> ms{};
+  };
+
+  std::array<Slot, kCapacity> slots_{};
+  std::atomic<std::uint64_t> count_{0};
+};
+
+}  // namespace imgui_glfw_vulkan
+
+#endif  // IMGUI_GLFW_VULKAN_FRAME_STATS_H_
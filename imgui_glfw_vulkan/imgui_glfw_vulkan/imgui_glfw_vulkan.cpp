@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <array>
+#include <chrono>
 #include <cstring>
 #include <iostream>
 #include <limits>
@@ -11,13 +12,6 @@
 
 namespace imgui_glfw_vulkan {
 
-void FramebufferSizeCallback(GLFWwindow* window, [[maybe_unused]] int width,
-                             [[maybe_unused]] int height) {
-  auto swap_chain_rebuild{
-      reinterpret_cast<int*>(glfwGetWindowUserPointer(window))};
-  *swap_chain_rebuild = true;
-}
-
 VkResult CreateDebugUtilsMessengerExt(
     VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* create_info,
     const VkAllocationCallbacks* allocator,
@@ -42,10 +36,14 @@ void DestroyDebugUtilsMessengerExt(VkInstance instance,
 }
 
 ImGuiGlfwVulkan::ImGuiGlfwVulkan(std::string_view name, int width, int height,
-                                 ImGuiConfigFlags flags)
-    : window_width_{width}, window_height_{height}, window_data_{} {
-  InitWindow(name.data());
+                                 ImGuiConfigFlags flags, Target target)
+    : target_{target},
+      window_width_{width},
+      window_height_{height},
+      window_data_{} {
+  if (target_ == Target::kWindow) InitWindow(name.data());
   InitVulkan(name.data());
+  if (target_ == Target::kOffscreen) CreateOffscreenTarget();
   InitImGui(flags);
 }
 
@@ -59,33 +57,69 @@ void ImGuiGlfwVulkan::InitWindow(const char* name) {
   if (!window_) {
     throw std::runtime_error("failed to create window!");
   }
-  glfwSetWindowUserPointer(window_,
-                           reinterpret_cast<void*>(&swap_chain_rebuild_));
-  glfwSetFramebufferSizeCallback(window_, FramebufferSizeCallback);
+  glfwSetWindowUserPointer(window_, this);
+  glfwSetFramebufferSizeCallback(window_, [](GLFWwindow* window, int, int) {
+    auto* self{Self(window)};
+    self->swap_chain_rebuild_ = true;
+    self->input_ = true;
+  });
+  // Set before ImGui installs its callbacks, which chain to these, so the
+  // on-demand loop knows when there was input.
+  glfwSetWindowRefreshCallback(window_, OnInput);
+  glfwSetWindowFocusCallback(window_, [](GLFWwindow* w, int) { OnInput(w); });
+  glfwSetCursorEnterCallback(window_, [](GLFWwindow* w, int) { OnInput(w); });
+  glfwSetCursorPosCallback(window_,
+                           [](GLFWwindow* w, double, double) { OnInput(w); });
+  glfwSetMouseButtonCallback(
+      window_, [](GLFWwindow* w, int, int, int) { OnInput(w); });
+  glfwSetScrollCallback(window_,
+                        [](GLFWwindow* w, double, double) { OnInput(w); });
+  glfwSetKeyCallback(window_,
+                     [](GLFWwindow* w, int, int, int, int) { OnInput(w); });
+  glfwSetCharCallback(window_, [](GLFWwindow* w, unsigned) { OnInput(w); });
+}
+
+ImGuiGlfwVulkan* ImGuiGlfwVulkan::Self(GLFWwindow* window) {
+  return static_cast<ImGuiGlfwVulkan*>(glfwGetWindowUserPointer(window));
+}
+
+void ImGuiGlfwVulkan::OnInput(GLFWwindow* window) {
+  Self(window)->input_ = true;
 }
 
 ImGuiGlfwVulkan::~ImGuiGlfwVulkan() {
   vkDeviceWaitIdle(device_);
   ImGui_ImplVulkan_Shutdown();
-  ImGui_ImplGlfw_Shutdown();
+  if (target_ == Target::kWindow) ImGui_ImplGlfw_Shutdown();
   ImGui::DestroyContext();
-  ImGui_ImplVulkanH_DestroyWindow(instance_, device_, &window_data_, nullptr);
+  if (target_ == Target::kWindow) {
+    ImGui_ImplVulkanH_DestroyWindow(instance_, device_, &window_data_,
+                                    nullptr);
+  } else {
+    DestroyOffscreenTarget();
+  }
   vkDestroyDescriptorPool(device_, descriptor_pool_, nullptr);
+  if (query_pool_ != VK_NULL_HANDLE) {
+    vkDestroyQueryPool(device_, query_pool_, nullptr);
+  }
   vkDestroyDevice(device_, nullptr);
   if (kEnableValidationLayers) {
     DestroyDebugUtilsMessengerExt(instance_, debug_messenger_, nullptr);
   }
   vkDestroyInstance(instance_, nullptr);
-  glfwDestroyWindow(window_);
-  glfwTerminate();
+  if (target_ == Target::kWindow) {
+    glfwDestroyWindow(window_);
+    glfwTerminate();
+  }
 }
 
 void ImGuiGlfwVulkan::InitVulkan(const char* name) {
   CreateInstance(name);
   SetupDebugMessenger();
-  CreateSurface();
+  if (target_ == Target::kWindow) CreateSurface();
   PickPhysicalDevice();
   CreateLogicalDevice();
+  CreateQueryPool();
 }
 
 static VKAPI_ATTR VkBool32 VKAPI_CALL DebugCallback(
@@ -165,11 +199,13 @@ bool ImGuiGlfwVulkan::CheckValidationLayerSupport() {
 }
 
 std::vector<const char*> ImGuiGlfwVulkan::GetRequiredExtensions() {
-  uint32_t glfw_extension_count;
-  const char** glfw_extensions{nullptr};
-  glfw_extensions = glfwGetRequiredInstanceExtensions(&glfw_extension_count);
-  std::vector<const char*> extensions(glfw_extensions,
-                                      glfw_extensions + glfw_extension_count);
+  std::vector<const char*> extensions{};
+  if (target_ == Target::kWindow) {
+    uint32_t glfw_extension_count;
+    const char** glfw_extensions{nullptr};
+    glfw_extensions = glfwGetRequiredInstanceExtensions(&glfw_extension_count);
+    extensions.assign(glfw_extensions, glfw_extensions + glfw_extension_count);
+  }
   if (kEnableValidationLayers) {
     extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
   }
@@ -221,10 +257,12 @@ VkPhysicalDevice ImGuiGlfwVulkan::SelectPhysicalDevice(
 int ImGuiGlfwVulkan::RateDeviceSuitability(const VkPhysicalDevice& device) {
   auto indices{FindQueueFamilies(device)};
   if (!indices.IsComplete()) return 0;
-  auto extensions_supported{CheckDeviceExtensionSupport(device)};
-  if (!extensions_supported) return 0;
-  auto swap_chain_support{QuerySwapChainSupport(device)};
-  if (!swap_chain_support.IsComplete()) return 0;
+  if (target_ == Target::kWindow) {
+    auto extensions_supported{CheckDeviceExtensionSupport(device)};
+    if (!extensions_supported) return 0;
+    auto swap_chain_support{QuerySwapChainSupport(device)};
+    if (!swap_chain_support.IsComplete()) return 0;
+  }
   VkPhysicalDeviceProperties device_properties;
   VkPhysicalDeviceFeatures device_feauteres;
   vkGetPhysicalDeviceProperties(device, &device_properties);
@@ -234,7 +272,9 @@ int ImGuiGlfwVulkan::RateDeviceSuitability(const VkPhysicalDevice& device) {
     score += 1000;
   }
   score += static_cast<int>(device_properties.limits.maxImageDimension2D);
-  if (!device_feauteres.geometryShader) {
+  // Headless runs often land on software rasterizers without geometry
+  // shaders, which offscreen rendering does not need.
+  if (target_ == Target::kWindow && !device_feauteres.geometryShader) {
     return 0;
   }
   return score;
@@ -254,8 +294,13 @@ ImGuiGlfwVulkan::QueueFamilyIndices ImGuiGlfwVulkan::FindQueueFamilies(
     if (queue_family.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
       indices.graphics_family = i;
     }
-    VkBool32 present_support{false};
-    vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &present_support);
+    // Offscreen frames are never presented; the graphics queue stands in.
+    VkBool32 present_support{target_ == Target::kOffscreen &&
+                             indices.graphics_family == i};
+    if (target_ == Target::kWindow) {
+      vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_,
+                                           &present_support);
+    }
     if (present_support) {
       indices.present_family = i;
     }
@@ -325,9 +370,11 @@ void ImGuiGlfwVulkan::CreateLogicalDevice() {
   VkDeviceCreateInfo create_info{};
   create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
   create_info.pEnabledFeatures = &device_features;
-  create_info.enabledExtensionCount =
-      static_cast<std::uint32_t>(kDeviceExtensions.size());
-  create_info.ppEnabledExtensionNames = kDeviceExtensions.data();
+  if (target_ == Target::kWindow) {
+    create_info.enabledExtensionCount =
+        static_cast<std::uint32_t>(kDeviceExtensions.size());
+    create_info.ppEnabledExtensionNames = kDeviceExtensions.data();
+  }
   create_info.queueCreateInfoCount =
       static_cast<std::uint32_t>(queue_create_infos.size());
   create_info.pQueueCreateInfos = queue_create_infos.data();
@@ -349,6 +396,7 @@ void ImGuiGlfwVulkan::CreateLogicalDevice() {
   if (CreateDescriptorPool() != VK_SUCCESS) {
     throw std::runtime_error("failed to create descriptor pool!");
   }
+  if (target_ == Target::kOffscreen) return;
   auto swap_chain_support{QuerySwapChainSupport(physical_device_)};
   min_image_count_ = swap_chain_support.capabilities.minImageCount + 1;
   if (swap_chain_support.capabilities.maxImageCount > 0 &&
@@ -372,7 +420,7 @@ VkResult ImGuiGlfwVulkan::CreateDescriptorPool() {
 }
 
 void ImGuiGlfwVulkan::InitImGui(ImGuiConfigFlags flags) {
-  SetupImGuiWindow();
+  if (target_ == Target::kWindow) SetupImGuiWindow();
   IMGUI_CHECKVERSION();
   ImGui::CreateContext();
   io_ = &ImGui::GetIO();
@@ -383,7 +431,7 @@ void ImGuiGlfwVulkan::InitImGui(ImGuiConfigFlags flags) {
     style.Colors[ImGuiCol_WindowBg].w = 1.0f;
   }
 
-  ImGui_ImplGlfw_InitForVulkan(window_, true);
+  if (target_ == Target::kWindow) ImGui_ImplGlfw_InitForVulkan(window_, true);
   ImGui_ImplVulkan_InitInfo init_info{};
   init_info.Instance = instance_;
   init_info.PhysicalDevice = physical_device_;
@@ -392,10 +440,13 @@ void ImGuiGlfwVulkan::InitImGui(ImGuiConfigFlags flags) {
   init_info.Queue = graphics_queue_;
   init_info.PipelineCache = VK_NULL_HANDLE;
   init_info.DescriptorPool = descriptor_pool_;
-  init_info.RenderPass = window_data_.RenderPass;
+  init_info.RenderPass = target_ == Target::kWindow
+                             ? window_data_.RenderPass
+                             : offscreen_.render_pass;
   init_info.Subpass = 0;
   init_info.MinImageCount = min_image_count_;
-  init_info.ImageCount = window_data_.ImageCount;
+  init_info.ImageCount = target_ == Target::kWindow ? window_data_.ImageCount
+                                                    : min_image_count_;
   init_info.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
   init_info.Allocator = nullptr;
   ImGui_ImplVulkan_Init(&init_info);
@@ -427,9 +478,163 @@ void ImGuiGlfwVulkan::SetupImGuiWindow() {
       window_height_, min_image_count_);
 }
 
+void ImGuiGlfwVulkan::CreateOffscreenTarget() {
+  auto width{static_cast<std::uint32_t>(window_width_)};
+  auto height{static_cast<std::uint32_t>(window_height_)};
+  VkImageCreateInfo image_info{};
+  image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  image_info.imageType = VK_IMAGE_TYPE_2D;
+  image_info.format = kOffscreenFormat;
+  image_info.extent = {width, height, 1};
+  image_info.mipLevels = 1;
+  image_info.arrayLayers = 1;
+  image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+  image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+  image_info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+  image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  if (vkCreateImage(device_, &image_info, nullptr, &offscreen_.image) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to create offscreen image!");
+  }
+  VkMemoryRequirements requirements{};
+  vkGetImageMemoryRequirements(device_, offscreen_.image, &requirements);
+  VkMemoryAllocateInfo alloc_info{};
+  alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  alloc_info.allocationSize = requirements.size;
+  alloc_info.memoryTypeIndex = FindMemoryType(
+      requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  if (vkAllocateMemory(device_, &alloc_info, nullptr, &offscreen_.memory) !=
+          VK_SUCCESS ||
+      vkBindImageMemory(device_, offscreen_.image, offscreen_.memory, 0) !=
+          VK_SUCCESS) {
+    throw std::runtime_error("failed to allocate offscreen image memory!");
+  }
+  VkImageViewCreateInfo view_info{};
+  view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  view_info.image = offscreen_.image;
+  view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+  view_info.format = kOffscreenFormat;
+  view_info.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+  if (vkCreateImageView(device_, &view_info, nullptr, &offscreen_.view) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to create offscreen image view!");
+  }
+  VkAttachmentDescription attachment{};
+  attachment.format = kOffscreenFormat;
+  attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  attachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  VkAttachmentReference color_attachment{
+      0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+  VkSubpassDescription subpass{};
+  subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpass.colorAttachmentCount = 1;
+  subpass.pColorAttachments = &color_attachment;
+  VkRenderPassCreateInfo pass_info{};
+  pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+  pass_info.attachmentCount = 1;
+  pass_info.pAttachments = &attachment;
+  pass_info.subpassCount = 1;
+  pass_info.pSubpasses = &subpass;
+  if (vkCreateRenderPass(device_, &pass_info, nullptr,
+                         &offscreen_.render_pass) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create offscreen render pass!");
+  }
+  VkFramebufferCreateInfo framebuffer_info{};
+  framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+  framebuffer_info.renderPass = offscreen_.render_pass;
+  framebuffer_info.attachmentCount = 1;
+  framebuffer_info.pAttachments = &offscreen_.view;
+  framebuffer_info.width = width;
+  framebuffer_info.height = height;
+  framebuffer_info.layers = 1;
+  if (vkCreateFramebuffer(device_, &framebuffer_info, nullptr,
+                          &offscreen_.framebuffer) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create offscreen framebuffer!");
+  }
+  VkCommandPoolCreateInfo pool_info{};
+  pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+  pool_info.queueFamilyIndex = queue_family_.graphics_family.value();
+  if (vkCreateCommandPool(device_, &pool_info, nullptr,
+                          &offscreen_.command_pool) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create offscreen command pool!");
+  }
+  VkCommandBufferAllocateInfo buffer_info{};
+  buffer_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  buffer_info.commandPool = offscreen_.command_pool;
+  buffer_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  buffer_info.commandBufferCount = 1;
+  if (vkAllocateCommandBuffers(device_, &buffer_info,
+                               &offscreen_.command_buffer) != VK_SUCCESS) {
+    throw std::runtime_error("failed to allocate offscreen command buffer!");
+  }
+  VkFenceCreateInfo fence_info{};
+  fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+  if (vkCreateFence(device_, &fence_info, nullptr, &offscreen_.fence) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to create offscreen fence!");
+  }
+}
+
+void ImGuiGlfwVulkan::DestroyOffscreenTarget() {
+  vkDestroyFence(device_, offscreen_.fence, nullptr);
+  vkDestroyCommandPool(device_, offscreen_.command_pool, nullptr);
+  vkDestroyFramebuffer(device_, offscreen_.framebuffer, nullptr);
+  vkDestroyRenderPass(device_, offscreen_.render_pass, nullptr);
+  vkDestroyImageView(device_, offscreen_.view, nullptr);
+  vkDestroyImage(device_, offscreen_.image, nullptr);
+  vkFreeMemory(device_, offscreen_.memory, nullptr);
+}
+
+std::uint32_t ImGuiGlfwVulkan::FindMemoryType(
+    std::uint32_t type_bits, VkMemoryPropertyFlags properties) {
+  VkPhysicalDeviceMemoryProperties memory{};
+  vkGetPhysicalDeviceMemoryProperties(physical_device_, &memory);
+  for (std::uint32_t i{0}; i < memory.memoryTypeCount; ++i) {
+    if ((type_bits & (1u << i)) &&
+        (memory.memoryTypes[i].propertyFlags & properties) == properties) {
+      return i;
+    }
+  }
+  throw std::runtime_error("failed to find suitable memory type!");
+}
+
+// Leaves the GPU phase at zero if the graphics queue has no timestamps.
+void ImGuiGlfwVulkan::CreateQueryPool() {
+  VkPhysicalDeviceProperties properties{};
+  vkGetPhysicalDeviceProperties(physical_device_, &properties);
+  std::uint32_t count{0};
+  vkGetPhysicalDeviceQueueFamilyProperties(physical_device_, &count, nullptr);
+  std::vector<VkQueueFamilyProperties> families(count);
+  vkGetPhysicalDeviceQueueFamilyProperties(physical_device_, &count,
+                                           families.data());
+  auto bits{families[queue_family_.graphics_family.value()].timestampValidBits};
+  if (bits == 0 || properties.limits.timestampPeriod <= 0.f) return;
+  timestamp_period_ = properties.limits.timestampPeriod;
+  timestamp_mask_ = bits >= 64 ? ~std::uint64_t{0}
+                               : (std::uint64_t{1} << bits) - 1;
+  VkQueryPoolCreateInfo info{};
+  info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+  info.queryCount = 2 * kTimestampSlots;
+  if (vkCreateQueryPool(device_, &info, nullptr, &query_pool_) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to create query pool!");
+  }
+}
+
 void ImGuiGlfwVulkan::Run() {
   while (!glfwWindowShouldClose(window_)) {
-    glfwPollEvents();
+    frame_ = {};
+    phase_start_ = std::chrono::steady_clock::now();
+    WaitForFrame();
+    if (glfwWindowShouldClose(window_)) break;
     if (swap_chain_rebuild_) {
       glfwGetFramebufferSize(window_, &window_width_, &window_height_);
       if (window_width_ > 0 && window_height_ > 0) {
@@ -442,20 +647,139 @@ void ImGuiGlfwVulkan::Run() {
         swap_chain_rebuild_ = false;
       }
     }
+    Lap(FrameStats::kEvents);
     ImGui_ImplVulkan_NewFrame();
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
     Render();
+    if (ImGui::IsKeyPressed(ImGuiKey_F12, false)) show_stats_ = !show_stats_;
+    if (show_stats_) DrawFrameStats();
+    Lap(FrameStats::kRender);
     ImGui::Render();
     ImDrawData* draw_data = ImGui::GetDrawData();
     const bool is_minimized(draw_data->DisplaySize.x <= 0.0f ||
                             draw_data->DisplaySize.y <= 0.0f);
-    if (!is_minimized) FrameRender(draw_data);
+    Lap(FrameStats::kImGuiRender);
+    auto fence_wait{0.f};
+    if (!is_minimized) {
+      FrameRender(draw_data);
+      fence_wait = frame_[FrameStats::kFenceWait];
+    }
+    Lap(FrameStats::kRecord);
+    frame_[FrameStats::kRecord] -= fence_wait;
+    frame_[FrameStats::kFenceWait] = fence_wait;
     if (io_->ConfigFlags & ImGuiConfigFlags_ViewportsEnable) {
       ImGui::UpdatePlatformWindows();
       ImGui::RenderPlatformWindowsDefault();
     }
     if (!is_minimized) FramePresent();
+    Lap(FrameStats::kPresent);
+    stats_.Push(frame_);
+    if (io_->WantTextInput) RequestRedraw(kCaretBlink);
+  }
+}
+
+// Offscreen frames have no events to wait for and are not presented.
+void ImGuiGlfwVulkan::RunFrames(std::size_t frames) {
+  if (target_ != Target::kOffscreen) {
+    throw std::runtime_error("RunFrames needs an offscreen target!");
+  }
+  io_->DisplaySize = {static_cast<float>(window_width_),
+                      static_cast<float>(window_height_)};
+  for (std::size_t i{0}; i < frames; ++i) {
+    frame_ = {};
+    phase_start_ = std::chrono::steady_clock::now();
+    io_->DeltaTime = kOffscreenDeltaTime;
+    ImGui_ImplVulkan_NewFrame();
+    ImGui::NewFrame();
+    Render();
+    Lap(FrameStats::kRender);
+    ImGui::Render();
+    Lap(FrameStats::kImGuiRender);
+    OffscreenRender(ImGui::GetDrawData());
+    Lap(FrameStats::kRecord);
+    frame_[FrameStats::kRecord] -= frame_[FrameStats::kFenceWait];
+    stats_.Push(frame_);
+  }
+}
+
+void ImGuiGlfwVulkan::Lap(FrameStats::Phase phase) {
+  auto now{std::chrono::steady_clock::now()};
+  frame_[phase] =
+      std::chrono::duration<float, std::milli>{now - phase_start_}.count();
+  phase_start_ = now;
+}
+
+void ImGuiGlfwVulkan::DrawFrameStats() {
+  ImGui::SetNextWindowBgAlpha(0.85f);
+  if (ImGui::Begin("Frame timing", &show_stats_,
+                   ImGuiWindowFlags_AlwaysAutoResize |
+                       ImGuiWindowFlags_NoFocusOnAppearing)) {
+    auto frames{stats_.Snapshot()};
+    ImGui::Text("%zu frames, ms", frames.size());
+    if (ImGui::BeginTable("phases", 3, ImGuiTableFlags_RowBg)) {
+      ImGui::TableSetupColumn("phase");
+      ImGui::TableSetupColumn("p50");
+      ImGui::TableSetupColumn("p99");
+      ImGui::TableHeadersRow();
+      for (int i{0}; i < FrameStats::kPhaseCount; ++i) {
+        auto phase{static_cast<FrameStats::Phase>(i)};
+        ImGui::TableNextColumn();
+        ImGui::TextUnformatted(FrameStats::kPhaseNames[phase]);
+        ImGui::TableNextColumn();
+        ImGui::Text("%.3f", FrameStats::Quantile(frames, phase, 0.5));
+        ImGui::TableNextColumn();
+        ImGui::Text("%.3f", FrameStats::Quantile(frames, phase, 0.99));
+      }
+      ImGui::EndTable();
+    }
+    if (ImGui::Button("Save frame_times.csv")) {
+      try {
+        stats_.WriteCsv("frame_times.csv");
+      } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+      }
+    }
+  }
+  ImGui::End();
+}
+
+void ImGuiGlfwVulkan::Wake() {
+  wake_.store(true, std::memory_order_release);
+  if (target_ == Target::kWindow) glfwPostEmptyEvent();
+}
+
+void ImGuiGlfwVulkan::RequestRedraw(double seconds) {
+  if (target_ == Target::kOffscreen) return;
+  redraw_at_ = std::min(redraw_at_, glfwGetTime() + seconds);
+}
+
+void ImGuiGlfwVulkan::WaitForFrame() {
+  if (loop_mode_ == LoopMode::kContinuous) {
+    glfwPollEvents();
+    return;
+  }
+  while (!glfwWindowShouldClose(window_)) {
+    auto timeout{settle_frames_ > 0
+                     ? 0.0
+                     : std::clamp(redraw_at_ - glfwGetTime(), 0.0,
+                                  kIdleTimeout)};
+    input_ = false;
+    if (timeout > 0.0) {
+      glfwWaitEventsTimeout(timeout);
+    } else {
+      glfwPollEvents();
+    }
+    auto woken{wake_.exchange(false, std::memory_order_acquire)};
+    if (input_ || woken) settle_frames_ = kSettleFrames;
+    if (settle_frames_ > 0) {
+      --settle_frames_;
+      return;
+    }
+    if (glfwGetTime() >= redraw_at_) {
+      redraw_at_ = std::numeric_limits<double>::infinity();
+      return;
+    }
   }
 }
 
@@ -472,17 +796,95 @@ void ImGuiGlfwVulkan::FrameRender(ImDrawData* draw_data) {
   }
   const ImGui_ImplVulkanH_Frame* fd{
       &window_data_.Frames[window_data_.FrameIndex]};
+  auto wait_start{std::chrono::steady_clock::now()};
   err = vkWaitForFences(device_, 1, &fd->Fence, VK_TRUE, UINT64_MAX);
+  frame_[FrameStats::kFenceWait] = std::chrono::duration<float, std::milli>{
+      std::chrono::steady_clock::now() - wait_start}.count();
+  // Images past the last slot go untimed.
+  auto slot{window_data_.FrameIndex};
+  bool timed{query_pool_ != VK_NULL_HANDLE && slot < kTimestampSlots};
+  if (timed && timestamps_written_[slot]) ReadTimestamps(slot);
   err = vkResetFences(device_, 1, &fd->Fence);
   err = vkResetCommandPool(device_, fd->CommandPool, 0);
   err = BeginCommandBuffer(fd);
+  if (timed) {
+    vkCmdResetQueryPool(fd->CommandBuffer, query_pool_, 2 * slot, 2);
+    vkCmdWriteTimestamp(fd->CommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                        query_pool_, 2 * slot);
+  }
   CmdBeginRenderPass(fd);
   ImGui_ImplVulkan_RenderDrawData(draw_data, fd->CommandBuffer);
   vkCmdEndRenderPass(fd->CommandBuffer);
+  if (timed) {
+    vkCmdWriteTimestamp(fd->CommandBuffer,
+                        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, query_pool_,
+                        2 * slot + 1);
+    timestamps_written_[slot] = true;
+  }
   err = vkEndCommandBuffer(fd->CommandBuffer);
   err = QueueSubmit(fd, &image_acquired_semaphore, &render_complete_semaphore);
 }
 
+// Submits and waits, so the frame's timestamps are read back right away.
+void ImGuiGlfwVulkan::OffscreenRender(ImDrawData* draw_data) {
+  auto command_buffer{offscreen_.command_buffer};
+  vkResetCommandBuffer(command_buffer, 0);
+  VkCommandBufferBeginInfo begin_info{};
+  begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  vkBeginCommandBuffer(command_buffer, &begin_info);
+  bool timed{query_pool_ != VK_NULL_HANDLE};
+  if (timed) {
+    vkCmdResetQueryPool(command_buffer, query_pool_, 0, 2);
+    vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                        query_pool_, 0);
+  }
+  VkRenderPassBeginInfo pass_info{};
+  pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+  pass_info.renderPass = offscreen_.render_pass;
+  pass_info.framebuffer = offscreen_.framebuffer;
+  pass_info.renderArea.extent.width = static_cast<std::uint32_t>(window_width_);
+  pass_info.renderArea.extent.height =
+      static_cast<std::uint32_t>(window_height_);
+  pass_info.clearValueCount = 1;
+  pass_info.pClearValues = &window_data_.ClearValue;
+  vkCmdBeginRenderPass(command_buffer, &pass_info, VK_SUBPASS_CONTENTS_INLINE);
+  ImGui_ImplVulkan_RenderDrawData(draw_data, command_buffer);
+  vkCmdEndRenderPass(command_buffer);
+  if (timed) {
+    vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                        query_pool_, 1);
+  }
+  vkEndCommandBuffer(command_buffer);
+  VkSubmitInfo submit_info{};
+  submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submit_info.commandBufferCount = 1;
+  submit_info.pCommandBuffers = &command_buffer;
+  if (vkQueueSubmit(graphics_queue_, 1, &submit_info, offscreen_.fence) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to submit offscreen frame!");
+  }
+  auto wait_start{std::chrono::steady_clock::now()};
+  vkWaitForFences(device_, 1, &offscreen_.fence, VK_TRUE, UINT64_MAX);
+  frame_[FrameStats::kFenceWait] = std::chrono::duration<float, std::milli>{
+      std::chrono::steady_clock::now() - wait_start}.count();
+  vkResetFences(device_, 1, &offscreen_.fence);
+  if (timed) ReadTimestamps(0);
+}
+
+// The image's fence has signaled, so its previous timestamps are ready.
+void ImGuiGlfwVulkan::ReadTimestamps(std::uint32_t slot) {
+  std::array<std::uint64_t, 2> ticks{};
+  if (vkGetQueryPoolResults(device_, query_pool_, 2 * slot, 2, sizeof(ticks),
+                            ticks.data(), sizeof(ticks[0]),
+                            VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+    return;
+  }
+  auto elapsed{(ticks[1] - ticks[0]) & timestamp_mask_};
+  frame_[FrameStats::kGpu] = static_cast<float>(
+      static_cast<double>(elapsed) * timestamp_period_ / 1e6);
+}
+
 VkSemaphore ImGuiGlfwVulkan::GetImageAcquiredSemaphore() {
   return window_data_.FrameSemaphores[window_data_.SemaphoreIndex]
       .ImageAcquiredSemaphore;
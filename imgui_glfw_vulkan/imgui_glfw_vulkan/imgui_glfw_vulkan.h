@@ -2,11 +2,16 @@
 #define IMGUI_GLFW_VULKAN_IMGUI_GLFW_VULKAN_H_
 
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <limits>
 #include <optional>
 #include <string_view>
 #include <vector>
 
+#include "frame_stats.h"
 #include "imgui/backends/imgui_impl_glfw.h"
 #include "imgui/backends/imgui_impl_vulkan.h"
 #include "imgui/imgui.h"
@@ -18,17 +23,38 @@ namespace imgui_glfw_vulkan {
 
 class ImGuiGlfwVulkan {
  public:
+  // kContinuous renders back to back. kOnDemand blocks until there is
+  // input, a Wake() or a RequestRedraw() deadline, then renders a few
+  // frames for ImGui to settle.
+  enum class LoopMode { kContinuous, kOnDemand };
+  // kOffscreen renders into an image with no window, surface or swap chain,
+  // e.g. on lavapipe, and runs only RunFrames().
+  enum class Target { kWindow, kOffscreen };
+
   ImGuiGlfwVulkan(std::string_view name = "Window", int width = 800,
                   int height = 600,
-                  ImGuiConfigFlags flags = ImGuiConfigFlags_None);
+                  ImGuiConfigFlags flags = ImGuiConfigFlags_None,
+                  Target target = Target::kWindow);
   ImGuiGlfwVulkan(const ImGuiGlfwVulkan&) = default;
   ImGuiGlfwVulkan& operator=(const ImGuiGlfwVulkan&) = default;
   ImGuiGlfwVulkan(ImGuiGlfwVulkan&&) = default;
   ImGuiGlfwVulkan& operator=(ImGuiGlfwVulkan&&) = default;
   virtual ~ImGuiGlfwVulkan();
+  // F12 toggles an overlay with per-phase frame times.
   void Run();
+  // Renders `frames` frames into the offscreen image back to back, each
+  // waited for, with a fixed time step.
+  void RunFrames(std::size_t frames);
+  void SetLoopMode(LoopMode mode) { loop_mode_ = mode; }
+  const FrameStats& Stats() const { return stats_; }
+  // Makes the loop render a frame soon. Safe to call from any thread.
+  void Wake();
 
  protected:
+  // Makes the loop render a frame within `seconds`, e.g. for an animation.
+  // Render thread only.
+  void RequestRedraw(double seconds);
+
   ImGuiIO* io_{nullptr};
 
  private:
@@ -47,6 +73,8 @@ class ImGuiGlfwVulkan {
     bool IsComplete() { return !formats.empty() && !present_modes.empty(); }
   };
 
+  static ImGuiGlfwVulkan* Self(GLFWwindow* window);
+  static void OnInput(GLFWwindow* window);
   void InitWindow(const char* name);
   void InitVulkan(const char* name);
   void CreateInstance(const char* name);
@@ -64,11 +92,19 @@ class ImGuiGlfwVulkan {
   ImGuiGlfwVulkan::SwapChainSupportDetails QuerySwapChainSupport(
       const VkPhysicalDevice& device);
   void CreateLogicalDevice();
+  void CreateQueryPool();
   VkResult CreateDescriptorPool();
   void InitImGui(ImGuiConfigFlags flags);
   void SetupImGuiWindow();
+  void CreateOffscreenTarget();
+  void DestroyOffscreenTarget();
+  std::uint32_t FindMemoryType(std::uint32_t type_bits,
+                               VkMemoryPropertyFlags properties);
   virtual void Render() = 0;
+  void Lap(FrameStats::Phase phase);
   void FrameRender(ImDrawData* draw_data);
+  void OffscreenRender(ImDrawData* draw_data);
+  void ReadTimestamps(std::uint32_t slot);
   VkSemaphore GetImageAcquiredSemaphore();
   VkSemaphore GetRenderCompleteSemaphore();
   VkResult BeginCommandBuffer(const ImGui_ImplVulkanH_Frame* fd);
@@ -77,7 +113,21 @@ class ImGuiGlfwVulkan {
                        const VkSemaphore* image_semaphore,
                        const VkSemaphore* render_semaphore);
   void FramePresent();
+  void WaitForFrame();
+  void DrawFrameStats();
+
+  struct OffscreenTarget {
+    VkImage image{VK_NULL_HANDLE};
+    VkDeviceMemory memory{VK_NULL_HANDLE};
+    VkImageView view{VK_NULL_HANDLE};
+    VkRenderPass render_pass{VK_NULL_HANDLE};
+    VkFramebuffer framebuffer{VK_NULL_HANDLE};
+    VkCommandPool command_pool{VK_NULL_HANDLE};
+    VkCommandBuffer command_buffer{VK_NULL_HANDLE};
+    VkFence fence{VK_NULL_HANDLE};
+  };
 
+  Target target_{Target::kWindow};
   GLFWwindow* window_{nullptr};
   int window_width_{800};
   int window_height_{600};
@@ -102,6 +152,29 @@ class ImGuiGlfwVulkan {
   ImGui_ImplVulkanH_Window window_data_{};
   std::uint32_t min_image_count_{2};
   bool swap_chain_rebuild_{false};
+  static constexpr VkFormat kOffscreenFormat{VK_FORMAT_R8G8B8A8_UNORM};
+  static constexpr float kOffscreenDeltaTime{1.f / 60};
+  OffscreenTarget offscreen_{};
+  // On-demand loop state.
+  static constexpr int kSettleFrames{3};
+  static constexpr double kIdleTimeout{1.0};
+  static constexpr double kCaretBlink{0.5};
+  LoopMode loop_mode_{LoopMode::kContinuous};
+  std::atomic<bool> wake_{false};
+  bool input_{false};
+  double redraw_at_{std::numeric_limits<double>::infinity()};
+  int settle_frames_{kSettleFrames};
+  // Frame timing. The GPU time of a frame is read back when its swap chain
+  // image comes around again, so it lags by the swap chain length.
+  static constexpr std::uint32_t kTimestampSlots{8};
+  FrameStats stats_{};
+  FrameStats::Frame frame_{};
+  std::chrono::steady_clock::time_point phase_start_{};
+  bool show_stats_{false};
+  VkQueryPool query_pool_{VK_NULL_HANDLE};
+  float timestamp_period_{0.f};
+  std::uint64_t timestamp_mask_{0};
+  std::array<bool, kTimestampSlots> timestamps_written_{};
 };
 
 }  // namespace imgui_glfw_vulkan